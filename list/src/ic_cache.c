@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ic_cache.h"
+
+#define INITIAL_BUCKETS 16
+
+/* FNV-1a */
+static uint64_t hash_key(const void *key, size_t key_len)
+{
+  const unsigned char *p = key;
+  uint64_t h = 14695981039346656037ULL;
+
+  while (key_len--) {
+    h ^= *p++;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+ic_cache * ic_cache_new(ic_cache_policy policy, size_t max_entries, size_t max_bytes,
+                        ic_cache_free_func free_func)
+{
+  ic_cache *c = malloc(sizeof(ic_cache));
+
+  c->num_buckets = INITIAL_BUCKETS;
+  c->buckets = calloc(c->num_buckets, sizeof(ic_cache_entry *));
+  ic_list_init(&c->order);
+  c->policy = policy;
+  c->max_entries = max_entries;
+  c->max_bytes = max_bytes;
+  c->bytes = 0;
+  c->free_func = free_func;
+  return c;
+}
+
+size_t ic_cache_length(ic_cache *c)
+{
+  return ic_list_length(&c->order);
+}
+
+size_t ic_cache_bytes(ic_cache *c)
+{
+  return c->bytes;
+}
+
+static ic_cache_entry ** find_link(ic_cache *c, const void *key, size_t key_len,
+                                   uint64_t hash)
+{
+  ic_cache_entry **link = &c->buckets[hash & (c->num_buckets - 1)];
+
+  while (*link != NULL) {
+    ic_cache_entry *e = *link;
+    if (e->hash == hash && e->key_len == key_len && memcmp(e->key, key, key_len) == 0)
+      break;
+    link = &e->hash_next;
+  }
+  return link;
+}
+
+/* doubles the buckets once there are more entries than buckets */
+static void grow_index(ic_cache *c)
+{
+  size_t i, num_buckets = c->num_buckets * 2;
+  ic_cache_entry **buckets = calloc(num_buckets, sizeof(ic_cache_entry *));
+
+  for (i = 0; i < c->num_buckets; i++) {
+    ic_cache_entry *e = c->buckets[i], *next;
+    for (; e != NULL; e = next) {
+      next = e->hash_next;
+      e->hash_next = buckets[e->hash & (num_buckets - 1)];
+      buckets[e->hash & (num_buckets - 1)] = e;
+    }
+  }
+
+  free(c->buckets);
+  c->buckets = buckets;
+  c->num_buckets = num_buckets;
+}
+
+static void release_value(ic_cache *c, ic_cache_entry *e)
+{
+  c->bytes -= e->size;
+  if (c->free_func != NULL)
+    c->free_func(e->value);
+}
+
+static void delete_entry(ic_cache *c, ic_cache_entry *e)
+{
+  ic_cache_entry **link = find_link(c, e->key, e->key_len, e->hash);
+
+  *link = e->hash_next;
+  ic_list_unlink(&c->order, &e->node);
+  release_value(c, e);
+  free(e);
+}
+
+static bool over_limits(ic_cache *c)
+{
+  return (c->max_entries > 0 && ic_list_length(&c->order) > c->max_entries) ||
+         (c->max_bytes > 0 && c->bytes > c->max_bytes);
+}
+
+static void evict(ic_cache *c)
+{
+  while (over_limits(c) && !ic_list_empty(&c->order)) {
+    ic_cache_entry *victim = c->order.head->data;
+
+    if (victim->referenced) {
+      victim->referenced = false;
+      ic_list_unlink(&c->order, &victim->node);
+      ic_list_link_tail(&c->order, &victim->node);
+      continue;
+    }
+    delete_entry(c, victim);
+  }
+}
+
+void * ic_cache_get(ic_cache *c, const void *key, size_t key_len)
+{
+  ic_cache_entry *e = *find_link(c, key, key_len, hash_key(key, key_len));
+
+  if (e == NULL) return NULL;
+
+  if (c->policy == IC_CACHE_CLOCK) {
+    e->referenced = true;
+  } else if (c->order.tail != &e->node) {
+    ic_list_unlink(&c->order, &e->node);
+    ic_list_link_tail(&c->order, &e->node);
+  }
+  return e->value;
+}
+
+void ic_cache_put(ic_cache *c, const void *key, size_t key_len, void *value, size_t size)
+{
+  uint64_t hash = hash_key(key, key_len);
+  ic_cache_entry **link = find_link(c, key, key_len, hash);
+  ic_cache_entry *e = *link;
+
+  if (e != NULL) {
+    /* putting the stored value again only updates its size */
+    if (e->value == value)
+      c->bytes -= e->size;
+    else
+      release_value(c, e);
+    ic_list_unlink(&c->order, &e->node);
+  } else {
+    e = malloc(sizeof(ic_cache_entry) + key_len);
+    e->hash = hash;
+    e->key_len = key_len;
+    memcpy(e->key, key, key_len);
+    e->node.data = e;
+    e->hash_next = NULL;
+    *link = e;
+  }
+
+  e->value = value;
+  e->size = size;
+  e->referenced = false;
+  c->bytes += size;
+  ic_list_link_tail(&c->order, &e->node);
+
+  evict(c);
+  if (ic_list_length(&c->order) > c->num_buckets)
+    grow_index(c);
+}
+
+bool ic_cache_remove(ic_cache *c, const void *key, size_t key_len)
+{
+  ic_cache_entry *e = *find_link(c, key, key_len, hash_key(key, key_len));
+
+  if (e == NULL) return false;
+
+  delete_entry(c, e);
+  return true;
+}
+
+void ic_cache_free(ic_cache *c)
+{
+  ic_node *node, *next;
+
+  for (node = c->order.head; node != NULL; node = next) {
+    next = node->next;
+    release_value(c, node->data);
+    free(node->data);
+  }
+  free(c->buckets);
+  free(c);
+}
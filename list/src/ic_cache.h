@@ -0,0 +1,109 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ic_list.h"
+
+#ifndef _ICLIB_CACHE
+#define _ICLIB_CACHE
+
+/**
+ * Cache
+ *
+ * A bounded key/value cache with O(1) get, put and eviction. A hash index
+ * maps each key to its entry, and every entry embeds the ic_node that links
+ * it in an ic_list ordered for eviction.
+ *
+ * Keys are copied into the cache. Values are pointers owned by the cache:
+ * the ``free_func`` passed to ic_cache_new() is called on a value when it's
+ * evicted, replaced, removed or when the cache is freed.
+ *
+ * Two eviction policies are available:
+ *
+ *   IC_CACHE_LRU    evicts the least recently used entry. Every hit moves
+ *                   the entry to the tail of the list.
+ *   IC_CACHE_CLOCK  second chance: a hit only sets a flag in the entry.
+ *                   Eviction scans from the head, giving flagged entries
+ *                   another round at the tail. Hits don't write to the
+ *                   list, which keeps them cheap under heavy read load.
+ *
+ * You should *not* access any element of these structs directly
+ */
+typedef enum {
+  IC_CACHE_LRU,
+  IC_CACHE_CLOCK,
+} ic_cache_policy;
+
+/**
+ * Called on values leaving the cache, like ``vector_free_func``
+ */
+typedef void (*ic_cache_free_func)(void *value);
+
+typedef struct ic_cache_entry {
+  ic_node node;
+  struct ic_cache_entry *hash_next;
+  uint64_t hash;
+  void *value;
+  size_t size;
+  bool referenced;
+  size_t key_len;
+  unsigned char key[];
+} ic_cache_entry;
+
+typedef struct {
+  ic_cache_entry **buckets;
+  size_t num_buckets;
+  ic_list order;
+  ic_cache_policy policy;
+  size_t max_entries;
+  size_t max_bytes;
+  size_t bytes;
+  ic_cache_free_func free_func;
+} ic_cache;
+
+
+/**
+ * Allocates a new cache. The cache holds at most ``max_entries`` entries
+ * and at most ``max_bytes`` bytes, as declared by the ``size`` given to
+ * ic_cache_put(). A limit of 0 means unlimited. ``free_func`` may be NULL.
+ *
+ * You must call ic_cache_free() when done
+ */
+ic_cache * ic_cache_new(ic_cache_policy policy, size_t max_entries, size_t max_bytes,
+                        ic_cache_free_func free_func);
+
+/**
+ * Returns the number of entries in the cache
+ */
+size_t ic_cache_length(ic_cache *c);
+
+/**
+ * Returns the sum of the sizes of the entries in the cache
+ */
+size_t ic_cache_bytes(ic_cache *c);
+
+/**
+ * Returns the value stored for the key, NULL if not cached. Counts as a use
+ * of the entry for eviction
+ */
+void * ic_cache_get(ic_cache *c, const void *key, size_t key_len);
+
+/**
+ * Stores ``value`` for the key, replacing (and freeing) the previous value
+ * if the key was cached. Putting the value already stored does not free it. ``size`` is the cost of the entry counted against
+ * ``max_bytes``. Entries are evicted until the cache is within its limits,
+ * which may include this one if it alone exceeds ``max_bytes``
+ */
+void ic_cache_put(ic_cache *c, const void *key, size_t key_len, void *value, size_t size);
+
+/**
+ * Removes the key from the cache, freeing its value. Returns false if it
+ * was not cached
+ */
+bool ic_cache_remove(ic_cache *c, const void *key, size_t key_len);
+
+/**
+ * Frees the cache and all values in it
+ */
+void ic_cache_free(ic_cache *c);
+
+#endif
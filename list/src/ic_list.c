@@ -5,10 +5,18 @@
 ic_list * ic_list_new(void)
 {
   ic_list *l = malloc(sizeof(ic_list));
+  ic_list_init(l);
+  return l;
+}
+
+void ic_list_init(ic_list *l)
+{
   l->head = NULL;
   l->tail = NULL;
   l->length = 0;
-  return l;
+  l->find_mode = IC_LIST_FIND_IN_PLACE;
+  l->find_cache = NULL;
+  l->slabs = NULL;
 }
 
 bool ic_list_empty(ic_list *l)
@@ -25,6 +33,11 @@ void ic_list_append(ic_list *l, void *data)
 {
   ic_node *n = malloc(sizeof(ic_node));
   n->data = data;
+  ic_list_link_tail(l, n);
+}
+
+void ic_list_link_tail(ic_list *l, ic_node *n)
+{
   n->next = NULL;
 
   if (ic_list_empty(l)) {
@@ -51,6 +64,7 @@ void ic_list_prepend(ic_list *l, void *data)
     n->next = NULL;
   } else {
     n->next = l->head;
+    l->head->prev = n;
     l->head = n;
   }
   l->length++;
@@ -93,31 +107,319 @@ void * ic_list_nth_data(ic_list *l, size_t n)
   return node->data;
 }
 
+static ic_list_find_slot * cache_slot(ic_list *l, void *key)
+{
+  uintptr_t h = (uintptr_t)key;
+  h ^= h >> 4;
+  h ^= h >> 12;
+  return &l->find_cache[h & (IC_LIST_FIND_CACHE - 1)];
+}
+
+static void clear_cache(ic_list *l)
+{
+  if (l->find_cache != NULL)
+    memset(l->find_cache, 0, IC_LIST_FIND_CACHE * sizeof(ic_list_find_slot));
+}
+
+static void forget_node(ic_list *l, ic_node *n)
+{
+  size_t i;
+  for (i = 0; i < IC_LIST_FIND_CACHE; i++) {
+    if (l->find_cache[i].node == n) {
+      l->find_cache[i].key = NULL;
+      l->find_cache[i].node = NULL;
+    }
+  }
+}
+
+/* unlinks without touching the find cache, for nodes that stay in the list */
+static void detach(ic_list *l, ic_node *n)
+{
+  if (n->prev != NULL)
+    n->prev->next = n->next;
+  else
+    l->head = n->next;
+
+  if (n->next != NULL)
+    n->next->prev = n->prev;
+  else
+    l->tail = n->prev;
+
+  n->prev = NULL;
+  n->next = NULL;
+  l->length--;
+}
+
+/* links ``n`` right before ``at`` */
+static void link_before(ic_list *l, ic_node *n, ic_node *at)
+{
+  n->next = at;
+  n->prev = at->prev;
+  if (at->prev != NULL)
+    at->prev->next = n;
+  else
+    l->head = n;
+  at->prev = n;
+  l->length++;
+}
+
+static void reorganize(ic_list *l, ic_node *node)
+{
+  ic_node *at;
+
+  if (node == l->head || l->find_mode == IC_LIST_FIND_IN_PLACE) return;
+
+  at = l->find_mode == IC_LIST_MOVE_TO_FRONT ? l->head : node->prev;
+  detach(l, node);
+  link_before(l, node, at);
+}
+
 ic_node * ic_list_find(ic_list *l, void *data)
 {
-  size_t n = 0;
-  ic_node *node = NULL;
+  ic_list_find_slot *slot = NULL;
+  ic_node *node;
 
-  while (n < ic_list_length(l)) {
-    node = ic_list_nth(l, n);
-    if (memcmp(data, node->data, sizeof(void *)) == 0) return node;
-    n++;
+  /* move-to-front already keeps the hot elements at the head */
+  if (l->find_cache != NULL && l->find_mode != IC_LIST_MOVE_TO_FRONT) {
+    slot = cache_slot(l, data);
+    if (slot->key == data && slot->node != NULL &&
+        memcmp(data, slot->node->data, sizeof(void *)) == 0) {
+      node = slot->node;
+      reorganize(l, node);
+      return node;
+    }
+  }
+
+  for (node = l->head; node != NULL; node = node->next) {
+    if (memcmp(data, node->data, sizeof(void *)) == 0) {
+      if (slot != NULL) {
+        slot->key = data;
+        slot->node = node;
+      }
+      reorganize(l, node);
+      return node;
+    }
   }
   return NULL;
 }
 
-void ic_list_free(ic_list *l)
+void ic_list_set_find_mode(ic_list *l, ic_list_find_mode mode)
 {
-  if (ic_list_empty(l)) {
-    free(l);
+  l->find_mode = mode;
+}
+
+void ic_list_set_find_cache(ic_list *l, bool enabled)
+{
+  if (enabled && l->find_cache == NULL) {
+    l->find_cache = calloc(IC_LIST_FIND_CACHE, sizeof(ic_list_find_slot));
+  } else if (!enabled) {
+    free(l->find_cache);
+    l->find_cache = NULL;
+  }
+}
+
+/* a block of nodes allocated by ic_list_compact() */
+typedef struct {
+  ic_node *nodes;
+  size_t count;
+  size_t live;
+} slab;
+
+struct ic_list_slabs {
+  slab *items;       /* sorted by address */
+  size_t num;
+  size_t alloc;
+  ic_node *cursor;   /* last node visited by ic_list_compact_step() */
+};
+
+static struct ic_list_slabs * get_slabs(ic_list *l)
+{
+  if (l->slabs == NULL)
+    l->slabs = calloc(1, sizeof(struct ic_list_slabs));
+  return l->slabs;
+}
+
+static void add_slab(ic_list *l, slab sl)
+{
+  struct ic_list_slabs *s = get_slabs(l);
+  size_t i = s->num;
+
+  if (s->num == s->alloc) {
+    s->alloc = s->alloc > 0 ? s->alloc * 2 : 4;
+    s->items = realloc(s->items, s->alloc * sizeof(slab));
+  }
+  while (i > 0 && (uintptr_t)s->items[i - 1].nodes > (uintptr_t)sl.nodes) {
+    s->items[i] = s->items[i - 1];
+    i--;
+  }
+  s->items[i] = sl;
+  s->num++;
+}
+
+/* the block ``n`` lives in, NULL for nodes allocated one by one */
+static slab * find_slab(ic_list *l, ic_node *n)
+{
+  size_t lo = 0, hi, mid;
+  slab *sl;
+
+  if (l->slabs == NULL) return NULL;
+
+  hi = l->slabs->num;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if ((uintptr_t)l->slabs->items[mid].nodes <= (uintptr_t)n)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0) return NULL;
+
+  sl = &l->slabs->items[lo - 1];
+  if ((uintptr_t)n < (uintptr_t)(sl->nodes + sl->count))
+    return sl;
+  return NULL;
+}
+
+/* frees a node allocated by the list, releasing its block with the last one */
+static void release_node(ic_list *l, ic_node *n)
+{
+  slab *sl = find_slab(l, n);
+  size_t i;
+
+  if (sl == NULL) {
+    free(n);
+  } else if (--sl->live == 0) {
+    free(sl->nodes);
+    i = sl - l->slabs->items;
+    l->slabs->num--;
+    memmove(sl, sl + 1, (l->slabs->num - i) * sizeof(slab));
+  }
+}
+
+/* moves ``count`` nodes from ``first`` to a new block, returns the last one */
+static ic_node * pack(ic_list *l, ic_node *first, size_t count)
+{
+  ic_node *block = malloc(count * sizeof(ic_node));
+  ic_node *prev = first->prev, *node = first, *next;
+  size_t i;
+
+  for (i = 0; i < count; i++) {
+    next = node->next;
+    block[i].data = node->data;
+    block[i].prev = i > 0 ? &block[i - 1] : prev;
+    block[i].next = i + 1 < count ? &block[i + 1] : next;
+    release_node(l, node);
+    node = next;
+  }
+
+  if (prev != NULL)
+    prev->next = &block[0];
+  else
+    l->head = &block[0];
+  if (node != NULL)
+    node->prev = &block[count - 1];
+  else
+    l->tail = &block[count - 1];
+
+  add_slab(l, (slab){ block, count, count });
+  clear_cache(l);
+  return &block[count - 1];
+}
+
+void ic_list_compact(ic_list *l)
+{
+  if (ic_list_empty(l)) return;
+
+  get_slabs(l)->cursor = NULL;
+  ic_list_compact_step(l, l->length);
+  l->slabs->cursor = NULL;
+}
+
+size_t ic_list_compact_step(ic_list *l, size_t max_nodes)
+{
+  struct ic_list_slabs *s = get_slabs(l);
+  ic_node *first = s->cursor != NULL ? s->cursor->next : l->head;
+  ic_node *last = first;
+  size_t count = 1;
+  bool contiguous = true;
+
+  if (first == NULL || max_nodes == 0) {
+    s->cursor = NULL;
+    return 0;
+  }
+
+  while (count < max_nodes && last->next != NULL) {
+    if (last->next != last + 1)
+      contiguous = false;
+    last = last->next;
+    count++;
+  }
+
+  s->cursor = contiguous ? last : pack(l, first, count);
+  return count;
+}
+
+void ic_list_unlink(ic_list *l, ic_node *n)
+{
+  if (l->find_cache != NULL)
+    forget_node(l, n);
+  if (l->slabs != NULL && l->slabs->cursor == n)
+    l->slabs->cursor = n->prev;
+  detach(l, n);
+}
+
+void ic_list_remove(ic_list *l, ic_node *n)
+{
+  ic_list_unlink(l, n);
+  release_node(l, n);
+}
+
+void ic_list_concat(ic_list *dst, ic_list *src)
+{
+  if (ic_list_empty(src)) return;
+
+  if (ic_list_empty(dst)) {
+    dst->head = src->head;
   } else {
-    ic_node *tmp;
-    while (l->head != l->tail) {
-      tmp = l->head;
-      l->head = l->head->next;
-      free(tmp);
-    }
-    free(l->head);
-    free(l);
+    dst->tail->next = src->head;
+    src->head->prev = dst->tail;
+  }
+  dst->tail = src->tail;
+  dst->length += src->length;
+
+  src->head = NULL;
+  src->tail = NULL;
+  src->length = 0;
+
+  /* the cached nodes now belong to dst, and so do their blocks */
+  clear_cache(src);
+  if (src->slabs != NULL) {
+    size_t i;
+    for (i = 0; i < src->slabs->num; i++)
+      add_slab(dst, src->slabs->items[i]);
+    src->slabs->num = 0;
+    src->slabs->cursor = NULL;
+  }
+}
+
+void ic_list_free(ic_list *l)
+{
+  ic_node *node, *next;
+  size_t i;
+
+  free(l->find_cache);
+
+  for (node = l->head; node != NULL; node = next) {
+    next = node->next;
+    if (find_slab(l, node) == NULL)
+      free(node);
+  }
+
+  if (l->slabs != NULL) {
+    for (i = 0; i < l->slabs->num; i++)
+      free(l->slabs->items[i].nodes);
+    free(l->slabs->items);
+    free(l->slabs);
   }
+  free(l);
 }
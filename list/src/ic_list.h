@@ -1,6 +1,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifndef _ICLIB_LIST
 #define _ICLIB_LIST
@@ -23,10 +24,37 @@ typedef struct ic_node {
   void *data;
 } ic_node;
 
+/**
+ * How ic_list_find() reorders the list on each match, so frequently found
+ * elements end up near the head:
+ *
+ *   IC_LIST_FIND_IN_PLACE    never (the default)
+ *   IC_LIST_MOVE_TO_FRONT    moves the element to the head. Adapts fast
+ *                            when the popular elements change.
+ *   IC_LIST_TRANSPOSE        swaps the element with the previous one. Slower
+ *                            to adapt, but steadier when access is stable.
+ */
+typedef enum {
+  IC_LIST_FIND_IN_PLACE,
+  IC_LIST_MOVE_TO_FRONT,
+  IC_LIST_TRANSPOSE,
+} ic_list_find_mode;
+
+/* entries of the ic_list_find() cache, a power of two */
+#define IC_LIST_FIND_CACHE 16
+
+typedef struct {
+  void *key;
+  ic_node *node;
+} ic_list_find_slot;
+
 typedef struct {
   ic_node *head;
   ic_node *tail;
   size_t length;
+  ic_list_find_mode find_mode;
+  ic_list_find_slot *find_cache;
+  struct ic_list_slabs *slabs;
 } ic_list;
 
 
@@ -37,6 +65,12 @@ typedef struct {
  */
 ic_list * ic_list_new(void);
 
+/**
+ * Initializes a list embedded in another struct. A zeroed ic_list is a
+ * valid empty list too.
+ */
+void ic_list_init(ic_list *l);
+
 /**
  * Returns true if the list is empty, false otherwise
  */
@@ -81,9 +115,80 @@ void * ic_list_nth_data(ic_list *l, size_t n);
 /**
  * Returns the element which contains the given data. NULL if not found.
  * Comparison is made using memcmp().
+ *
+ * With a find mode other than IC_LIST_FIND_IN_PLACE or the find cache
+ * enabled, the element returned is one that matches, not necessarily the
+ * one closest to the head.
  */
 ic_node * ic_list_find(ic_list *l, void *data);
 
+/**
+ * Sets how ic_list_find() reorders the list (see ic_list_find_mode)
+ */
+void ic_list_set_find_mode(ic_list *l, ic_list_find_mode mode);
+
+/**
+ * Enables or disables a cache of the last IC_LIST_FIND_CACHE elements found,
+ * keyed by the ``data`` pointer given to ic_list_find(). Repeated lookups
+ * with the same pointer skip the walk, after checking the cached element
+ * still matches. Removing or unlinking an element drops it from the cache.
+ *
+ * It pays off when the lookups keep coming back to a few elements, no more
+ * than the cache holds. With more popular elements than that, it mostly
+ * misses and only adds a check to each walk. It is neither read nor filled
+ * under IC_LIST_MOVE_TO_FRONT, which already finds such elements at the
+ * head.
+ */
+void ic_list_set_find_cache(ic_list *l, bool enabled);
+
+/**
+ * Moves all elements of ``src`` to the tail of ``dst``, in order, without
+ * copying or allocating. ``src`` is left empty. O(1), plus the number of
+ * blocks when ``src`` was compacted.
+ */
+void ic_list_concat(ic_list *dst, ic_list *src);
+
+/**
+ * Unlinks ``n`` from the list and frees it. O(1), O(log b) after the list
+ * was compacted into b blocks.
+ */
+void ic_list_remove(ic_list *l, ic_node *n);
+
+/**
+ * Moves all elements into one block of contiguous nodes, in head to tail
+ * order, so walking the list reads memory sequentially instead of jumping
+ * between nodes allocated one by one. Does nothing if the nodes are
+ * already laid out that way. O(n)
+ *
+ * Every ic_node pointer to the list's elements becomes invalid and the
+ * find cache is cleared. Only for lists whose elements were added with
+ * ic_list_append() or ic_list_prepend(). Nodes added later are allocated
+ * one by one as usual, until the next compaction.
+ */
+void ic_list_compact(ic_list *l);
+
+/**
+ * Incremental ic_list_compact(): packs the next ``max_nodes`` elements of a
+ * pass over the list into a block of their own, resuming where the last
+ * call stopped. Runs already contiguous are left in place.
+ *
+ * Returns the number of elements visited, 0 once the pass reached the
+ * tail, in which case the next call starts a new pass from the head.
+ */
+size_t ic_list_compact_step(ic_list *l, size_t max_nodes);
+
+/**
+ * Intrusive use: link a node allocated by the caller (usually embedded in a
+ * bigger struct) to the tail of the list, and unlink it again without
+ * freeing it. Both are O(1).
+ *
+ * Lists with caller-owned nodes must not be freed with ic_list_free(),
+ * nor compacted. Nodes of a compacted list must not be linked into
+ * another list.
+ */
+void ic_list_link_tail(ic_list *l, ic_node *n);
+void ic_list_unlink(ic_list *l, ic_node *n);
+
 /**
  * Frees all elements from the list
  */
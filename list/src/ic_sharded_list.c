@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include "ic_sharded_list.h"
+
+/* shard of the calling thread, assigned round-robin on its first append */
+static __thread size_t thread_shard = (size_t)-1;
+static size_t next_shard = 0;
+
+static ic_shard * current_shard(ic_sharded_list *sl)
+{
+  if (thread_shard == (size_t)-1)
+    thread_shard = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED);
+  return &sl->shards[thread_shard % sl->num_shards];
+}
+
+ic_sharded_list * ic_sharded_list_new(size_t num_shards)
+{
+  size_t i;
+  ic_sharded_list *sl = malloc(sizeof(ic_sharded_list));
+
+  if (num_shards == 0) num_shards = 1;
+
+  sl->num_shards = num_shards;
+  sl->shards = malloc(num_shards * sizeof(ic_shard));
+  for (i = 0; i < num_shards; i++) {
+    pthread_mutex_init(&sl->shards[i].lock, NULL);
+    ic_list_init(&sl->shards[i].list);
+  }
+  return sl;
+}
+
+void ic_sharded_list_append(ic_sharded_list *sl, void *data)
+{
+  ic_shard *shard = current_shard(sl);
+
+  pthread_mutex_lock(&shard->lock);
+  ic_list_append(&shard->list, data);
+  pthread_mutex_unlock(&shard->lock);
+}
+
+size_t ic_sharded_list_length(ic_sharded_list *sl)
+{
+  size_t i, length = 0;
+
+  for (i = 0; i < sl->num_shards; i++) {
+    pthread_mutex_lock(&sl->shards[i].lock);
+    length += ic_list_length(&sl->shards[i].list);
+    pthread_mutex_unlock(&sl->shards[i].lock);
+  }
+  return length;
+}
+
+void ic_sharded_list_drain(ic_sharded_list *sl, ic_list *dst)
+{
+  size_t i;
+
+  for (i = 0; i < sl->num_shards; i++) {
+    pthread_mutex_lock(&sl->shards[i].lock);
+    ic_list_concat(dst, &sl->shards[i].list);
+    pthread_mutex_unlock(&sl->shards[i].lock);
+  }
+}
+
+void ic_sharded_list_free(ic_sharded_list *sl)
+{
+  size_t i;
+  ic_node *node, *next;
+
+  for (i = 0; i < sl->num_shards; i++) {
+    for (node = sl->shards[i].list.head; node != NULL; node = next) {
+      next = node->next;
+      free(node);
+    }
+    pthread_mutex_destroy(&sl->shards[i].lock);
+  }
+  free(sl->shards);
+  free(sl);
+}
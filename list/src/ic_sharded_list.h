@@ -0,0 +1,65 @@
+#include <stddef.h>
+#include <pthread.h>
+#include "ic_list.h"
+
+#ifndef _ICLIB_SHARDED_LIST
+#define _ICLIB_SHARDED_LIST
+
+#define IC_CACHE_LINE 64
+
+/**
+ * Sharded list
+ *
+ * Lets many threads append at the same time. Each shard is an ic_list with
+ * its own lock, and each thread always appends to the same shard, so
+ * writers on different shards never contend. Consumers move everything
+ * into a regular ic_list with ic_sharded_list_drain().
+ *
+ * Elements appended by one thread keep their order. There is no order
+ * between elements appended by different threads.
+ *
+ * You should *not* access any element of these structs directly
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  ic_list list;
+  char pad[IC_CACHE_LINE];
+} ic_shard;
+
+typedef struct {
+  ic_shard *shards;
+  size_t num_shards;
+} ic_sharded_list;
+
+
+/**
+ * Allocates a new sharded list with ``num_shards`` shards (at least one).
+ * Use about as many shards as writer threads.
+ *
+ * You must call ic_sharded_list_free() when done
+ */
+ic_sharded_list * ic_sharded_list_new(size_t num_shards);
+
+/**
+ * Add one element to the tail of the calling thread's shard. Thread safe
+ */
+void ic_sharded_list_append(ic_sharded_list *sl, void *data);
+
+/**
+ * Returns the number of elements in all shards. Thread safe, but the
+ * result may be outdated if other threads are appending
+ */
+size_t ic_sharded_list_length(ic_sharded_list *sl);
+
+/**
+ * Moves the elements of every shard to the tail of ``dst``, shard by shard,
+ * leaving the sharded list empty. O(number of shards). Thread safe
+ */
+void ic_sharded_list_drain(ic_sharded_list *sl, ic_list *dst);
+
+/**
+ * Frees the sharded list and all elements left in it
+ */
+void ic_sharded_list_free(ic_sharded_list *sl);
+
+#endif
@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include "ic_skiplist.h"
+
+static size_t node_size(int level)
+{
+  return sizeof(ic_skipnode) + level * sizeof(ic_skipnode *);
+}
+
+/*
+ * Node pool: one free list per level, linked through next[0]. When a free
+ * list is empty a chunk of IC_SKIPLIST_POOL_CHUNK nodes is allocated at
+ * once. Chunks are linked through their first word and released on free.
+ */
+static void refill_pool(ic_skiplist *sl, int level)
+{
+  size_t size = node_size(level);
+  size_t header = sizeof(ic_skipnode *);
+  char *chunk = malloc(header + IC_SKIPLIST_POOL_CHUNK * size);
+  int i;
+
+  *(void **)chunk = sl->chunks;
+  sl->chunks = chunk;
+
+  for (i = 0; i < IC_SKIPLIST_POOL_CHUNK; i++) {
+    ic_skipnode *node = (ic_skipnode *)(chunk + header + i * size);
+    node->next[0] = sl->free_nodes[level - 1];
+    sl->free_nodes[level - 1] = node;
+  }
+}
+
+static ic_skipnode * alloc_node(ic_skiplist *sl, int level)
+{
+  ic_skipnode *node;
+
+  if (sl->free_nodes[level - 1] == NULL)
+    refill_pool(sl, level);
+
+  node = sl->free_nodes[level - 1];
+  sl->free_nodes[level - 1] = node->next[0];
+  node->level = level;
+  return node;
+}
+
+static void release_node(ic_skiplist *sl, ic_skipnode *node)
+{
+  node->next[0] = sl->free_nodes[node->level - 1];
+  sl->free_nodes[node->level - 1] = node;
+}
+
+/* each level holds a quarter of the nodes of the level below */
+static int random_level(ic_skiplist *sl)
+{
+  int level = 1;
+  unsigned int x = sl->seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  sl->seed = x;
+
+  while ((x & 3) == 0 && level < IC_SKIPLIST_MAX_LEVEL) {
+    level++;
+    x >>= 2;
+  }
+  return level;
+}
+
+ic_skiplist * ic_skiplist_new(ic_cmp_func cmp)
+{
+  int i;
+  ic_skiplist *sl = malloc(sizeof(ic_skiplist));
+
+  sl->head = malloc(node_size(IC_SKIPLIST_MAX_LEVEL));
+  sl->head->prev = NULL;
+  sl->head->data = NULL;
+  sl->head->level = IC_SKIPLIST_MAX_LEVEL;
+  for (i = 0; i < IC_SKIPLIST_MAX_LEVEL; i++) {
+    sl->head->next[i] = NULL;
+    sl->free_nodes[i] = NULL;
+  }
+
+  sl->tail = NULL;
+  sl->level = 1;
+  sl->length = 0;
+  sl->cmp = cmp;
+  sl->seed = 2463534242u;
+  sl->chunks = NULL;
+  return sl;
+}
+
+size_t ic_skiplist_length(ic_skiplist *sl)
+{
+  return sl->length;
+}
+
+/*
+ * Walks down from the top level stopping before the first node for which
+ * ``stop`` holds, recording in ``update`` the last node visited per level.
+ * With ``after_equal`` the walk also passes nodes equal to ``key``.
+ */
+static ic_skipnode * search(ic_skiplist *sl, const void *key, bool after_equal,
+                            ic_skipnode **update)
+{
+  ic_skipnode *x = sl->head;
+  int i, cmp;
+
+  for (i = sl->level - 1; i >= 0; i--) {
+    while (x->next[i] != NULL) {
+      cmp = sl->cmp(x->next[i]->data, key);
+      if (cmp > 0 || (cmp == 0 && !after_equal)) break;
+      x = x->next[i];
+    }
+    if (update != NULL) update[i] = x;
+  }
+  return x;
+}
+
+ic_skipnode * ic_skiplist_insert(ic_skiplist *sl, void *data)
+{
+  ic_skipnode *update[IC_SKIPLIST_MAX_LEVEL];
+  ic_skipnode *node;
+  int i, level = random_level(sl);
+
+  search(sl, data, true, update);
+  for (i = sl->level; i < level; i++)
+    update[i] = sl->head;
+  if (level > sl->level) sl->level = level;
+
+  node = alloc_node(sl, level);
+  node->data = data;
+  for (i = 0; i < level; i++) {
+    node->next[i] = update[i]->next[i];
+    update[i]->next[i] = node;
+  }
+
+  node->prev = (update[0] == sl->head) ? NULL : update[0];
+  if (node->next[0] != NULL)
+    node->next[0]->prev = node;
+  else
+    sl->tail = node;
+
+  sl->length++;
+  return node;
+}
+
+ic_skipnode * ic_skiplist_lower_bound(ic_skiplist *sl, const void *key)
+{
+  return search(sl, key, false, NULL)->next[0];
+}
+
+ic_skipnode * ic_skiplist_find(ic_skiplist *sl, const void *key)
+{
+  ic_skipnode *node = ic_skiplist_lower_bound(sl, key);
+
+  if (node != NULL && sl->cmp(node->data, key) == 0) return node;
+  return NULL;
+}
+
+void * ic_skiplist_remove(ic_skiplist *sl, const void *key)
+{
+  ic_skipnode *update[IC_SKIPLIST_MAX_LEVEL];
+  ic_skipnode *node;
+  void *data;
+  int i;
+
+  node = search(sl, key, false, update)->next[0];
+  if (node == NULL || sl->cmp(node->data, key) != 0) return NULL;
+
+  for (i = 0; i < node->level; i++)
+    update[i]->next[i] = node->next[i];
+
+  if (node->next[0] != NULL)
+    node->next[0]->prev = node->prev;
+  else
+    sl->tail = node->prev;
+
+  while (sl->level > 1 && sl->head->next[sl->level - 1] == NULL)
+    sl->level--;
+
+  data = node->data;
+  release_node(sl, node);
+  sl->length--;
+  return data;
+}
+
+ic_skipnode * ic_skiplist_first(ic_skiplist *sl)
+{
+  return sl->head->next[0];
+}
+
+ic_skipnode * ic_skiplist_last(ic_skiplist *sl)
+{
+  return sl->tail;
+}
+
+ic_skipnode * ic_skiplist_next(ic_skipnode *node)
+{
+  return node->next[0];
+}
+
+ic_skipnode * ic_skiplist_prev(ic_skipnode *node)
+{
+  return node->prev;
+}
+
+size_t ic_skiplist_range(ic_skiplist *sl, const void *low, const void *high,
+                         ic_visit_func visit, void *aux)
+{
+  ic_skipnode *node = ic_skiplist_lower_bound(sl, low);
+  size_t visited = 0;
+
+  while (node != NULL && sl->cmp(node->data, high) <= 0) {
+    visit(node->data, aux);
+    visited++;
+    node = node->next[0];
+  }
+  return visited;
+}
+
+void ic_skiplist_free(ic_skiplist *sl)
+{
+  void *chunk, *next;
+
+  for (chunk = sl->chunks; chunk != NULL; chunk = next) {
+    next = *(void **)chunk;
+    free(chunk);
+  }
+  free(sl->head);
+  free(sl);
+}
@@ -0,0 +1,115 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef _ICLIB_SKIPLIST
+#define _ICLIB_SKIPLIST
+
+#define IC_SKIPLIST_MAX_LEVEL 32
+
+/* nodes of the same level are allocated in chunks of this many */
+#define IC_SKIPLIST_POOL_CHUNK 64
+
+/**
+ * Compares the data of two elements, returning a negative number, zero or a
+ * positive number like strcmp()
+ */
+typedef int (*ic_cmp_func)(const void *data1, const void *data2);
+
+/**
+ * Called by ic_skiplist_range() for each element in the range
+ */
+typedef void (*ic_visit_func)(void *data, void *aux);
+
+/**
+ * Skip list and node types
+ *
+ * A skip list keeps its elements ordered by a comparator, with O(log n)
+ * insert, find and remove on average. Like ic_node, a node has a ``prev``
+ * pointer and stores a pointer to your data (which is not copied); in
+ * place of a single ``next`` it has one forward pointer per level,
+ * ``next[0]`` linking all the elements in order.
+ *
+ * Nodes come from a pool owned by the list: they are allocated in chunks
+ * and removed nodes are reused, so inserts rarely call malloc().
+ *
+ * You should *not* access any element of these structs directly
+ */
+typedef struct ic_skipnode {
+  struct ic_skipnode *prev;
+  void *data;
+  int level;
+  struct ic_skipnode *next[];
+} ic_skipnode;
+
+typedef struct {
+  ic_skipnode *head;
+  ic_skipnode *tail;
+  int level;
+  size_t length;
+  ic_cmp_func cmp;
+  unsigned int seed;
+  ic_skipnode *free_nodes[IC_SKIPLIST_MAX_LEVEL];
+  void *chunks;
+} ic_skiplist;
+
+
+/**
+ * Allocates a new skip list ordered by ``cmp`` and returns a pointer to it.
+ *
+ * You must call ic_skiplist_free() when done
+ */
+ic_skiplist * ic_skiplist_new(ic_cmp_func cmp);
+
+/**
+ * Returns the number of elements in the skip list
+ */
+size_t ic_skiplist_length(ic_skiplist *sl);
+
+/**
+ * Inserts one element in order. Elements equal to existing ones are
+ * inserted after them. Returns the new node
+ */
+ic_skipnode * ic_skiplist_insert(ic_skiplist *sl, void *data);
+
+/**
+ * Returns the first element equal to ``key``, NULL if not found
+ */
+ic_skipnode * ic_skiplist_find(ic_skiplist *sl, const void *key);
+
+/**
+ * Returns the first element greater or equal to ``key``, NULL if there's
+ * none. Walk forward from it with ic_skiplist_next() for range queries
+ */
+ic_skipnode * ic_skiplist_lower_bound(ic_skiplist *sl, const void *key);
+
+/**
+ * Removes the first element equal to ``key`` and returns its data, NULL if
+ * not found
+ */
+void * ic_skiplist_remove(ic_skiplist *sl, const void *key);
+
+/**
+ * Returns the smallest/greatest element. NULL if the list is empty
+ */
+ic_skipnode * ic_skiplist_first(ic_skiplist *sl);
+ic_skipnode * ic_skiplist_last(ic_skiplist *sl);
+
+/**
+ * Returns the element after/before ``node`` in order. NULL at the ends
+ */
+ic_skipnode * ic_skiplist_next(ic_skipnode *node);
+ic_skipnode * ic_skiplist_prev(ic_skipnode *node);
+
+/**
+ * Calls ``visit`` in order for each element between ``low`` and ``high``,
+ * both inclusive. Returns the number of elements visited
+ */
+size_t ic_skiplist_range(ic_skiplist *sl, const void *low, const void *high,
+                         ic_visit_func visit, void *aux);
+
+/**
+ * Frees the skip list and all its nodes. Your data is not freed
+ */
+void ic_skiplist_free(ic_skiplist *sl);
+
+#endif
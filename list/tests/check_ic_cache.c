@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <check.h>
+#include "../src/ic_cache.h"
+
+static int freed;
+
+static void count_free(void *value)
+{
+  (void)value;
+  freed++;
+}
+
+static void put_int(ic_cache *c, int key, int *value, size_t size)
+{
+  ic_cache_put(c, &key, sizeof(int), value, size);
+}
+
+static int * get_int(ic_cache *c, int key)
+{
+  return ic_cache_get(c, &key, sizeof(int));
+}
+
+START_TEST (cache_lru_should_evict_least_recently_used)
+{
+  int a = 1, b = 2, c3 = 3, d = 4;
+
+  ic_cache *c = ic_cache_new(IC_CACHE_LRU, 3, 0, count_free);
+  freed = 0;
+  put_int(c, 1, &a, 1);
+  put_int(c, 2, &b, 1);
+  put_int(c, 3, &c3, 1);
+
+  fail_unless(get_int(c, 1) == &a);  /* 2 is now the oldest */
+  put_int(c, 4, &d, 1);
+
+  fail_unless(ic_cache_length(c) == 3);
+  fail_unless(freed == 1);
+  fail_unless(get_int(c, 2) == NULL, "key 2 should be evicted");
+  fail_unless(get_int(c, 1) == &a);
+  fail_unless(get_int(c, 3) == &c3);
+  fail_unless(get_int(c, 4) == &d);
+
+  ic_cache_free(c);
+  fail_unless(freed == 4);
+}
+END_TEST
+
+START_TEST (cache_clock_should_give_referenced_entries_a_second_chance)
+{
+  int a = 1, b = 2, c3 = 3, d = 4;
+
+  ic_cache *c = ic_cache_new(IC_CACHE_CLOCK, 3, 0, NULL);
+  put_int(c, 1, &a, 1);
+  put_int(c, 2, &b, 1);
+  put_int(c, 3, &c3, 1);
+
+  fail_unless(get_int(c, 1) == &a);
+  fail_unless(memcmp(((ic_cache_entry *)c->order.head->data)->key, &a, sizeof(int)) == 0,
+              "hits should not reorder the list");
+  put_int(c, 4, &d, 1);
+
+  fail_unless(get_int(c, 2) == NULL, "key 2 should be evicted");
+  fail_unless(get_int(c, 1) == &a, "referenced key 1 should survive");
+
+  ic_cache_free(c);
+}
+END_TEST
+
+START_TEST (cache_should_respect_byte_limit)
+{
+  int values[10], i;
+
+  ic_cache *c = ic_cache_new(IC_CACHE_LRU, 0, 100, NULL);
+  for (i = 0; i < 10; i++)
+    put_int(c, i, &values[i], 30);
+
+  fail_unless(ic_cache_length(c) == 3);
+  fail_unless(ic_cache_bytes(c) == 90);
+  fail_unless(get_int(c, 9) == &values[9]);
+  fail_unless(get_int(c, 6) == NULL);
+
+  put_int(c, 20, &values[0], 200);  /* bigger than the whole cache */
+  fail_unless(ic_cache_length(c) == 0);
+  fail_unless(ic_cache_bytes(c) == 0);
+
+  ic_cache_free(c);
+}
+END_TEST
+
+START_TEST (cache_put_should_replace_and_remove_should_free)
+{
+  int a = 1, b = 2;
+  char key[] = "some string key";
+
+  ic_cache *c = ic_cache_new(IC_CACHE_LRU, 10, 0, count_free);
+  freed = 0;
+
+  ic_cache_put(c, key, strlen(key), &a, 5);
+  ic_cache_put(c, key, strlen(key), &b, 7);
+  fail_unless(freed == 1, "replaced value should be freed");
+  fail_unless(ic_cache_length(c) == 1);
+  fail_unless(ic_cache_bytes(c) == 7);
+  fail_unless(ic_cache_get(c, key, strlen(key)) == &b);
+
+  ic_cache_put(c, key, strlen(key), &b, 9);
+  fail_unless(freed == 1, "putting the same value again should not free it");
+  fail_unless(ic_cache_bytes(c) == 9);
+  fail_unless(ic_cache_get(c, key, strlen(key)) == &b);
+
+  fail_unless(ic_cache_remove(c, key, strlen(key)));
+  fail_unless(!ic_cache_remove(c, key, strlen(key)));
+  fail_unless(freed == 2);
+  fail_unless(ic_cache_length(c) == 0);
+
+  ic_cache_free(c);
+}
+END_TEST
+
+START_TEST (cache_should_index_many_entries)
+{
+  int i, *values = malloc(10000 * sizeof(int));
+
+  ic_cache *c = ic_cache_new(IC_CACHE_LRU, 5000, 0, NULL);
+  for (i = 0; i < 10000; i++) {
+    values[i] = i;
+    put_int(c, i, &values[i], 1);
+  }
+
+  fail_unless(ic_cache_length(c) == 5000);
+  for (i = 0; i < 5000; i++)
+    fail_unless(get_int(c, i) == NULL);
+  for (i = 5000; i < 10000; i++)
+    fail_unless(get_int(c, i) == &values[i]);
+
+  ic_cache_free(c);
+  free(values);
+}
+END_TEST
+
+Suite *ic_cache_suite(void) {
+  Suite *s = suite_create("cache");
+  TCase *tc_cache = tcase_create("cache");
+
+  tcase_add_test(tc_cache, cache_lru_should_evict_least_recently_used);
+  tcase_add_test(tc_cache, cache_clock_should_give_referenced_entries_a_second_chance);
+  tcase_add_test(tc_cache, cache_should_respect_byte_limit);
+  tcase_add_test(tc_cache, cache_put_should_replace_and_remove_should_free);
+  tcase_add_test(tc_cache, cache_should_index_many_entries);
+
+  suite_add_tcase(s, tc_cache);
+
+  return s;
+}
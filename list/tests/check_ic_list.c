@@ -72,6 +72,8 @@ START_TEST (prepend_many_elements)
   fail_unless(ic_list_length(mylist), 3);
   assert_list_elements(mylist, &num1, &num2, &num3);
   assert_list_bounds(mylist);
+  fail_unless(ic_list_nth(mylist, 1)->prev == mylist->head);
+  fail_unless(mylist->tail->prev == ic_list_nth(mylist, 1));
 
   ic_list_free(mylist);
 }
@@ -123,6 +125,311 @@ START_TEST (find_should_return_matched_element_or_NULL_if_not_found)
 }
 END_TEST
 
+START_TEST (find_with_move_to_front_should_move_matches_to_head)
+{
+  intptr_t num1 = 1, num2 = 2, num3 = 3, num4 = 4;
+
+  ic_list *mylist = ic_list_new();
+  ic_list_append(mylist, &num1);
+  ic_list_append(mylist, &num2);
+  ic_list_append(mylist, &num3);
+  ic_list_append(mylist, &num4);
+  ic_list_set_find_mode(mylist, IC_LIST_MOVE_TO_FRONT);
+
+  fail_unless(ic_list_find(mylist, &num3) == mylist->head);
+  assert_list_elements(mylist, &num3, &num1, &num2, &num4);
+
+  fail_unless(ic_list_find(mylist, &num4) == mylist->head);
+  assert_list_elements(mylist, &num4, &num3, &num1, &num2);
+  assert_list_bounds(mylist);
+  fail_unless(ic_list_length(mylist) == 4);
+
+  ic_list_free(mylist);
+}
+END_TEST
+
+START_TEST (find_with_transpose_should_swap_matches_with_previous)
+{
+  intptr_t num1 = 1, num2 = 2, num3 = 3;
+
+  ic_list *mylist = ic_list_new();
+  ic_list_append(mylist, &num1);
+  ic_list_append(mylist, &num2);
+  ic_list_append(mylist, &num3);
+  ic_list_set_find_mode(mylist, IC_LIST_TRANSPOSE);
+
+  ic_list_find(mylist, &num3);
+  assert_list_elements(mylist, &num1, &num3, &num2);
+  ic_list_find(mylist, &num3);
+  assert_list_elements(mylist, &num3, &num1, &num2);
+  ic_list_find(mylist, &num3);
+  assert_list_elements(mylist, &num3, &num1, &num2);
+  assert_list_bounds(mylist);
+
+  ic_list_free(mylist);
+}
+END_TEST
+
+START_TEST (find_cache_should_be_skipped_under_move_to_front)
+{
+  intptr_t num1 = 1, num2 = 2, num3 = 3;
+  size_t i;
+
+  ic_list *mylist = ic_list_new();
+  ic_list_append(mylist, &num1);
+  ic_list_append(mylist, &num2);
+  ic_list_append(mylist, &num3);
+  ic_list_set_find_mode(mylist, IC_LIST_MOVE_TO_FRONT);
+  ic_list_set_find_cache(mylist, true);
+
+  fail_unless(ic_list_find(mylist, &num3) == mylist->head);
+  fail_unless(ic_list_find(mylist, &num2) == mylist->head);
+  assert_list_elements(mylist, &num2, &num3, &num1);
+  for (i = 0; i < IC_LIST_FIND_CACHE; i++)
+    fail_unless(mylist->find_cache[i].node == NULL, "the cache should not be filled");
+
+  ic_list_free(mylist);
+}
+END_TEST
+
+START_TEST (find_cache_should_never_return_stale_nodes)
+{
+  /* find compares pointer sized values */
+  intptr_t num1 = 1, num2 = 2, num3 = 3, key = 2;
+  ic_node *found;
+
+  ic_list *mylist = ic_list_new();
+  ic_list_append(mylist, &num1);
+  ic_list_append(mylist, &num2);
+  ic_list_append(mylist, &num3);
+  ic_list_set_find_cache(mylist, true);
+
+  found = ic_list_find(mylist, &key);
+  fail_unless(found != NULL && found->data == &num2);
+  fail_unless(ic_list_find(mylist, &key) == found, "second lookup should hit the cache");
+
+  /* the cached element no longer matches the key */
+  key = 3;
+  found = ic_list_find(mylist, &key);
+  fail_unless(found != NULL && found->data == &num3);
+
+  ic_list_remove(mylist, found);
+  fail_unless(ic_list_find(mylist, &key) == NULL);
+
+  ic_list_set_find_cache(mylist, false);
+  key = 1;
+  fail_unless(ic_list_find(mylist, &key) == mylist->head);
+
+  ic_list_free(mylist);
+}
+END_TEST
+
+/* concat */
+
+START_TEST (concat_should_move_all_elements_to_the_tail)
+{
+  int num1 = 1, num2 = 2, num3 = 3, num4 = 4;
+
+  ic_list *dst = ic_list_new();
+  ic_list *src = ic_list_new();
+  ic_list_append(dst, &num1);
+  ic_list_append(dst, &num2);
+  ic_list_append(src, &num3);
+  ic_list_append(src, &num4);
+
+  ic_list_concat(dst, src);
+
+  fail_unless(ic_list_length(dst) == 4);
+  fail_unless(ic_list_empty(src));
+  fail_unless(ic_list_length(src) == 0);
+  assert_list_elements(dst, &num1, &num2, &num3, &num4);
+  assert_list_bounds(dst);
+  fail_unless(ic_list_nth(dst, 2)->prev == ic_list_nth(dst, 1));
+
+  ic_list_free(dst);
+  ic_list_free(src);
+}
+END_TEST
+
+START_TEST (concat_into_empty_list)
+{
+  int num1 = 1;
+
+  ic_list *dst = ic_list_new();
+  ic_list *src = ic_list_new();
+  ic_list_append(src, &num1);
+
+  ic_list_concat(dst, src);
+  assert_list_has_only_one_element(dst, &num1, sizeof(int));
+  assert_list_bounds(dst);
+
+  ic_list_concat(dst, src);  /* empty source */
+  fail_unless(ic_list_length(dst) == 1);
+
+  ic_list_free(dst);
+  ic_list_free(src);
+}
+END_TEST
+
+/* compact */
+
+static void assert_contiguous(ic_list *l)
+{
+  ic_node *node;
+  for (node = l->head; node != l->tail; node = node->next)
+    fail_unless(node->next == node + 1, "nodes should be contiguous");
+}
+
+START_TEST (compact_should_keep_order_and_make_nodes_contiguous)
+{
+  int nums[6] = { 0, 1, 2, 3, 4, 5 };
+  ic_node *head;
+
+  ic_list *mylist = ic_list_new();
+  ic_list_append(mylist, &nums[2]);
+  ic_list_prepend(mylist, &nums[1]);
+  ic_list_append(mylist, &nums[3]);
+  ic_list_prepend(mylist, &nums[0]);
+  ic_list_append(mylist, &nums[4]);
+
+  ic_list_compact(mylist);
+  assert_list_elements(mylist, &nums[0], &nums[1], &nums[2], &nums[3], &nums[4]);
+  assert_list_bounds(mylist);
+  assert_contiguous(mylist);
+
+  head = mylist->head;
+  ic_list_compact(mylist);
+  fail_unless(mylist->head == head, "already compacted nodes should not move");
+
+  /* mixing nodes from the block with nodes allocated one by one */
+  ic_list_remove(mylist, ic_list_nth(mylist, 2));
+  ic_list_append(mylist, &nums[5]);
+  ic_list_remove(mylist, mylist->head);
+  assert_list_elements(mylist, &nums[1], &nums[3], &nums[4], &nums[5]);
+
+  ic_list_compact(mylist);
+  assert_list_elements(mylist, &nums[1], &nums[3], &nums[4], &nums[5]);
+  assert_contiguous(mylist);
+
+  while (!ic_list_empty(mylist))
+    ic_list_remove(mylist, mylist->tail);
+  fail_unless(mylist->head == NULL);
+
+  ic_list_free(mylist);
+}
+END_TEST
+
+START_TEST (compact_step_should_pack_a_bounded_number_of_nodes)
+{
+  intptr_t nums[10], key = 7;
+  ic_node *node;
+  size_t i, steps = 0;
+
+  ic_list *mylist = ic_list_new();
+  for (i = 0; i < 10; i++) {
+    nums[i] = i;
+    ic_list_append(mylist, &nums[i]);
+  }
+  ic_list_set_find_cache(mylist, true);
+  fail_unless(ic_list_find(mylist, &key) != NULL);
+
+  fail_unless(ic_list_compact_step(mylist, 4) == 4);
+  for (i = 0, node = mylist->head; i < 3; i++, node = node->next)
+    fail_unless(node->next == node + 1);
+  fail_unless(node->next != node + 1, "only the first 4 nodes should be packed");
+
+  /* unlinking the last packed node should not lose the position */
+  ic_list_remove(mylist, ic_list_nth(mylist, 3));
+
+  while (ic_list_compact_step(mylist, 4) > 0)
+    steps++;
+  fail_unless(steps == 2);
+  fail_unless(ic_list_length(mylist) == 9);
+  for (i = 0, node = mylist->head; node != NULL; i++, node = node->next)
+    fail_unless(*(intptr_t *)node->data == (intptr_t)(i < 3 ? i : i + 1));
+  assert_list_bounds(mylist);
+
+  /* the cache held a node that moved */
+  node = ic_list_find(mylist, &key);
+  fail_unless(node == ic_list_nth(mylist, 6));
+
+  ic_list_free(mylist);
+}
+END_TEST
+
+START_TEST (concat_should_move_compacted_nodes)
+{
+  int num1 = 1, num2 = 2, num3 = 3, num4 = 4;
+
+  ic_list *dst = ic_list_new();
+  ic_list *src = ic_list_new();
+  ic_list_append(dst, &num1);
+  ic_list_append(src, &num2);
+  ic_list_append(src, &num3);
+  ic_list_compact(src);
+  ic_list_append(src, &num4);
+
+  ic_list_concat(dst, src);
+  ic_list_free(src);
+
+  assert_list_elements(dst, &num1, &num2, &num3, &num4);
+  ic_list_remove(dst, ic_list_nth(dst, 1));
+  ic_list_compact(dst);
+  assert_list_elements(dst, &num1, &num3, &num4);
+  assert_contiguous(dst);
+
+  ic_list_free(dst);
+}
+END_TEST
+
+/* remove / unlink */
+
+START_TEST (remove_should_unlink_node_from_any_position)
+{
+  int num1 = 1, num2 = 2, num3 = 3, num4 = 4;
+
+  ic_list *mylist = ic_list_new();
+  ic_list_append(mylist, &num1);
+  ic_list_append(mylist, &num2);
+  ic_list_append(mylist, &num3);
+  ic_list_append(mylist, &num4);
+
+  ic_list_remove(mylist, ic_list_nth(mylist, 1));
+  assert_list_elements(mylist, &num1, &num3, &num4);
+  ic_list_remove(mylist, mylist->head);
+  ic_list_remove(mylist, mylist->tail);
+
+  assert_list_has_only_one_element(mylist, &num3, sizeof(int));
+  assert_list_bounds(mylist);
+
+  ic_list_remove(mylist, mylist->head);
+  fail_unless(ic_list_empty(mylist));
+  fail_unless(mylist->tail == NULL);
+
+  ic_list_free(mylist);
+}
+END_TEST
+
+START_TEST (unlink_and_link_tail_should_use_caller_nodes)
+{
+  int num1 = 1, num2 = 2;
+  ic_node node1, node2;
+  ic_list mylist;
+
+  ic_list_init(&mylist);
+  node1.data = &num1;
+  node2.data = &num2;
+  ic_list_link_tail(&mylist, &node1);
+  ic_list_link_tail(&mylist, &node2);
+  assert_list_elements(&mylist, &num1, &num2);
+
+  ic_list_unlink(&mylist, &node1);
+  ic_list_link_tail(&mylist, &node1);
+  assert_list_elements(&mylist, &num2, &num1);
+  assert_list_bounds(&mylist);
+}
+END_TEST
+
 
 Suite *ic_list_suite(void) {
   Suite *s = suite_create("list");
@@ -138,16 +445,37 @@ Suite *ic_list_suite(void) {
   tcase_add_test(tc_list, nth_should_return_element_data_at_that_position_or_NULL_if_out_of_bounds);
 
   tcase_add_test(tc_list, find_should_return_matched_element_or_NULL_if_not_found);
+  tcase_add_test(tc_list, find_with_move_to_front_should_move_matches_to_head);
+  tcase_add_test(tc_list, find_with_transpose_should_swap_matches_with_previous);
+  tcase_add_test(tc_list, find_cache_should_never_return_stale_nodes);
+  tcase_add_test(tc_list, find_cache_should_be_skipped_under_move_to_front);
+
+  tcase_add_test(tc_list, concat_should_move_all_elements_to_the_tail);
+  tcase_add_test(tc_list, concat_into_empty_list);
+
+  tcase_add_test(tc_list, compact_should_keep_order_and_make_nodes_contiguous);
+  tcase_add_test(tc_list, compact_step_should_pack_a_bounded_number_of_nodes);
+  tcase_add_test(tc_list, concat_should_move_compacted_nodes);
+
+  tcase_add_test(tc_list, remove_should_unlink_node_from_any_position);
+  tcase_add_test(tc_list, unlink_and_link_tail_should_use_caller_nodes);
 
   suite_add_tcase(s, tc_list);
 
   return s;
 }
 
+Suite *ic_sharded_list_suite(void);
+Suite *ic_skiplist_suite(void);
+Suite *ic_cache_suite(void);
+
 int main(void) {
   int nfailed;
   Suite *s = ic_list_suite();
   SRunner *sr = srunner_create(s);
+  srunner_add_suite(sr, ic_sharded_list_suite());
+  srunner_add_suite(sr, ic_skiplist_suite());
+  srunner_add_suite(sr, ic_cache_suite());
 
   srunner_run_all(sr, CK_NORMAL);
   nfailed = srunner_ntests_failed(sr);
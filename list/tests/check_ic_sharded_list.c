@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <check.h>
+#include "../src/ic_sharded_list.h"
+
+#define WRITERS 4
+#define PER_WRITER 10000
+
+static int values[WRITERS][PER_WRITER];
+static int next_row;
+
+static void *append_values(void *arg)
+{
+  ic_sharded_list *sl = arg;
+  int i, *row = values[__atomic_fetch_add(&next_row, 1, __ATOMIC_RELAXED)];
+
+  for (i = 0; i < PER_WRITER; i++) {
+    row[i] = i;
+    ic_sharded_list_append(sl, &row[i]);
+  }
+  return NULL;
+}
+
+START_TEST (sharded_list_should_collect_appends_from_all_threads)
+{
+  pthread_t writers[WRITERS];
+  int i, last[WRITERS];
+  ic_node *node;
+
+  ic_sharded_list *sl = ic_sharded_list_new(WRITERS);
+  ic_list *all = ic_list_new();
+
+  for (i = 0; i < WRITERS; i++)
+    pthread_create(&writers[i], NULL, append_values, sl);
+  for (i = 0; i < WRITERS; i++)
+    pthread_join(writers[i], NULL);
+
+  fail_unless(ic_sharded_list_length(sl) == WRITERS * PER_WRITER);
+
+  ic_sharded_list_drain(sl, all);
+  fail_unless(ic_sharded_list_length(sl) == 0);
+  fail_unless(ic_list_length(all) == WRITERS * PER_WRITER);
+
+  /* each thread's elements keep their order */
+  for (i = 0; i < WRITERS; i++)
+    last[i] = -1;
+  for (node = all->head; node != NULL; node = node->next) {
+    int *value = node->data;
+    int row = (value - &values[0][0]) / PER_WRITER;
+    fail_unless(*value > last[row], "elements from one thread out of order");
+    last[row] = *value;
+  }
+
+  ic_list_free(all);
+  ic_sharded_list_free(sl);
+}
+END_TEST
+
+START_TEST (sharded_list_free_should_release_undrained_elements)
+{
+  int num = 1;
+  ic_sharded_list *sl = ic_sharded_list_new(0);
+
+  fail_unless(sl->num_shards == 1);
+  ic_sharded_list_append(sl, &num);
+  ic_sharded_list_append(sl, &num);
+  fail_unless(ic_sharded_list_length(sl) == 2);
+
+  ic_sharded_list_free(sl);
+}
+END_TEST
+
+Suite *ic_sharded_list_suite(void) {
+  Suite *s = suite_create("sharded_list");
+  TCase *tc_sharded = tcase_create("sharded_list");
+
+  tcase_add_test(tc_sharded, sharded_list_should_collect_appends_from_all_threads);
+  tcase_add_test(tc_sharded, sharded_list_free_should_release_undrained_elements);
+
+  suite_add_tcase(s, tc_sharded);
+
+  return s;
+}
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <check.h>
+#include "../src/ic_skiplist.h"
+
+#define COUNT 1000
+
+static int compare_ints(const void *num1, const void *num2)
+{
+  if (*(int *)num1 > *(int *)num2) return  1;
+  if (*(int *)num1 < *(int *)num2) return -1;
+  return 0;
+}
+
+static void sum_ints(void *num, void *total)
+{
+  *(int *)total += *(int *)num;
+}
+
+static int nums[COUNT];
+
+static ic_skiplist * shuffled_skiplist(void)
+{
+  int i;
+  ic_skiplist *sl = ic_skiplist_new(compare_ints);
+
+  for (i = 0; i < COUNT; i++) {
+    nums[i] = (i * 7919) % COUNT;  /* every number from 0 to COUNT-1 */
+    ic_skiplist_insert(sl, &nums[i]);
+  }
+  return sl;
+}
+
+START_TEST (skiplist_should_iterate_in_order)
+{
+  ic_skipnode *node;
+  int expected = 0;
+
+  ic_skiplist *sl = shuffled_skiplist();
+  fail_unless(ic_skiplist_length(sl) == COUNT);
+
+  for (node = ic_skiplist_first(sl); node != NULL; node = ic_skiplist_next(node)) {
+    fail_unless(*(int *)node->data == expected, "out of order at %d", expected);
+    expected++;
+  }
+  fail_unless(expected == COUNT);
+
+  node = ic_skiplist_last(sl);
+  fail_unless(*(int *)node->data == COUNT - 1);
+  fail_unless(*(int *)ic_skiplist_prev(node)->data == COUNT - 2);
+  fail_unless(ic_skiplist_prev(ic_skiplist_first(sl)) == NULL);
+
+  ic_skiplist_free(sl);
+}
+END_TEST
+
+START_TEST (skiplist_find_and_lower_bound)
+{
+  int key = 500, missing = COUNT + 1, negative = -5;
+  ic_skipnode *node;
+
+  ic_skiplist *sl = shuffled_skiplist();
+
+  node = ic_skiplist_find(sl, &key);
+  fail_unless(node != NULL && *(int *)node->data == 500);
+  fail_unless(ic_skiplist_find(sl, &missing) == NULL);
+
+  node = ic_skiplist_lower_bound(sl, &negative);
+  fail_unless(node == ic_skiplist_first(sl));
+  fail_unless(ic_skiplist_lower_bound(sl, &missing) == NULL);
+
+  ic_skiplist_free(sl);
+}
+END_TEST
+
+START_TEST (skiplist_remove_should_unlink_element)
+{
+  int i, key, *removed;
+  ic_skipnode *node;
+
+  ic_skiplist *sl = shuffled_skiplist();
+
+  for (key = 0; key < COUNT; key += 2) {
+    removed = ic_skiplist_remove(sl, &key);
+    fail_unless(removed != NULL && *removed == key);
+  }
+  key = 0;
+  fail_unless(ic_skiplist_remove(sl, &key) == NULL);
+  fail_unless(ic_skiplist_length(sl) == COUNT / 2);
+
+  i = 1;
+  for (node = ic_skiplist_first(sl); node != NULL; node = ic_skiplist_next(node)) {
+    fail_unless(*(int *)node->data == i);
+    if (node->next[0] != NULL)
+      fail_unless(node->next[0]->prev == node);
+    i += 2;
+  }
+  fail_unless(*(int *)ic_skiplist_last(sl)->data == COUNT - 1);
+
+  /* removed nodes go back to the pool and are reused */
+  for (key = 0; key < COUNT; key += 2)
+    ic_skiplist_insert(sl, &nums[key]);
+  fail_unless(ic_skiplist_length(sl) == COUNT);
+
+  ic_skiplist_free(sl);
+}
+END_TEST
+
+START_TEST (skiplist_range_should_visit_inclusive_bounds)
+{
+  int low = 10, high = 20, total = 0;
+
+  ic_skiplist *sl = shuffled_skiplist();
+
+  fail_unless(ic_skiplist_range(sl, &low, &high, sum_ints, &total) == 11);
+  fail_unless(total == 165);
+
+  ic_skiplist_free(sl);
+}
+END_TEST
+
+START_TEST (skiplist_should_keep_duplicates_in_insertion_order)
+{
+  int a = 5, b = 5, c = 5, key = 5;
+
+  ic_skiplist *sl = ic_skiplist_new(compare_ints);
+  ic_skiplist_insert(sl, &a);
+  ic_skiplist_insert(sl, &b);
+  ic_skiplist_insert(sl, &c);
+
+  fail_unless(ic_skiplist_find(sl, &key)->data == &a);
+  fail_unless(ic_skiplist_last(sl)->data == &c);
+  fail_unless(ic_skiplist_remove(sl, &key) == &a);
+  fail_unless(ic_skiplist_first(sl)->data == &b);
+
+  ic_skiplist_free(sl);
+}
+END_TEST
+
+Suite *ic_skiplist_suite(void) {
+  Suite *s = suite_create("skiplist");
+  TCase *tc_skiplist = tcase_create("skiplist");
+
+  tcase_add_test(tc_skiplist, skiplist_should_iterate_in_order);
+  tcase_add_test(tc_skiplist, skiplist_find_and_lower_bound);
+  tcase_add_test(tc_skiplist, skiplist_remove_should_unlink_element);
+  tcase_add_test(tc_skiplist, skiplist_range_should_visit_inclusive_bounds);
+  tcase_add_test(tc_skiplist, skiplist_should_keep_duplicates_in_insertion_order);
+
+  suite_add_tcase(s, tc_skiplist);
+
+  return s;
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/ic_list.h"
+
+/*
+ * Traversal of an ic_list whose nodes are scattered over the heap, before
+ * and after ic_list_compact(), against one built on a fresh heap
+ */
+
+#define SIZES 3
+#define WALKS 20
+
+static double elapsed(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double walk(ic_list *l)
+{
+  clock_t start = clock();
+  volatile long sum = 0;
+  ic_node *node;
+  int w;
+
+  for (w = 0; w < WALKS; w++)
+    for (node = l->head; node != NULL; node = node->next)
+      sum += *(int *)node->data;
+  return elapsed(start);
+}
+
+/*
+ * Leaves the heap the way hours of churn would: node sized chunks freed in
+ * random order, which the next mallocs hand out again one by one. Freeing
+ * something big makes malloc merge them back, so ``chunks`` is kept until
+ * the measure is done.
+ */
+static void fragment_heap(void **chunks, int n)
+{
+  int i, j;
+
+  for (i = 0; i < n; i++)
+    chunks[i] = malloc(sizeof(ic_node));
+  for (i = n - 1; i > 0; i--) {
+    void *tmp = chunks[i];
+    j = rand() % (i + 1);
+    chunks[i] = chunks[j];
+    chunks[j] = tmp;
+  }
+  for (i = 0; i < n; i++)
+    free(chunks[i]);
+}
+
+static ic_list * build(int *values, int n)
+{
+  ic_list *l = ic_list_new();
+  int i;
+
+  for (i = 0; i < n; i++)
+    ic_list_append(l, &values[i]);
+  return l;
+}
+
+int main(void)
+{
+  int sizes[SIZES] = { 100000, 1000000, 4000000 };
+  int s, i, *values;
+  void **chunks;
+
+  printf("%10s %14s %14s %14s %14s\n", "elements", "fresh (s)", "scattered (s)",
+         "compacted (s)", "compact (s)");
+
+  for (s = 0; s < SIZES; s++) {
+    int n = sizes[s];
+    double t_fresh, t_scattered, t_compacted, t_compact;
+    clock_t start;
+
+    values = malloc(n * sizeof(int));
+    chunks = malloc(n * sizeof(void *));
+    srand(42);
+
+    for (i = 0; i < n; i++)
+      values[i] = i;
+
+    ic_list *l = build(values, n);
+    t_fresh = walk(l);
+    ic_list_free(l);
+
+    fragment_heap(chunks, n);
+    l = build(values, n);
+    t_scattered = walk(l);
+
+    start = clock();
+    ic_list_compact(l);
+    t_compact = elapsed(start);
+    t_compacted = walk(l);
+
+    printf("%10d %14.4f %14.4f %14.4f %14.4f\n", n, t_fresh, t_scattered,
+           t_compacted, t_compact);
+
+    ic_list_free(l);
+    free(chunks);
+    free(values);
+  }
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/ic_skiplist.h"
+#include "../../vector/src/vector.h"
+
+/*
+ * Ordered inserts of random keys: ic_skiplist against a sorted vector kept
+ * in order with a binary search plus vector_insert
+ */
+
+#define SIZES 4
+
+static int compare_ints(const void *num1, const void *num2)
+{
+  if (*(int *)num1 > *(int *)num2) return  1;
+  if (*(int *)num1 < *(int *)num2) return -1;
+  return 0;
+}
+
+static int lower_bound(vector *v, int key)
+{
+  int lo = 0, hi = vector_length(v);
+
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (*(int *)vector_get(v, mid) < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static double elapsed(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void)
+{
+  int sizes[SIZES] = { 10000, 50000, 100000, 200000 };
+  int s, i, *keys;
+
+  printf("%10s %14s %14s\n", "inserts", "skiplist (s)", "vector (s)");
+
+  for (s = 0; s < SIZES; s++) {
+    int n = sizes[s];
+    clock_t start;
+    double t_skiplist, t_vector;
+
+    keys = malloc(n * sizeof(int));
+    srand(42);
+    for (i = 0; i < n; i++)
+      keys[i] = rand();
+
+    start = clock();
+    ic_skiplist *sl = ic_skiplist_new(compare_ints);
+    for (i = 0; i < n; i++)
+      ic_skiplist_insert(sl, &keys[i]);
+    t_skiplist = elapsed(start);
+
+    start = clock();
+    vector *v = vector_new(sizeof(int), NULL, 1024);
+    for (i = 0; i < n; i++)
+      vector_insert(v, &keys[i], lower_bound(v, keys[i]));
+    t_vector = elapsed(start);
+
+    printf("%10d %14.4f %14.4f\n", n, t_skiplist, t_vector);
+
+    ic_skiplist_free(sl);
+    vector_free(v);
+    free(keys);
+  }
+
+  return 0;
+}
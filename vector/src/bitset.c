@@ -0,0 +1,284 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bitset.h"
+
+/*
+ * Bits past the length, in the last word and in the spare words, are kept
+ * clear: counting and searching can then work on whole words.
+ */
+#define WORD_BITS 64
+#define WORDS(bits) (((bits) + WORD_BITS - 1) / WORD_BITS)
+#define BIT(position) ((uint64_t)1 << ((position) % WORD_BITS))
+
+/* words per block of the rank index */
+#define RANK_BLOCK 8
+
+static inline int
+popcount(uint64_t x)
+{
+#ifdef __GNUC__
+  return __builtin_popcountll(x);
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* index of the lowest set bit, ``x`` must not be 0 */
+static inline int
+lowest_bit(uint64_t x)
+{
+#ifdef __GNUC__
+  return __builtin_ctzll(x);
+#else
+  int i = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
+bitset *
+bitset_new(size_t length)
+{
+  bitset *b = malloc(sizeof(bitset));
+
+  b->length = length;
+  b->alloc_words = WORDS(length) > 0 ? WORDS(length) : 1;
+  b->words = calloc(b->alloc_words, sizeof(uint64_t));
+  b->rank_index = NULL;
+  b->index_valid = false;
+  return b;
+}
+
+size_t
+bitset_length(const bitset *b)
+{
+  return b->length;
+}
+
+/* clears the bits of the last word past the length */
+static void
+mask_tail(bitset *b)
+{
+  if (b->length % WORD_BITS != 0)
+    b->words[b->length / WORD_BITS] &= BIT(b->length) - 1;
+}
+
+void
+bitset_resize(bitset *b, size_t length)
+{
+  size_t words = WORDS(length);
+
+  if (words > b->alloc_words) {
+    size_t alloc_words = b->alloc_words * 2 > words ? b->alloc_words * 2 : words;
+    b->words = realloc(b->words, alloc_words * sizeof(uint64_t));
+    memset(b->words + b->alloc_words, 0, (alloc_words - b->alloc_words) * sizeof(uint64_t));
+    b->alloc_words = alloc_words;
+  } else if (length < b->length) {
+    memset(b->words + words, 0, (WORDS(b->length) - words) * sizeof(uint64_t));
+  }
+
+  b->length = length;
+  mask_tail(b);
+  b->index_valid = false;
+}
+
+void
+bitset_set(bitset *b, size_t position)
+{
+  b->words[position / WORD_BITS] |= BIT(position);
+  b->index_valid = false;
+}
+
+void
+bitset_clear(bitset *b, size_t position)
+{
+  b->words[position / WORD_BITS] &= ~BIT(position);
+  b->index_valid = false;
+}
+
+bool
+bitset_test(const bitset *b, size_t position)
+{
+  return (b->words[position / WORD_BITS] & BIT(position)) != 0;
+}
+
+void
+bitset_fill(bitset *b, bool value)
+{
+  memset(b->words, value ? 0xff : 0, WORDS(b->length) * sizeof(uint64_t));
+  mask_tail(b);
+  b->index_valid = false;
+}
+
+static size_t
+common_words(const bitset *dst, const bitset *src)
+{
+  size_t dst_words = WORDS(dst->length), src_words = WORDS(src->length);
+  return dst_words < src_words ? dst_words : src_words;
+}
+
+void
+bitset_and(bitset *dst, const bitset *src)
+{
+  uint64_t *d = dst->words;
+  const uint64_t *s = src->words;
+  size_t i, n = common_words(dst, src);
+
+  for (i = 0; i < n; i++)
+    d[i] &= s[i];
+  memset(d + n, 0, (WORDS(dst->length) - n) * sizeof(uint64_t));
+  dst->index_valid = false;
+}
+
+void
+bitset_or(bitset *dst, const bitset *src)
+{
+  uint64_t *d = dst->words;
+  const uint64_t *s = src->words;
+  size_t i, n = common_words(dst, src);
+
+  for (i = 0; i < n; i++)
+    d[i] |= s[i];
+  mask_tail(dst);
+  dst->index_valid = false;
+}
+
+void
+bitset_xor(bitset *dst, const bitset *src)
+{
+  uint64_t *d = dst->words;
+  const uint64_t *s = src->words;
+  size_t i, n = common_words(dst, src);
+
+  for (i = 0; i < n; i++)
+    d[i] ^= s[i];
+  mask_tail(dst);
+  dst->index_valid = false;
+}
+
+void
+bitset_andnot(bitset *dst, const bitset *src)
+{
+  uint64_t *d = dst->words;
+  const uint64_t *s = src->words;
+  size_t i, n = common_words(dst, src);
+
+  for (i = 0; i < n; i++)
+    d[i] &= ~s[i];
+  dst->index_valid = false;
+}
+
+size_t
+bitset_count(const bitset *b)
+{
+  size_t i, count = 0, n = WORDS(b->length);
+
+  for (i = 0; i < n; i++)
+    count += popcount(b->words[i]);
+  return count;
+}
+
+size_t
+bitset_next_set(const bitset *b, size_t from)
+{
+  size_t i, n = WORDS(b->length);
+  uint64_t word;
+
+  if (from >= b->length)
+    return BITSET_NONE;
+
+  i = from / WORD_BITS;
+  word = b->words[i] & ~(BIT(from) - 1);
+  while (word == 0) {
+    if (++i == n)
+      return BITSET_NONE;
+    word = b->words[i];
+  }
+  return i * WORD_BITS + lowest_bit(word);
+}
+
+/* rank_index[k] is the number of set bits before block k */
+static void
+build_index(bitset *b)
+{
+  size_t n = WORDS(b->length), blocks = (n + RANK_BLOCK - 1) / RANK_BLOCK;
+  size_t i, count = 0;
+
+  b->rank_index = realloc(b->rank_index, (blocks + 1) * sizeof(size_t));
+  for (i = 0; i < n; i++) {
+    if (i % RANK_BLOCK == 0)
+      b->rank_index[i / RANK_BLOCK] = count;
+    count += popcount(b->words[i]);
+  }
+  b->rank_index[blocks] = count;
+  b->index_valid = true;
+}
+
+size_t
+bitset_rank(bitset *b, size_t position)
+{
+  size_t i, word = position / WORD_BITS, count;
+
+  if (!b->index_valid)
+    build_index(b);
+
+  count = b->rank_index[word / RANK_BLOCK];
+  for (i = word - word % RANK_BLOCK; i < word; i++)
+    count += popcount(b->words[i]);
+  if (position % WORD_BITS != 0)
+    count += popcount(b->words[word] & (BIT(position) - 1));
+  return count;
+}
+
+size_t
+bitset_select(bitset *b, size_t rank)
+{
+  size_t blocks, low, high, i;
+  uint64_t word;
+  int count;
+
+  if (!b->index_valid)
+    build_index(b);
+
+  blocks = (WORDS(b->length) + RANK_BLOCK - 1) / RANK_BLOCK;
+  if (rank >= b->rank_index[blocks])
+    return BITSET_NONE;
+
+  /* last block starting with at most ``rank`` set bits before it */
+  low = 0;
+  high = blocks - 1;
+  while (low < high) {
+    size_t middle = low + (high - low + 1) / 2;
+    if (b->rank_index[middle] <= rank)
+      low = middle;
+    else
+      high = middle - 1;
+  }
+
+  rank -= b->rank_index[low];
+  for (i = low * RANK_BLOCK; ; i++) {
+    count = popcount(b->words[i]);
+    if (rank < (size_t)count)
+      break;
+    rank -= count;
+  }
+
+  word = b->words[i];
+  while (rank-- > 0)
+    word &= word - 1;
+  return i * WORD_BITS + lowest_bit(word);
+}
+
+void
+bitset_free(bitset *b)
+{
+  free(b->rank_index);
+  free(b->words);
+  free(b);
+}
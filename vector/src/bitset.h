@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Bitset
+ *
+ * A fixed-length array of bits packed in 64-bit words, for boolean flags
+ * that would otherwise take a whole ``int`` element each in a vector.
+ *
+ * Bulk operations work a word at a time in loops simple enough for the
+ * compiler to vectorize, and counting uses the popcount instruction when
+ * the compiler provides it.
+ *
+ * ``bitset_rank`` and ``bitset_select`` use an index with the number of set
+ * bits before every block of 512 bits. It is built by the first call after
+ * the bits changed, so bitsets that never use them pay nothing.
+ */
+
+#ifndef _BITSET
+#define _BITSET
+
+/* returned by bitset_next_set and bitset_select when there's no such bit */
+#define BITSET_NONE ((size_t)-1)
+
+/**
+ * Type: bitset
+ *
+ * Defines the concrete representation of the bitset.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  uint64_t *words;
+  size_t length;
+  size_t alloc_words;
+  size_t *rank_index;
+  bool index_valid;
+} bitset;
+
+
+/**
+ * Function: bitset_new
+ * Usage: bitset *seen = bitset_new(vector_length(v));
+ *
+ * Constructs a bitset of ``length`` bits, all of them clear.
+ *
+ * Note that the call to ``bitset_free`` is mandatory
+ *
+ */
+bitset *bitset_new(size_t length);
+
+/**
+ * Function: bitset_length
+ *
+ * Returns
+ *
+ *  The number of bits in the bitset.
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t bitset_length(const bitset *b);
+
+/**
+ * Function: bitset_resize
+ *
+ * Changes the number of bits. Bits added at the end are clear. Storage
+ * grows geometrically, so growing one bit at a time is cheap.
+ *
+ * Complexity: O(1) amortized when growing by few bits
+ *
+ */
+void bitset_resize(bitset *b, size_t length);
+
+/**
+ * Function: bitset_set / bitset_clear / bitset_test
+ *
+ * Sets, clears or tests the bit at ``position``, which must be lower than
+ * the length of the bitset.
+ *
+ * Complexity: O(1)
+ *
+ */
+void bitset_set(bitset *b, size_t position);
+void bitset_clear(bitset *b, size_t position);
+bool bitset_test(const bitset *b, size_t position);
+
+/**
+ * Function: bitset_fill
+ *
+ * Sets all the bits to ``value``.
+ *
+ * Complexity: O(n)
+ *
+ */
+void bitset_fill(bitset *b, bool value);
+
+/**
+ * Function: bitset_and / bitset_or / bitset_xor / bitset_andnot
+ *
+ * Combine ``src`` into ``dst`` bit by bit (``dst & ~src`` for andnot). If
+ * the lengths differ ``src`` is taken as truncated or extended with clear
+ * bits to the length of ``dst``.
+ *
+ * Complexity: O(n)
+ *
+ */
+void bitset_and(bitset *dst, const bitset *src);
+void bitset_or(bitset *dst, const bitset *src);
+void bitset_xor(bitset *dst, const bitset *src);
+void bitset_andnot(bitset *dst, const bitset *src);
+
+/**
+ * Function: bitset_count
+ *
+ * Returns
+ *
+ *  The number of set bits.
+ *
+ * Complexity: O(n)
+ *
+ */
+size_t bitset_count(const bitset *b);
+
+/**
+ * Function: bitset_next_set
+ * Usage: for (i = bitset_next_set(b, 0); i != BITSET_NONE; i = bitset_next_set(b, i + 1))
+ *
+ * Returns
+ *
+ *  The position of the first set bit at or after ``from``, BITSET_NONE if
+ *  there's none.
+ *
+ * Complexity: O(n) worst case, skipping 64 clear bits per step
+ *
+ */
+size_t bitset_next_set(const bitset *b, size_t from);
+
+/**
+ * Function: bitset_rank
+ *
+ * Returns
+ *
+ *  The number of set bits before ``position``, which may be up to the
+ *  length of the bitset.
+ *
+ * Complexity: O(1) once the index is built
+ *
+ */
+size_t bitset_rank(bitset *b, size_t position);
+
+/**
+ * Function: bitset_select
+ *
+ * Returns
+ *
+ *  The position of the set bit of rank ``rank`` (the first one is rank 0),
+ *  BITSET_NONE if there are not that many set bits.
+ *
+ * Complexity: O(log n) once the index is built
+ *
+ */
+size_t bitset_select(bitset *b, size_t rank);
+
+/**
+ * Function: bitset_free
+ *
+ * Frees up all the memory of the bitset.
+ *
+ */
+void bitset_free(bitset *b);
+
+#endif
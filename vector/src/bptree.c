@@ -0,0 +1,434 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bptree.h"
+
+/*
+ * Node layout: the bptree_node header, then the keys, then the values (in
+ * leaves) or the child pointers (in inner nodes). Every node has room for
+ * one key more than its capacity, so insertion can always go in place and
+ * the overflowing node is split afterwards.
+ */
+#define KEYS_OFFSET ((sizeof(bptree_node) + 7) & ~(size_t)7)
+#define KEY_AT(t, n, i) ((char *)(n) + KEYS_OFFSET + (size_t)(i) * (t)->key_size)
+#define VALUE_AT(t, n, i) ((char *)(n) + (t)->values_offset + (size_t)(i) * (t)->value_size)
+#define CHILDREN(t, n) ((bptree_node **)((char *)(n) + (t)->children_offset))
+
+#define MIN_CAPACITY 3
+
+static size_t
+align_up(size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+static int
+capacity(size_t node_bytes, size_t slot_size)
+{
+  size_t cap = 0;
+
+  if (node_bytes > KEYS_OFFSET)
+    cap = (node_bytes - KEYS_OFFSET) / slot_size;
+  return cap < MIN_CAPACITY ? MIN_CAPACITY : (int)cap;
+}
+
+bptree *
+bptree_new(size_t key_size, size_t value_size, vector_cmp_func cmp_func, size_t node_bytes)
+{
+  if (key_size == 0 || cmp_func == NULL)
+    return NULL;
+
+  if (node_bytes == 0)
+    node_bytes = BPTREE_NODE_BYTES;
+
+  bptree *t = malloc(sizeof(bptree));
+  t->key_size = key_size;
+  t->value_size = value_size;
+  t->cmp_func = cmp_func;
+  t->length = 0;
+
+  t->leaf_capacity = capacity(node_bytes, key_size + value_size);
+  t->inner_capacity = capacity(node_bytes, key_size + sizeof(bptree_node *));
+  t->values_offset = align_up(KEYS_OFFSET + (t->leaf_capacity + 1) * key_size);
+  t->children_offset = align_up(KEYS_OFFSET + (t->inner_capacity + 1) * key_size);
+
+  t->root = NULL;
+  return t;
+}
+
+static bptree_node *
+node_new(bptree *t, bool leaf)
+{
+  size_t size;
+  bptree_node *n;
+
+  if (leaf)
+    size = t->values_offset + (t->leaf_capacity + 1) * t->value_size;
+  else
+    size = t->children_offset + (t->inner_capacity + 2) * sizeof(bptree_node *);
+
+  n = malloc(size);
+  n->next = NULL;
+  n->count = 0;
+  n->leaf = leaf;
+  return n;
+}
+
+size_t
+bptree_length(const bptree *t)
+{
+  return t->length;
+}
+
+/*
+ * Index of the first key in ``n`` greater than ``key`` (or greater or equal
+ * when ``!upper``).
+ */
+static int
+search_node(const bptree *t, const bptree_node *n, const void *key, bool upper)
+{
+  int low = 0, high = n->count;
+
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    int cmp = t->cmp_func(KEY_AT(t, n, middle), key);
+    if (cmp < 0 || (upper && cmp == 0))
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+/*
+ * Separators are the first key of their right subtree, so keys equal to a
+ * separator are searched on its right.
+ */
+static bptree_node *
+find_leaf(const bptree *t, const void *key)
+{
+  bptree_node *n = t->root;
+
+  while (n != NULL && !n->leaf)
+    n = CHILDREN(t, n)[search_node(t, n, key, true)];
+  return n;
+}
+
+static void
+leaf_insert_at(bptree *t, bptree_node *n, int i, const void *key, const void *value)
+{
+  int after = n->count - i;
+
+  memmove(KEY_AT(t, n, i + 1), KEY_AT(t, n, i), after * t->key_size);
+  memmove(VALUE_AT(t, n, i + 1), VALUE_AT(t, n, i), after * t->value_size);
+  memcpy(KEY_AT(t, n, i), key, t->key_size);
+  if (t->value_size > 0)
+    memcpy(VALUE_AT(t, n, i), value, t->value_size);
+  n->count++;
+}
+
+static void
+inner_insert_at(bptree *t, bptree_node *n, int i, const void *key, bptree_node *right)
+{
+  bptree_node **children = CHILDREN(t, n);
+
+  memmove(KEY_AT(t, n, i + 1), KEY_AT(t, n, i), (n->count - i) * t->key_size);
+  memmove(&children[i + 2], &children[i + 1], (n->count - i) * sizeof(bptree_node *));
+  memcpy(KEY_AT(t, n, i), key, t->key_size);
+  children[i + 1] = right;
+  n->count++;
+}
+
+/* moves the upper half of an overflowing leaf to a new right sibling */
+static bptree_node *
+split_leaf(bptree *t, bptree_node *n, void *up_key)
+{
+  bptree_node *right = node_new(t, true);
+  int middle = n->count / 2;
+
+  right->count = n->count - middle;
+  memcpy(KEY_AT(t, right, 0), KEY_AT(t, n, middle), right->count * t->key_size);
+  memcpy(VALUE_AT(t, right, 0), VALUE_AT(t, n, middle), right->count * t->value_size);
+  n->count = middle;
+
+  right->next = n->next;
+  n->next = right;
+  memcpy(up_key, KEY_AT(t, right, 0), t->key_size);
+  return right;
+}
+
+/* the middle key of an overflowing inner node moves up to the parent */
+static bptree_node *
+split_inner(bptree *t, bptree_node *n, void *up_key)
+{
+  bptree_node *right = node_new(t, false);
+  int middle = n->count / 2;
+
+  right->count = n->count - middle - 1;
+  memcpy(up_key, KEY_AT(t, n, middle), t->key_size);
+  memcpy(KEY_AT(t, right, 0), KEY_AT(t, n, middle + 1), right->count * t->key_size);
+  memcpy(CHILDREN(t, right), &CHILDREN(t, n)[middle + 1],
+         (right->count + 1) * sizeof(bptree_node *));
+  n->count = middle;
+  return right;
+}
+
+/*
+ * Inserts below ``n``. When ``n`` splits, returns its new right sibling and
+ * stores in ``up_key`` the separator to add to the parent.
+ */
+static bptree_node *
+insert_rec(bptree *t, bptree_node *n, const void *key, const void *value,
+           void *up_key, bool *added)
+{
+  bptree_node *right;
+  int i;
+
+  if (n->leaf) {
+    i = search_node(t, n, key, false);
+    if (i < n->count && t->cmp_func(KEY_AT(t, n, i), key) == 0) {
+      if (t->value_size > 0)
+        memcpy(VALUE_AT(t, n, i), value, t->value_size);
+      *added = false;
+      return NULL;
+    }
+    leaf_insert_at(t, n, i, key, value);
+    *added = true;
+    return n->count > t->leaf_capacity ? split_leaf(t, n, up_key) : NULL;
+  }
+
+  i = search_node(t, n, key, true);
+  right = insert_rec(t, CHILDREN(t, n)[i], key, value, up_key, added);
+  if (right == NULL)
+    return NULL;
+
+  inner_insert_at(t, n, i, up_key, right);
+  return n->count > t->inner_capacity ? split_inner(t, n, up_key) : NULL;
+}
+
+bool
+bptree_insert(bptree *t, const void *key, const void *value)
+{
+  char up_key[t->key_size];
+  bptree_node *right;
+  bool added;
+
+  if (t->root == NULL)
+    t->root = node_new(t, true);
+
+  right = insert_rec(t, t->root, key, value, up_key, &added);
+  if (right != NULL) {
+    bptree_node *root = node_new(t, false);
+    memcpy(KEY_AT(t, root, 0), up_key, t->key_size);
+    CHILDREN(t, root)[0] = t->root;
+    CHILDREN(t, root)[1] = right;
+    root->count = 1;
+    t->root = root;
+  }
+
+  if (added)
+    t->length++;
+  return added;
+}
+
+void *
+bptree_find(const bptree *t, const void *key)
+{
+  bptree_node *leaf = find_leaf(t, key);
+  int i;
+
+  if (leaf == NULL)
+    return NULL;
+
+  i = search_node(t, leaf, key, false);
+  if (i < leaf->count && t->cmp_func(KEY_AT(t, leaf, i), key) == 0)
+    return VALUE_AT(t, leaf, i);
+  return NULL;
+}
+
+bool
+bptree_remove(bptree *t, const void *key)
+{
+  bptree_node *leaf = find_leaf(t, key);
+  int i, after;
+
+  if (leaf == NULL)
+    return false;
+
+  i = search_node(t, leaf, key, false);
+  if (i == leaf->count || t->cmp_func(KEY_AT(t, leaf, i), key) != 0)
+    return false;
+
+  after = leaf->count - i - 1;
+  memmove(KEY_AT(t, leaf, i), KEY_AT(t, leaf, i + 1), after * t->key_size);
+  memmove(VALUE_AT(t, leaf, i), VALUE_AT(t, leaf, i + 1), after * t->value_size);
+  leaf->count--;
+  t->length--;
+  return true;
+}
+
+/* moves past the end of emptied leaves */
+static bool
+settle(bptree_iter *it)
+{
+  while (it->leaf != NULL && it->position >= it->leaf->count) {
+    it->leaf = it->leaf->next;
+    it->position = 0;
+  }
+  return it->leaf != NULL;
+}
+
+bool
+bptree_first(const bptree *t, bptree_iter *it)
+{
+  bptree_node *n = t->root;
+
+  while (n != NULL && !n->leaf)
+    n = CHILDREN(t, n)[0];
+
+  it->tree = t;
+  it->leaf = n;
+  it->position = 0;
+  return settle(it);
+}
+
+bool
+bptree_seek(const bptree *t, const void *key, bptree_iter *it)
+{
+  it->tree = t;
+  it->leaf = find_leaf(t, key);
+  it->position = it->leaf != NULL ? search_node(t, it->leaf, key, false) : 0;
+  return settle(it);
+}
+
+bool
+bptree_next(bptree_iter *it)
+{
+  if (it->leaf == NULL)
+    return false;
+
+  it->position++;
+  return settle(it);
+}
+
+void *
+bptree_iter_key(const bptree_iter *it)
+{
+  return KEY_AT(it->tree, it->leaf, it->position);
+}
+
+void *
+bptree_iter_value(const bptree_iter *it)
+{
+  return VALUE_AT(it->tree, it->leaf, it->position);
+}
+
+/*
+ * Splits ``total`` items evenly into ``nodes`` groups; returns the size of
+ * group ``i``.
+ */
+static size_t
+share(size_t total, size_t nodes, size_t i)
+{
+  return total / nodes + (i < total % nodes ? 1 : 0);
+}
+
+bptree *
+bptree_from_vector(const vector *v, size_t key_size, vector_cmp_func cmp_func,
+                   size_t node_bytes)
+{
+  bptree *t;
+  bptree_node **level;
+  void **low_keys;
+  size_t count, nodes, i, j, pos = 0;
+
+  if (v->elem_size < key_size)
+    return NULL;
+
+  t = bptree_new(key_size, v->elem_size - key_size, cmp_func, node_bytes);
+  if (t == NULL || v->length == 0)
+    return t;
+
+  /* leaves, filled to capacity and chained */
+  count = (v->length + t->leaf_capacity - 1) / t->leaf_capacity;
+  level = malloc(count * sizeof(bptree_node *));
+  low_keys = malloc(count * sizeof(void *));
+
+  for (i = 0; i < count; i++) {
+    bptree_node *leaf = node_new(t, true);
+    leaf->count = (int)share(v->length, count, i);
+    for (j = 0; j < (size_t)leaf->count; j++, pos++) {
+      char *elem = (char *)v->elems + pos * v->elem_size;
+      memcpy(KEY_AT(t, leaf, j), elem, key_size);
+      memcpy(VALUE_AT(t, leaf, j), elem + key_size, t->value_size);
+    }
+    if (i > 0)
+      level[i - 1]->next = leaf;
+    level[i] = leaf;
+    low_keys[i] = KEY_AT(t, leaf, 0);
+  }
+
+  /* inner levels, until a single root is left */
+  while (count > 1) {
+    nodes = (count + t->inner_capacity) / (t->inner_capacity + 1);
+    pos = 0;
+    for (i = 0; i < nodes; i++) {
+      bptree_node *n = node_new(t, false);
+      size_t children = share(count, nodes, i);
+
+      for (j = 0; j < children; j++) {
+        CHILDREN(t, n)[j] = level[pos + j];
+        if (j > 0)
+          memcpy(KEY_AT(t, n, j - 1), low_keys[pos + j], key_size);
+      }
+      n->count = (int)children - 1;
+      level[i] = n;
+      low_keys[i] = low_keys[pos];
+      pos += children;
+    }
+    count = nodes;
+  }
+
+  t->root = level[0];
+  t->length = v->length;
+  free(low_keys);
+  free(level);
+  return t;
+}
+
+vector *
+bptree_to_vector(const bptree *t)
+{
+  size_t elem_size = t->key_size + t->value_size;
+  vector *v = vector_new_flags(elem_size, NULL, VECTOR_GROWTH_STEP, VECT_NO_ZERO);
+  bptree_iter it;
+  bool more;
+
+  vector_reserve(v, t->length);
+
+  for (more = bptree_first(t, &it); more; more = bptree_next(&it)) {
+    char *elem = vector_append_uninit(v, 1);
+    memcpy(elem, bptree_iter_key(&it), t->key_size);
+    memcpy(elem + t->key_size, bptree_iter_value(&it), t->value_size);
+  }
+  return v;
+}
+
+static void
+free_node(bptree *t, bptree_node *n)
+{
+  int i;
+
+  if (!n->leaf) {
+    for (i = 0; i <= n->count; i++)
+      free_node(t, CHILDREN(t, n)[i]);
+  }
+  free(n);
+}
+
+void
+bptree_free(bptree *t)
+{
+  if (t->root != NULL)
+    free_node(t, t->root);
+  free(t);
+}
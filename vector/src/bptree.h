@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "vector.h"
+
+/**
+ * B+-tree
+ *
+ * An ordered map with fixed-size keys and values stored inline in the
+ * nodes, for large sorted datasets that would be too slow to keep in a
+ * sorted vector (each ``vector_insert`` moves half of the array on average).
+ *
+ * Nodes are sized to ``node_bytes`` (e.g. a few cache lines or a page), so
+ * a lookup touches one node per level and scans within a node are over
+ * contiguous keys. All the records live in the leaves, which are linked in
+ * key order for range iteration.
+ *
+ * Sorted vectors can be bulk loaded into a tree, and trees exported back
+ * into vectors. In both cases a vector element is the key immediately
+ * followed by the value.
+ */
+
+#ifndef _BPTREE
+#define _BPTREE
+
+/* default node size, one page */
+#define BPTREE_NODE_BYTES 4096
+
+typedef struct bptree_node {
+  struct bptree_node *next;
+  int count;
+  bool leaf;
+} bptree_node;
+
+/**
+ * Type: bptree
+ *
+ * Defines the concrete representation of the tree.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  bptree_node *root;
+  size_t key_size;
+  size_t value_size;
+  size_t values_offset;
+  size_t children_offset;
+  int leaf_capacity;
+  int inner_capacity;
+  size_t length;
+  vector_cmp_func cmp_func;
+} bptree;
+
+/**
+ * Type: bptree_iter
+ *
+ * Position of an iteration over the records, in key order. Obtained with
+ * ``bptree_first`` or ``bptree_seek``.
+ */
+typedef struct {
+  const bptree *tree;
+  bptree_node *leaf;
+  int position;
+} bptree_iter;
+
+
+/**
+ * Function: bptree_new
+ * Usage: bptree *index = bptree_new(sizeof(long), sizeof(off_t), compare_longs, 0);
+ *
+ * Constructs an empty tree.
+ *
+ * Parameters
+ *
+ * ``key_size``, ``value_size``
+ *   size in bytes of keys and values. ``value_size`` may be 0 for a set.
+ *
+ * ``cmp_func``
+ *   compares two keys
+ *
+ * ``node_bytes``
+ *   approximate size of each node; it determines how many keys a node
+ *   holds (at least 3). 0 selects BPTREE_NODE_BYTES.
+ *
+ * Returns
+ *
+ *   a bptree * on success
+ *   NULL if ``key_size`` is 0 (zero) or ``cmp_func`` is NULL
+ *
+ * Note that the call to ``bptree_free`` is mandatory
+ *
+ */
+bptree *bptree_new(size_t key_size, size_t value_size, vector_cmp_func cmp_func,
+                   size_t node_bytes);
+
+/**
+ * Function: bptree_from_vector
+ *
+ * Builds a tree from a vector of records sorted by key, with no duplicated
+ * keys. Each element is a key of ``key_size`` bytes followed by its value
+ * (the rest of the element). Elements of exactly ``key_size`` bytes build a
+ * tree with no values, as ``bptree_new`` with a ``value_size`` of 0. Nodes
+ * are filled bottom up, which is much faster than inserting one record at a
+ * time.
+ *
+ * Returns
+ *
+ *   a bptree * on success
+ *   NULL if the element size is less than ``key_size``, or like
+ *   ``bptree_new``
+ *
+ * Complexity: O(n)
+ *
+ */
+bptree *bptree_from_vector(const vector *v, size_t key_size, vector_cmp_func cmp_func,
+                           size_t node_bytes);
+
+/**
+ * Function: bptree_to_vector
+ *
+ * Returns a new vector with all the records in key order, each element
+ * being the key followed by the value.
+ *
+ * Complexity: O(n)
+ *
+ */
+vector *bptree_to_vector(const bptree *t);
+
+/**
+ * Function: bptree_length
+ *
+ * Returns
+ *
+ *  The number of records in the tree.
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t bptree_length(const bptree *t);
+
+/**
+ * Function: bptree_insert
+ *
+ * Copies ``key`` and ``value`` into the tree. If the key is already there
+ * its value is overwritten.
+ *
+ * Returns
+ *
+ *   true if a new record was added, false if an existing one was updated
+ *
+ * Complexity: O(log n)
+ *
+ */
+bool bptree_insert(bptree *t, const void *key, const void *value);
+
+/**
+ * Function: bptree_find
+ *
+ * Returns a pointer to the value stored for ``key``, NULL if not found.
+ * The pointer becomes invalid after any insertion or removal.
+ *
+ * Complexity: O(log n)
+ *
+ */
+void *bptree_find(const bptree *t, const void *key);
+
+/**
+ * Function: bptree_remove
+ *
+ * Removes the record with ``key``. Nodes are not merged when they get
+ * emptier, so a tree that shrank a lot keeps its size; rebuild it with
+ * ``bptree_to_vector`` and ``bptree_from_vector`` to compact it.
+ *
+ * Returns
+ *
+ *   true if the record was removed, false if not found
+ *
+ * Complexity: O(log n)
+ *
+ */
+bool bptree_remove(bptree *t, const void *key);
+
+/**
+ * Function: bptree_first / bptree_seek
+ *
+ * Positions ``it`` at the first record, or at the first record whose key is
+ * greater or equal to ``key``.
+ *
+ * Returns
+ *
+ *   false if there is no such record (``it`` is then past the end)
+ *
+ * Complexity: O(log n)
+ *
+ */
+bool bptree_first(const bptree *t, bptree_iter *it);
+bool bptree_seek(const bptree *t, const void *key, bptree_iter *it);
+
+/**
+ * Function: bptree_next
+ *
+ * Advances ``it`` to the next record in key order.
+ *
+ * Returns
+ *
+ *   false once past the last record
+ *
+ * Complexity: O(1) amortized
+ *
+ */
+bool bptree_next(bptree_iter *it);
+
+/**
+ * Function: bptree_iter_key / bptree_iter_value
+ *
+ * Return pointers to the key and value of the current record of ``it``.
+ * They must not be called once the iteration is past the end, and keys must
+ * not be modified.
+ *
+ */
+void *bptree_iter_key(const bptree_iter *it);
+void *bptree_iter_value(const bptree_iter *it);
+
+/**
+ * Function: bptree_free
+ *
+ * Frees up all the memory of the tree.
+ *
+ */
+void bptree_free(bptree *t);
+
+#endif
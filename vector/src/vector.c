@@ -1,53 +1,469 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "vector.h"
 
-vector *
-vector_new(size_t elem_size, vector_free_func free_func, int initial)
+#define ELEM_AT(base, i, size) ((char *)(base) + (size_t)(i) * (size))
+
+/* runs shorter than this are sorted by insertion before merging */
+#define MERGE_RUN 16
+
+/* unused tails at least this big have their pages returned on clear */
+#define RELEASE_MIN_BYTES (1 << 20)
+
+/* alignment of the element buffer for vectors created with VECT_ALIGNED */
+#ifndef VECTOR_ALIGNMENT
+#define VECTOR_ALIGNMENT 64
+#endif
+
+/* buffers at least this big are mmap()ed for vectors created with VECT_HUGE_PAGES */
+#ifndef VECTOR_HUGE_THRESHOLD
+#define VECTOR_HUGE_THRESHOLD (32 << 20)
+#endif
+
+#define HUGE_PAGE_SIZE (2 << 20)
+
+static size_t
+mapped_size(size_t bytes)
 {
-  if (elem_size == 0 || initial == 0) return NULL;
+  return (bytes + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+}
 
-  vector *v = malloc(sizeof(vector));
+static void *
+map_buffer(size_t length)
+{
+  void *p = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+  madvise(p, length, MADV_HUGEPAGE);
+#endif
+  return p;
+}
+
+static void *
+heap_alloc(const vector *v, size_t bytes)
+{
+  void *p;
+
+  if (!(v->flags & VECT_ALIGNED)) return malloc(bytes);
+  if (posix_memalign(&p, VECTOR_ALIGNMENT, bytes) != 0) return NULL;
+  return p;
+}
+
+/*
+ * Element buffer management. Depending on the flags the buffer lives on the
+ * heap (plain or aligned) or, once it reaches VECTOR_HUGE_THRESHOLD bytes,
+ * in an anonymous mapping backed by transparent huge pages. A mapped buffer
+ * grows with mremap(), which moves page table entries instead of copying.
+ */
+static void
+buffer_alloc(vector *v, size_t bytes)
+{
+  v->mapped_length = 0;
+  v->borrowed = false;
+
+  if ((v->flags & VECT_HUGE_PAGES) && bytes >= VECTOR_HUGE_THRESHOLD) {
+    v->elems = map_buffer(mapped_size(bytes));
+    if (v->elems != NULL) {
+      v->mapped_length = mapped_size(bytes);
+      return;
+    }
+  }
+
+  if (v->flags & VECT_NO_ZERO) {
+    v->elems = heap_alloc(v, bytes);
+  } else if (v->flags & VECT_ALIGNED) {
+    v->elems = heap_alloc(v, bytes);
+    memset(v->elems, 0, bytes);
+  } else {
+    v->elems = calloc(1, bytes);
+  }
+}
+
+static void
+release_buffer(void *elems, size_t mapped_length)
+{
+  if (mapped_length > 0)
+    munmap(elems, mapped_length);
+  else
+    free(elems);
+}
+
+/*
+ * Clones share the element buffer until one of them writes to it. The
+ * vectors sharing a buffer count their references in ``shared_refs``, and
+ * the last one to let go of it frees it.
+ *
+ * Returns whether ``v`` held the last reference.
+ */
+static bool
+drop_shared(vector *v)
+{
+  size_t *refs = v->shared_refs;
+
+  v->shared_refs = NULL;
+  if (__atomic_sub_fetch(refs, 1, __ATOMIC_ACQ_REL) > 0) return false;
+  free(refs);
+  return true;
+}
+
+/* gives ``v`` a buffer of its own before it's written to */
+static void
+unshare(vector *v)
+{
+  void *elems = v->elems;
+  size_t mapped_length = v->mapped_length;
+
+  if (v->shared_refs == NULL) return;
+
+  if (__atomic_load_n(v->shared_refs, __ATOMIC_ACQUIRE) > 1) {
+    buffer_alloc(v, v->alloc_length * v->elem_size);
+    memcpy(v->elems, elems, v->length * v->elem_size);
+  }
+  if (drop_shared(v) && v->elems != elems)
+    release_buffer(elems, mapped_length);
+}
+
+static void
+buffer_resize(vector *v, size_t bytes)
+{
+  size_t keep = v->length * v->elem_size;
+  void *p;
+
+  unshare(v);
+
+  if (v->borrowed) {
+    /* the client's buffer is never reallocated, copy to one we own */
+    p = heap_alloc(v, bytes);
+    memcpy(p, v->elems, keep);
+    v->elems = p;
+    v->borrowed = false;
+    return;
+  }
+
+  if (v->mapped_length > 0) {
+    size_t length = mapped_size(bytes);
+    if (length == v->mapped_length) return;
+#ifdef MREMAP_MAYMOVE
+    p = mremap(v->elems, v->mapped_length, length, MREMAP_MAYMOVE);
+    if (p != MAP_FAILED) {
+      v->elems = p;
+      v->mapped_length = length;
+      return;
+    }
+#endif
+    /* move to a new mapping by hand, or to the heap if that fails too */
+    p = map_buffer(length);
+    if (p == NULL) {
+      p = heap_alloc(v, bytes);
+      length = 0;
+    }
+    memcpy(p, v->elems, keep);
+    munmap(v->elems, v->mapped_length);
+    v->elems = p;
+    v->mapped_length = length;
+    return;
+  }
+
+  if ((v->flags & VECT_HUGE_PAGES) && bytes >= VECTOR_HUGE_THRESHOLD) {
+    p = map_buffer(mapped_size(bytes));
+    if (p != NULL) {
+      memcpy(p, v->elems, keep);
+      free(v->elems);
+      v->elems = p;
+      v->mapped_length = mapped_size(bytes);
+      return;
+    }
+  }
+
+  p = realloc(v->elems, bytes);
+  if ((v->flags & VECT_ALIGNED) && (uintptr_t)p % VECTOR_ALIGNMENT != 0) {
+    void *aligned = heap_alloc(v, bytes);
+    memcpy(aligned, p, keep);
+    free(p);
+    p = aligned;
+  }
+  v->elems = p;
+}
+
+static void
+buffer_free(vector *v)
+{
+  if (v->borrowed) return;
+  if (v->shared_refs != NULL && !drop_shared(v)) return;
+
+  release_buffer(v->elems, v->mapped_length);
+}
+
+static void
+init_fields(vector *v, size_t elem_size, vector_free_func free_func,
+            int initial, int flags)
+{
   v->elem_size = elem_size;
   v->step = initial;
   v->free_func = free_func;
+  v->flags = flags;
   v->length = 0;
   v->alloc_length = initial;
-  v->elems = calloc(initial, elem_size);
+  v->elems = NULL;
+  v->mapped_length = 0;
+  v->borrowed = false;
+  v->shared_refs = NULL;
+  v->sort_buffer = NULL;
+  v->sort_buffer_length = 0;
+  v->shrink_threshold = 0;
+  v->tombstones = NULL;
+  v->num_tombstones = 0;
+  v->compact_threshold = 0;
+}
+
+static bool
+is_deleted(const vector *v, size_t position)
+{
+  return v->num_tombstones > 0 && position < bitset_length(v->tombstones) &&
+         bitset_test(v->tombstones, position);
+}
+
+/* lazily deleted slots must go before elements are moved around */
+static void
+flush_tombstones(vector *v)
+{
+  if (v->num_tombstones > 0)
+    vector_compact(v);
+}
+
+/* number of lazily deleted slots before ``position`` */
+static size_t
+deleted_before(vector *v, size_t position)
+{
+  if (v->num_tombstones == 0) return 0;
+  if (position >= bitset_length(v->tombstones)) return v->num_tombstones;
+  return bitset_rank(v->tombstones, position);
+}
+
+/*
+ * Like flush_tombstones, for functions given a position: a slot index that
+ * counts the deleted slots, moved to the index of the same element after
+ * the compaction. Returns false if that slot is deleted. Positions out of
+ * range are left for the caller to reject.
+ */
+static bool
+flush_tombstones_at(vector *v, int *position)
+{
+  if (v->num_tombstones == 0 || *position < 0 || *position > (int)v->length)
+    return true;
+  if (is_deleted(v, *position))
+    return false;
+
+  *position -= deleted_before(v, *position);
+  vector_compact(v);
+  return true;
+}
+
+vector *
+vector_new(size_t elem_size, vector_free_func free_func, int initial)
+{
+  return vector_new_flags(elem_size, free_func, initial, 0);
+}
+
+vector *
+vector_new_flags(size_t elem_size, vector_free_func free_func, int initial,
+                 int flags)
+{
+  if (elem_size == 0 || initial == 0) return NULL;
+
+  vector *v = malloc(sizeof(vector));
+  init_fields(v, elem_size, free_func, initial, flags);
+  buffer_alloc(v, initial * elem_size);
+  return v;
+}
+
+vector *
+vector_from_buffer(void *elems, size_t elem_size, size_t length, size_t capacity,
+                   vector_free_func free_func, bool owns)
+{
+  if (elems == NULL || elem_size == 0 || capacity == 0 || length > capacity)
+    return NULL;
+
+  vector *v = malloc(sizeof(vector));
+  init_fields(v, elem_size, free_func, VECTOR_GROWTH_STEP, 0);
+  v->alloc_length = capacity;
+  v->elems = elems;
+  v->length = length;
+  v->borrowed = !owns;
   return v;
 }
 
+void *
+vector_detach(vector *v, size_t *length)
+{
+  void *elems;
+
+  flush_tombstones(v);
+  elems = v->elems;
+
+  unshare(v);
+
+  if (v->borrowed || v->mapped_length > 0) {
+    /* the client can only free() heap buffers */
+    elems = malloc(v->length > 0 ? v->length * v->elem_size : 1);
+    memcpy(elems, v->elems, v->length * v->elem_size);
+    buffer_free(v);
+  }
+
+  if (length != NULL)
+    *length = v->length;
+
+  if (v->tombstones != NULL)
+    bitset_free(v->tombstones);
+  free(v->sort_buffer);
+  free(v);
+  return elems;
+}
+
+vector *
+vector_clone(vector *v)
+{
+  if (v->free_func != NULL) return NULL;
+
+  vector *clone = malloc(sizeof(vector));
+  init_fields(clone, v->elem_size, NULL, v->step, v->flags);
+  clone->alloc_length = v->alloc_length;
+  clone->length = v->length;
+  clone->shrink_threshold = v->shrink_threshold;
+
+  if (v->borrowed) {
+    buffer_alloc(clone, v->alloc_length * v->elem_size);
+    memcpy(clone->elems, v->elems, v->length * v->elem_size);
+  } else {
+    if (v->shared_refs == NULL) {
+      v->shared_refs = malloc(sizeof(size_t));
+      *v->shared_refs = 1;
+    }
+    __atomic_add_fetch(v->shared_refs, 1, __ATOMIC_RELAXED);
+    clone->shared_refs = v->shared_refs;
+    clone->elems = v->elems;
+    clone->mapped_length = v->mapped_length;
+  }
+
+  /* lazily deleted slots stay deleted in the clone */
+  clone->compact_threshold = v->compact_threshold;
+  if (v->tombstones != NULL) {
+    clone->tombstones = bitset_new(bitset_length(v->tombstones));
+    bitset_or(clone->tombstones, v->tombstones);
+    clone->num_tombstones = v->num_tombstones;
+  }
+  return clone;
+}
+
+int
+vector_view(const vector *v, int start, int end, vector *view)
+{
+  if (start < 0 || end < start || end > (int)v->length) {
+    return VECT_VIEW_INVALID_RANGE;
+  }
+
+  init_fields(view, v->elem_size, NULL, end > start ? end - start : 1, 0);
+  view->elems = ELEM_AT(v->elems, start, v->elem_size);
+  view->length = end - start;
+  view->borrowed = true;
+  return VECT_OK;
+}
+
 size_t
 vector_length(const vector *v)
 {
   return v->length;
 }
 
+static void
+resize(vector *v, size_t alloc_length)
+{
+  buffer_resize(v, alloc_length * v->elem_size);
+  v->alloc_length = alloc_length;
+}
+
+/*
+ * Makes room for ``count`` more elements: one growth step, or exactly what
+ * was asked for when a bulk request needs more than that
+ */
+static void
+reserve(vector *v, size_t count)
+{
+  size_t alloc_length;
+
+  if (v->alloc_length - v->length >= count) return;
+
+  /* a step of 1 would never grow */
+  alloc_length = v->alloc_length * (v->step > 1 ? v->step : 2);
+  if (alloc_length - v->length < count)
+    alloc_length = v->length + count;
+
+  resize(v, alloc_length);
+}
+
 static void
 grow_if_needed(vector *v)
 {
-  if (v->length == v->alloc_length) {
-    v->alloc_length *= v->step;
-    v->elems = realloc(v->elems, v->alloc_length * v->elem_size);
+  reserve(v, 1);
+}
+
+void
+vector_reserve(vector *v, size_t count)
+{
+  reserve(v, count);
+}
+
+static void
+shrink_if_needed(vector *v)
+{
+  size_t alloc_length = v->alloc_length;
+
+  if (v->shrink_threshold == 0) return;
+
+  while (alloc_length / 2 >= (size_t)v->step &&
+         v->length < v->shrink_threshold * alloc_length) {
+    alloc_length /= 2;
   }
+
+  if (alloc_length != v->alloc_length)
+    resize(v, alloc_length);
 }
 
 void
 vector_append(vector *v, const void *elem_ptr)
 {
   grow_if_needed(v);
+  unshare(v);
 
   void *dst = (char *)v->elems + v->length * v->elem_size;
   memcpy(dst, elem_ptr, v->elem_size);
   v->length++;
 }
 
+void *
+vector_append_uninit(vector *v, size_t count)
+{
+  reserve(v, count);
+  unshare(v);
+
+  void *dst = ELEM_AT(v->elems, v->length, v->elem_size);
+  v->length += count;
+  return dst;
+}
+
 int
 vector_insert(vector *v, const void *elem_ptr, int position)
 {
-  if (position > (int)v->length || position < 0) {
+  if (!flush_tombstones_at(v, &position) ||
+      position > (int)v->length || position < 0) {
     return VECT_INSERT_INVALID_POSITION;
   }
 
@@ -57,6 +473,7 @@ vector_insert(vector *v, const void *elem_ptr, int position)
   }
 
   grow_if_needed(v);
+  unshare(v);
 
   void *src = (char *)v->elems + position * v->elem_size;
   void *dst = (char *)src + v->elem_size;
@@ -67,24 +484,39 @@ vector_insert(vector *v, const void *elem_ptr, int position)
   return VECT_OK;
 }
 
+/*
+ * Lazily deleted slots are skipped by probing the nearest live element,
+ * first to the right of ``middle`` and then to its left
+ */
 static int
-binary_search(const vector *v, const void *key, int start, int end, vector_cmp_func cmp_func)
+live_probe(const vector *v, int middle, int start, int end)
 {
+  int i;
 
-  if (end < start) return VECT_SEARCH_NOT_FOUND;
-
-  int cmp;
-  int middle = (end > start) ? (end - start / 2) : end;
-  void *elem = (char *)v->elems + middle * v->elem_size;
+  for (i = middle; i <= end; i++)
+    if (!is_deleted(v, i)) return i;
+  for (i = middle - 1; i >= start; i--)
+    if (!is_deleted(v, i)) return i;
+  return -1;
+}
 
-  cmp = cmp_func(key, elem);
+static int
+binary_search(const vector *v, const void *key, int start, int end, vector_cmp_func cmp_func)
+{
+  while (start <= end) {
+    int cmp, middle = live_probe(v, start + (end - start) / 2, start, end);
 
-  if (cmp < 0)
-    return binary_search(v, key, start, middle-1, cmp_func);
-  if (cmp > 0)
-    return binary_search(v, key, middle+1, end, cmp_func);
+    if (middle < 0) break;
 
-  return middle;
+    cmp = cmp_func(key, (char *)v->elems + middle * v->elem_size);
+    if (cmp < 0)
+      end = middle - 1;
+    else if (cmp > 0)
+      start = middle + 1;
+    else
+      return middle;
+  }
+  return VECT_SEARCH_NOT_FOUND;
 }
 
 int
@@ -105,6 +537,7 @@ vector_search(const vector *v, const void *key, vector_cmp_func cmp_func,
     return binary_search(v, key, start, v->length-1, cmp_func);
   } else {
     for (i = start; i < v->length; i++) {
+      if (is_deleted(v, i)) continue;
       if (cmp_func((char *)v->elems + i * v->elem_size, key) == 0) return i;
     }
   }
@@ -115,7 +548,7 @@ vector_search(const vector *v, const void *key, vector_cmp_func cmp_func,
 void *
 vector_get(const vector *v, int position)
 {
-  if (position >= (int)v->length || position < 0)
+  if (position >= (int)v->length || position < 0 || is_deleted(v, position))
     return NULL;
   return ((char *)v->elems + (position * v->elem_size));
 }
@@ -127,9 +560,15 @@ vector_replace(vector *v, int position, const void *elem_ptr)
     return VECT_REPLACE_INVALID_POSITION;
   }
 
+  unshare(v);
+
   void *pos = (char *)v->elems + position * v->elem_size;
 
-  if (v->free_func) {
+  if (is_deleted(v, position)) {
+    /* the old element was freed when it was deleted */
+    bitset_clear(v->tombstones, position);
+    v->num_tombstones--;
+  } else if (v->free_func) {
     v->free_func(pos);
   }
 
@@ -141,23 +580,307 @@ void
 vector_sort(vector *v, vector_cmp_func cmp_func)
 {
   if (cmp_func == NULL) return;
+  flush_tombstones(v);
+  unshare(v);
   qsort(v->elems, v->length, v->elem_size, cmp_func);
 }
 
+/*
+ * Returns the scratch buffer used by the stable sort, with room for
+ * ``length`` elements plus one spare slot used as temporary storage
+ */
+static void *
+sort_buffer(vector *v)
+{
+  if (v->sort_buffer_length < v->length + 1) {
+    v->sort_buffer_length = v->length + 1;
+    v->sort_buffer = realloc(v->sort_buffer, v->sort_buffer_length * v->elem_size);
+  }
+  return v->sort_buffer;
+}
+
+static void
+insertion_sort(char *base, size_t size, size_t lo, size_t hi,
+               vector_cmp_func cmp_func, void *tmp)
+{
+  size_t i, j;
+
+  for (i = lo + 1; i < hi; i++) {
+    j = i;
+    while (j > lo && cmp_func(ELEM_AT(base, i, size), ELEM_AT(base, j-1, size)) < 0)
+      j--;
+    if (j == i) continue;
+    memcpy(tmp, ELEM_AT(base, i, size), size);
+    memmove(ELEM_AT(base, j+1, size), ELEM_AT(base, j, size), (i - j) * size);
+    memcpy(ELEM_AT(base, j, size), tmp, size);
+  }
+}
+
+static void
+merge(const char *src, char *dst, size_t size, size_t lo, size_t mid, size_t hi,
+      vector_cmp_func cmp_func)
+{
+  size_t i = lo, j = mid, k = lo;
+
+  while (i < mid && j < hi) {
+    if (cmp_func(ELEM_AT(src, j, size), ELEM_AT(src, i, size)) < 0)
+      memcpy(ELEM_AT(dst, k++, size), ELEM_AT(src, j++, size), size);
+    else
+      memcpy(ELEM_AT(dst, k++, size), ELEM_AT(src, i++, size), size);
+  }
+  if (i < mid) memcpy(ELEM_AT(dst, k, size), ELEM_AT(src, i, size), (mid - i) * size);
+  if (j < hi)  memcpy(ELEM_AT(dst, k, size), ELEM_AT(src, j, size), (hi - j) * size);
+}
+
+void
+vector_stable_sort(vector *v, vector_cmp_func cmp_func)
+{
+  size_t lo, width, n, size = v->elem_size;
+  char *src, *dst, *tmp;
+
+  flush_tombstones(v);
+  n = v->length;
+  if (cmp_func == NULL || n < 2) return;
+  unshare(v);
+
+  src = v->elems;
+  dst = sort_buffer(v);
+  tmp = ELEM_AT(dst, n, size);
+
+  for (lo = 0; lo < n; lo += MERGE_RUN)
+    insertion_sort(src, size, lo, (lo + MERGE_RUN < n) ? lo + MERGE_RUN : n, cmp_func, tmp);
+
+  for (width = MERGE_RUN; width < n; width *= 2) {
+    for (lo = 0; lo < n; lo += 2 * width) {
+      size_t mid = (lo + width < n) ? lo + width : n;
+      size_t hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+      merge(src, dst, size, lo, mid, hi, cmp_func);
+    }
+    tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  if (src != v->elems)
+    memcpy(v->elems, src, n * size);
+}
+
+static void
+swap_elems(void *elem1, void *elem2, size_t size)
+{
+  unsigned char *p = elem1, *q = elem2, tmp;
+
+  while (size--) {
+    tmp = *p;
+    *p++ = *q;
+    *q++ = tmp;
+  }
+}
+
+/*
+ * Quickselect on [lo, hi] with a three-way partition, so runs of equal
+ * elements don't degrade it. After ``depth`` rounds the remaining range is
+ * sorted with qsort to bound the worst case.
+ */
+static void
+introselect(char *base, size_t size, size_t lo, size_t hi, size_t nth,
+            vector_cmp_func cmp_func, void *pivot, int depth)
+{
+  while (lo < hi) {
+    size_t mid, lt, gt, i;
+    int cmp;
+
+    if (depth-- == 0) {
+      qsort(ELEM_AT(base, lo, size), hi - lo + 1, size, cmp_func);
+      return;
+    }
+
+    mid = lo + (hi - lo) / 2;
+    if (cmp_func(ELEM_AT(base, mid, size), ELEM_AT(base, lo, size)) < 0)
+      swap_elems(ELEM_AT(base, mid, size), ELEM_AT(base, lo, size), size);
+    if (cmp_func(ELEM_AT(base, hi, size), ELEM_AT(base, lo, size)) < 0)
+      swap_elems(ELEM_AT(base, hi, size), ELEM_AT(base, lo, size), size);
+    if (cmp_func(ELEM_AT(base, hi, size), ELEM_AT(base, mid, size)) < 0)
+      swap_elems(ELEM_AT(base, hi, size), ELEM_AT(base, mid, size), size);
+    memcpy(pivot, ELEM_AT(base, mid, size), size);
+
+    lt = lo;
+    i = lo;
+    gt = hi + 1;
+    while (i < gt) {
+      cmp = cmp_func(ELEM_AT(base, i, size), pivot);
+      if (cmp < 0)
+        swap_elems(ELEM_AT(base, lt++, size), ELEM_AT(base, i++, size), size);
+      else if (cmp > 0)
+        swap_elems(ELEM_AT(base, i, size), ELEM_AT(base, --gt, size), size);
+      else
+        i++;
+    }
+
+    if (nth < lt)
+      hi = lt - 1;
+    else if (nth >= gt)
+      lo = gt;
+    else
+      return;
+  }
+}
+
+static int
+select_depth(size_t n)
+{
+  int depth = 0;
+  while (n >>= 1)
+    depth++;
+  return 2 * depth;
+}
+
+int
+vector_nth_element(vector *v, int position, vector_cmp_func cmp_func)
+{
+  if (!flush_tombstones_at(v, &position) ||
+      position < 0 || position >= (int)v->length) {
+    return VECT_SORT_INVALID_POSITION;
+  }
+
+  if (cmp_func == NULL) return VECT_OK;
+
+  unshare(v);
+  void *pivot = malloc(v->elem_size);
+  introselect(v->elems, v->elem_size, 0, v->length - 1, position, cmp_func,
+              pivot, select_depth(v->length));
+  free(pivot);
+
+  return VECT_OK;
+}
+
+int
+vector_partial_sort(vector *v, int k, vector_cmp_func cmp_func)
+{
+  /* the first k slots, as live elements */
+  if (k > 0 && k < (int)v->length)
+    k -= deleted_before(v, k);
+  flush_tombstones(v);
+
+  if (k < 0) {
+    return VECT_SORT_INVALID_POSITION;
+  }
+
+  if (cmp_func == NULL) return VECT_OK;
+
+  if (k >= (int)v->length) {
+    vector_sort(v, cmp_func);
+    return VECT_OK;
+  }
+
+  /* everything before position k is now among the k smallest */
+  vector_nth_element(v, k, cmp_func);
+  qsort(v->elems, k, v->elem_size, cmp_func);
+  return VECT_OK;
+}
+
 void
 vector_map(vector *v, vector_map_func map_func, void *data)
 {
-  if (map_func == NULL) return;
+  vector_map_range(v, 0, v->length, map_func, data);
+}
+
+int
+vector_map_range(vector *v, int start, int end, vector_map_func map_func, void *data)
+{
+  if (start < 0 || end < start || end > (int)v->length) {
+    return VECT_MAP_INVALID_RANGE;
+  }
 
-  unsigned int i;
-  for (i = 0; i < v->length; i++)
+  if (map_func == NULL) return VECT_OK;
+
+  /* map_func may write to the elements */
+  unshare(v);
+
+  int i;
+  for (i = start; i < end; i++) {
+    if (is_deleted(v, i)) continue;
     map_func((char *)v->elems + i * v->elem_size, data);
+  }
+  return VECT_OK;
+}
+
+void
+vector_map_chunks(vector *v, vector_chunk_func chunk_func, size_t chunk_size, void *data)
+{
+  vector_map_chunks_range(v, 0, v->length, chunk_func, chunk_size, data);
+}
+
+int
+vector_map_chunks_range(vector *v, int start, int end, vector_chunk_func chunk_func,
+                        size_t chunk_size, void *data)
+{
+  size_t pos = start, stop;
+
+  if (start < 0 || end < start || end > (int)v->length) {
+    return VECT_MAP_INVALID_RANGE;
+  }
+
+  if (chunk_func == NULL) return VECT_OK;
+
+  unshare(v);
+
+  while (pos < (size_t)end) {
+    stop = end;
+
+    if (v->num_tombstones > 0) {
+      size_t deleted = bitset_next_set(v->tombstones, pos);
+      if (deleted == pos) {
+        pos++;
+        continue;
+      }
+      if (deleted < stop) stop = deleted;
+    }
+    if (chunk_size > 0 && stop - pos > chunk_size)
+      stop = pos + chunk_size;
+
+    chunk_func(ELEM_AT(v->elems, pos, v->elem_size), stop - pos, data);
+    pos = stop;
+  }
+  return VECT_OK;
+}
+
+const void *
+vector_next_span(const vector *v, size_t *position, size_t *count)
+{
+  size_t start = *position, stop = v->length, deleted;
+
+  if (v->num_tombstones > 0) {
+    while (start < v->length && is_deleted(v, start))
+      start++;
+    deleted = bitset_next_set(v->tombstones, start);
+    if (deleted < stop) stop = deleted;
+  }
+  if (start >= v->length) return NULL;
+
+  *position = stop;
+  *count = stop - start;
+  return ELEM_AT(v->elems, start, v->elem_size);
+}
+
+/* marks a slot as deleted, compacting once there are too many of them */
+static void
+add_tombstone(vector *v, size_t position)
+{
+  if (bitset_length(v->tombstones) < v->length)
+    bitset_resize(v->tombstones, v->length);
+
+  bitset_set(v->tombstones, position);
+  v->num_tombstones++;
+
+  if (v->num_tombstones >= v->compact_threshold * v->length)
+    vector_compact(v);
 }
 
 int
 vector_delete(vector *v, int position)
 {
-  if (position < 0 || position >= (int)v->length) {
+  if (position < 0 || position >= (int)v->length || is_deleted(v, position)) {
     return VECT_DELETE_INVALID_POSITION;
   }
 
@@ -166,6 +889,12 @@ vector_delete(vector *v, int position)
     v->free_func(elem);
   }
 
+  if (v->compact_threshold > 0) {
+    add_tombstone(v, position);
+    return VECT_OK;
+  }
+
+  unshare(v);
   if (position != ((int)v->length - 1) && (int)v->length > 1) {
     void *source = (char *)v->elems + (position+1) * v->elem_size;
     void *destin = (char *)v->elems + position * v->elem_size;
@@ -174,20 +903,280 @@ vector_delete(vector *v, int position)
   }
 
   v->length--;
+  shrink_if_needed(v);
   return VECT_OK;
 }
 
-void
-vector_free(vector *v)
+int
+vector_swap_remove(vector *v, int position)
 {
-  if (v == NULL) return;
+  if (!flush_tombstones_at(v, &position) ||
+      position < 0 || position >= (int)v->length) {
+    return VECT_DELETE_INVALID_POSITION;
+  }
 
+  unshare(v);
+  void *elem = ELEM_AT(v->elems, position, v->elem_size);
   if (v->free_func != NULL) {
-    int i;
-    for (i = 0; i < (int)v->length; i++) {
-      v->free_func((char *)v->elems + i * v->elem_size);
+    v->free_func(elem);
+  }
+
+  if (position != (int)v->length - 1) {
+    memcpy(elem, ELEM_AT(v->elems, v->length - 1, v->elem_size), v->elem_size);
+  }
+
+  v->length--;
+  shrink_if_needed(v);
+  return VECT_OK;
+}
+
+/*
+ * Single pass compaction: elements for which ``pred_func`` returns
+ * ``remove`` are freed, and each run of kept elements is moved down with
+ * one memmove
+ */
+static size_t
+compact(vector *v, vector_pred_func pred_func, void *data, bool remove)
+{
+  size_t i, run = 0, dst = 0, size = v->elem_size;
+
+  flush_tombstones(v);
+  unshare(v);
+
+  for (i = 0; i < v->length; i++) {
+    void *elem = ELEM_AT(v->elems, i, size);
+    if (pred_func(elem, data) != remove) continue;
+
+    if (v->free_func != NULL) {
+      v->free_func(elem);
+    }
+    if (run != dst) {
+      memmove(ELEM_AT(v->elems, dst, size), ELEM_AT(v->elems, run, size), (i - run) * size);
     }
+    dst += i - run;
+    run = i + 1;
   }
-  free(v->elems);
+
+  if (run != dst) {
+    memmove(ELEM_AT(v->elems, dst, size), ELEM_AT(v->elems, run, size), (v->length - run) * size);
+  }
+  dst += v->length - run;
+
+  i = v->length - dst;
+  v->length = dst;
+  shrink_if_needed(v);
+  return i;
+}
+
+size_t
+vector_remove_if(vector *v, vector_pred_func pred_func, void *data)
+{
+  if (pred_func == NULL) return 0;
+  return compact(v, pred_func, data, true);
+}
+
+size_t
+vector_retain(vector *v, vector_pred_func pred_func, void *data)
+{
+  if (pred_func == NULL) return 0;
+  return compact(v, pred_func, data, false);
+}
+
+size_t
+vector_dedup(vector *v, vector_cmp_func cmp_func)
+{
+  size_t i, last = 0, size = v->elem_size;
+
+  flush_tombstones(v);
+  if (cmp_func == NULL || v->length < 2) return 0;
+  unshare(v);
+
+  for (i = 1; i < v->length; i++) {
+    void *elem = ELEM_AT(v->elems, i, size);
+    if (cmp_func(ELEM_AT(v->elems, last, size), elem) == 0) {
+      if (v->free_func != NULL) {
+        v->free_func(elem);
+      }
+    } else if (++last != i) {
+      memcpy(ELEM_AT(v->elems, last, size), elem, size);
+    }
+  }
+
+  i = v->length - (last + 1);
+  v->length = last + 1;
+  shrink_if_needed(v);
+  return i;
+}
+
+void
+vector_set_shrink_threshold(vector *v, double threshold)
+{
+  if (threshold < 0) threshold = 0;
+  if (threshold > 0.5) threshold = 0.5;
+  v->shrink_threshold = threshold;
+  shrink_if_needed(v);
+}
+
+void
+vector_set_lazy_delete(vector *v, double threshold)
+{
+  if (threshold < 0) threshold = 0;
+  if (threshold > 1) threshold = 1;
+
+  if (threshold == 0 && v->tombstones != NULL) {
+    flush_tombstones(v);
+    bitset_free(v->tombstones);
+    v->tombstones = NULL;
+  } else if (threshold > 0 && v->tombstones == NULL) {
+    v->tombstones = bitset_new(v->length);
+  }
+
+  v->compact_threshold = threshold;
+  if (v->num_tombstones > 0 && v->num_tombstones >= threshold * v->length)
+    vector_compact(v);
+}
+
+/*
+ * Like ``compact``, moving each run of live elements down with one
+ * memmove, but jumping from one deleted slot to the next in the bitset
+ */
+size_t
+vector_compact(vector *v)
+{
+  size_t i, run = 0, dst = 0, size = v->elem_size;
+  size_t removed = v->num_tombstones;
+
+  if (removed == 0) return 0;
+
+  unshare(v);
+  for (i = bitset_next_set(v->tombstones, 0); i != BITSET_NONE;
+       i = bitset_next_set(v->tombstones, i + 1)) {
+    if (run != dst) {
+      memmove(ELEM_AT(v->elems, dst, size), ELEM_AT(v->elems, run, size), (i - run) * size);
+    }
+    dst += i - run;
+    run = i + 1;
+  }
+
+  if (run != dst) {
+    memmove(ELEM_AT(v->elems, dst, size), ELEM_AT(v->elems, run, size), (v->length - run) * size);
+  }
+  v->length = dst + (v->length - run);
+
+  bitset_fill(v->tombstones, false);
+  v->num_tombstones = 0;
+  shrink_if_needed(v);
+  return removed;
+}
+
+void
+vector_shrink_to_fit(vector *v)
+{
+  size_t alloc_length = v->length > 0 ? v->length : 1;
+
+  if (alloc_length != v->alloc_length)
+    resize(v, alloc_length);
+
+  free(v->sort_buffer);
+  v->sort_buffer = NULL;
+  v->sort_buffer_length = 0;
+}
+
+static void
+free_elems(vector *v)
+{
+  size_t i;
+
+  if (v->free_func == NULL) return;
+
+  for (i = 0; i < v->length; i++) {
+    if (is_deleted(v, i)) continue;
+    v->free_func(ELEM_AT(v->elems, i, v->elem_size));
+  }
+}
+
+/*
+ * Hands the whole pages past the logical length back to the kernel. The
+ * range stays mapped, so the buffer is still valid, and the pages read back
+ * as zeros when touched again. Borrowed buffers and views belong to someone
+ * else, whose data must survive.
+ */
+static void
+release_unused(vector *v)
+{
+#ifdef MADV_DONTNEED
+  size_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)ELEM_AT(v->elems, v->length, v->elem_size);
+  uintptr_t end = (uintptr_t)ELEM_AT(v->elems, v->alloc_length, v->elem_size);
+
+  if (v->borrowed || end - start < RELEASE_MIN_BYTES) return;
+
+  start = (start + page - 1) & ~(uintptr_t)(page - 1);
+  end &= ~(uintptr_t)(page - 1);
+  if (start < end)
+    madvise((void *)start, end - start, MADV_DONTNEED);
+#else
+  (void)v;
+#endif
+}
+
+void
+vector_truncate(vector *v, size_t length)
+{
+  size_t i;
+
+  if (v->free_func == NULL && v->num_tombstones == 0)
+    i = v->length;
+  else
+    i = length;
+
+  for (; i < v->length; i++) {
+    if (is_deleted(v, i)) {
+      bitset_clear(v->tombstones, i);
+      v->num_tombstones--;
+    } else if (v->free_func != NULL) {
+      v->free_func(ELEM_AT(v->elems, i, v->elem_size));
+    }
+  }
+
+  if (length < v->length) {
+    v->length = length;
+    shrink_if_needed(v);
+  }
+}
+
+void
+vector_clear(vector *v, bool keep_capacity)
+{
+  free_elems(v);
+  v->length = 0;
+  unshare(v);
+
+  if (v->num_tombstones > 0) {
+    bitset_fill(v->tombstones, false);
+    v->num_tombstones = 0;
+  }
+
+  if (keep_capacity) {
+    release_unused(v);
+  } else {
+    if (v->alloc_length != (size_t)v->step)
+      resize(v, v->step);
+    free(v->sort_buffer);
+    v->sort_buffer = NULL;
+    v->sort_buffer_length = 0;
+  }
+}
+
+void
+vector_free(vector *v)
+{
+  if (v == NULL) return;
+
+  free_elems(v);
+  if (v->tombstones != NULL)
+    bitset_free(v->tombstones);
+  free(v->sort_buffer);
+  buffer_free(v);
   free(v);
 }
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#include "bitset.h"
 
 /**
  * Vector
@@ -25,6 +26,40 @@ enum {
   VECT_INSERT_INVALID_POSITION = -4,
   VECT_REPLACE_INVALID_POSITION = -5,
   VECT_DELETE_INVALID_POSITION = -6,
+  VECT_GET_INVALID_POSITION = -7,
+  VECT_SORT_INVALID_POSITION = -8,
+  VECT_VIEW_INVALID_RANGE = -9,
+  VECT_SNAPSHOT_TOO_MANY_READERS = -10,
+  VECT_EXTSORT_IO_ERROR = -11,
+  VECT_MERGE_INVALID_INPUT = -12,
+  VECT_MAP_INVALID_RANGE = -13,
+  VECT_PERSISTENT_NOT_TRANSIENT = -14,
+};
+
+/**
+ * Flags accepted by ``vector_new_flags``, they can be combined with ``|``
+ *
+ * ``VECT_ALIGNED``
+ *   keep the element buffer aligned to VECTOR_ALIGNMENT (64 bytes, a cache
+ *   line) so it can be processed with aligned SIMD loads.
+ *
+ * ``VECT_HUGE_PAGES``
+ *   once the buffer reaches VECTOR_HUGE_THRESHOLD bytes (32 MiB) it's moved
+ *   to an anonymous mapping advised to use transparent huge pages, and
+ *   further grows are done with mremap() instead of copying. Mappings are
+ *   page aligned, which implies ``VECT_ALIGNED``.
+ *
+ * ``VECT_NO_ZERO``
+ *   don't zero fill the element buffer when the vector is created. Slots
+ *   past the logical length are never exposed, so this only saves a pass
+ *   over memory that ``vector_append`` would overwrite anyway.
+ *
+ * Both sizes are compile time defaults that can be overridden with -D.
+ */
+enum {
+  VECT_ALIGNED = 1 << 0,
+  VECT_HUGE_PAGES = 1 << 1,
+  VECT_NO_ZERO = 1 << 2,
 };
 
 /**
@@ -54,6 +89,27 @@ typedef int (*vector_cmp_func)(const void *elem_ptr1, const void *elem_ptr2);
 typedef void (*vector_map_func)(void *elem_ptr, void *aux_data);
 
 
+/**
+ * Type: vector_chunk_func
+ *
+ * ``vector_chunk_func`` is like ``vector_map_func`` but is called with a
+ * pointer to ``count`` contiguous elements at a time, so the client's loop
+ * over them can be inlined and vectorized by the compiler.
+ */
+typedef void (*vector_chunk_func)(void *base, size_t count, void *aux_data);
+
+
+/**
+ * Type: vector_pred_func
+ *
+ * ``vector_pred_func`` is a pointer to a client-supplied predicate used to
+ * select elements, for example by ``vector_remove_if``. It is called with
+ * a pointer to the element and a client data pointer passed in from the
+ * original caller.
+ */
+typedef bool (*vector_pred_func)(const void *elem_ptr, void *aux_data);
+
+
 /**
  * Type: vector_free_func
  *
@@ -75,11 +131,27 @@ typedef struct {
   void *elems;
   size_t elem_size;
   int step;
+  int flags;
+  size_t mapped_length;
+  bool borrowed;
+  size_t *shared_refs;
   size_t length;
   size_t alloc_length;
   vector_free_func free_func;
+  void *sort_buffer;
+  size_t sort_buffer_length;
+  double shrink_threshold;
+  bitset *tombstones;
+  size_t num_tombstones;
+  double compact_threshold;
 } vector;
 
+/*
+ * Growth step of vectors whose first allocation is sized to the data they
+ * start with, which is usually far bigger than a useful step
+ */
+#define VECTOR_GROWTH_STEP 2
+
 
 /**
  * Function: vector_new
@@ -116,7 +188,8 @@ typedef struct {
  * like this as needed. Thus the allocated length will always be a multiple
  * of ``initial``.
  *
- * No realloc is performed to shrink the vector if elements are deleted.
+ * By default no realloc is performed to shrink the vector if elements are
+ * deleted, see ``vector_set_shrink_threshold`` and ``vector_shrink_to_fit``.
  *
  * Returns
  *
@@ -128,12 +201,137 @@ typedef struct {
  */
 vector* vector_new(size_t elem_size, vector_free_func free_func, int initial);
 
+/**
+ * Function: vector_new_flags
+ * Usage: vector *samples = vector_new_flags(sizeof(float), NULL, 1024, VECT_ALIGNED);
+ *
+ * Same as ``vector_new``, with ``flags`` controlling how the element buffer
+ * is allocated. See VECT_ALIGNED and VECT_HUGE_PAGES.
+ *
+ */
+vector* vector_new_flags(size_t elem_size, vector_free_func free_func, int initial,
+                         int flags);
+
+/**
+ * Function: vector_from_buffer
+ * Usage: vector *v = vector_from_buffer(ids, sizeof(int), 100, 128, NULL, true);
+ *
+ * Constructs a vector around an existing buffer without copying it. The
+ * first ``length`` elements of ``elems`` become the vector contents.
+ *
+ * Parameters
+ *
+ * ``capacity``
+ *   number of elements the buffer has room for. Past it the vector grows
+ *   as if created with an ``initial`` (see ``vector_new``) of
+ *   VECTOR_GROWTH_STEP.
+ *
+ * ``owns``
+ *   if true the vector takes ownership: ``elems`` must have been allocated
+ *   with malloc, it may be reallocated as the vector grows and it is freed
+ *   by ``vector_free``.
+ *   If false the buffer is only borrowed: it's never freed, and the first
+ *   time the vector needs a different size its contents are copied to a
+ *   buffer owned by the vector. Until then writes go to the client's buffer.
+ *
+ * Returns
+ *
+ *   a vector * on success
+ *   NULL if ``elems`` is NULL, ``elem_size`` or ``capacity`` are 0 (zero) or
+ *   ``length`` is greater than ``capacity``
+ *
+ * Complexity: O(1)
+ *
+ */
+vector* vector_from_buffer(void *elems, size_t elem_size, size_t length, size_t capacity,
+                           vector_free_func free_func, bool owns);
+
+/**
+ * Function: vector_detach
+ *
+ * Destroys the vector handing its element buffer over to the client, who
+ * becomes responsible for releasing it (and its elements) with free().
+ * ``vector_free_func`` is not called.
+ *
+ * The buffer is returned without copying, except when it could not be
+ * released with free(): borrowed buffers (see ``vector_from_buffer``) and
+ * VECT_HUGE_PAGES mappings are copied to a new heap buffer.
+ *
+ * Parameters
+ *
+ *  ``length``
+ *    if not NULL, receives the number of elements in the buffer
+ *
+ * Returns
+ *
+ *  A pointer to the first element.
+ *
+ * Complexity: O(1) for heap buffers
+ *
+ */
+void *vector_detach(vector *v, size_t *length);
+
+/**
+ * Function: vector_clone
+ * Usage: vector *mine = vector_clone(routes);
+ *
+ * Constructs a copy of ``v`` that shares its element buffer instead of
+ * copying it. The buffer is reference counted and copied only when one of
+ * the vectors sharing it is first modified through the functions bellow
+ * (``vector_append``, ``vector_insert``, ``vector_replace``,
+ * ``vector_delete``, the sorting functions, the map functions...), so
+ * clones that are only read cost O(1). The reference count is atomic:
+ * clones of the same vector may be handed to different threads.
+ *
+ * While the buffer is shared, elements must not be written through the
+ * pointers given by ``vector_get``.
+ *
+ * Elements are copied byte by byte, so ``v`` must not have a
+ * ``vector_free_func``. A borrowed buffer (see ``vector_from_buffer``) is
+ * copied right away.
+ *
+ * Returns
+ *
+ *   a vector * on success, to be released with ``vector_free``
+ *   NULL if ``v`` has a ``vector_free_func``
+ *
+ * Complexity: O(1), O(n) on the first modification
+ *
+ */
+vector* vector_clone(vector *v);
+
+/**
+ * Function: vector_view
+ * Usage: vector top; vector_view(scores, 0, 10, &top);
+ *
+ * Initializes ``view`` as a read-only window over the elements from ``start``
+ * up to, but not including, ``end``. No element is copied: the view points
+ * into the storage of ``v``.
+ *
+ * The view is a regular vector that can be passed to the non modifying
+ * functions (``vector_length``, ``vector_get``, ``vector_search``,
+ * ``vector_map``...). It doesn't need to be freed, and becomes invalid
+ * together with the pointers returned by ``vector_get`` on ``v``.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_VIEW_INVALID_RANGE if ``start`` is < 0, ``end`` is greater than the
+ *     logical length or ``end`` is less than ``start``
+ *
+ * Complexity: O(1)
+ *
+ */
+int vector_view(const vector *v, int start, int end, vector *view);
+
 /**
  * Function: vector_length
  *
  * Returns
  *
- *  The number of elements currenly in the vector (logical length).
+ *  The number of elements currenly in the vector (logical length). With
+ *  lazy deletion (see ``vector_set_lazy_delete``) deleted slots are counted
+ *  until the vector is compacted.
  *
  * Complexity: O(1)
  *
@@ -158,6 +356,58 @@ size_t vector_length(const vector *v);
  */
 void vector_append(vector *v, const void *elem_ptr);
 
+/**
+ * Function: vector_append_uninit
+ * Usage: nread = read(fd, vector_append_uninit(v, 4096), 4096 * sizeof(int));
+ *
+ * Adds ``count`` elements to the end of the vector without initializing
+ * them and returns a pointer to the first one, so the client can fill them
+ * in place instead of staging each element for ``vector_append``.
+ *
+ * The logical length is incremented by ``count`` right away. The client
+ * must write all the slots before the vector calls ``vector_free_func`` on
+ * them, or before reading them back. Slots left unwritten, as after a short
+ * read, are given back with ``vector_truncate``:
+ *
+ *   vector_truncate(v, vector_length(v) - 4096 + nread / sizeof(int));
+ *
+ * The returned pointer is invalidated like the ones from ``vector_get``.
+ *
+ * Complexity: O(1), ignoring the grow if necessary
+ *
+ */
+void *vector_append_uninit(vector *v, size_t count);
+
+/**
+ * Function: vector_truncate
+ *
+ * Removes the elements from position ``length`` on, calling
+ * ``vector_free_func`` on each of them, and keeps the allocated length
+ * (unless a shrink threshold is set). Does nothing if ``length`` is not
+ * less than the logical length.
+ *
+ * Unwritten slots from ``vector_append_uninit`` can only be truncated from
+ * vectors without a ``vector_free_func``.
+ *
+ * Complexity: O(1), O(n) if ``vector_free_func`` is not NULL or there are
+ * lazily deleted slots
+ *
+ */
+void vector_truncate(vector *v, size_t length);
+
+/**
+ * Function: vector_reserve
+ *
+ * Grows the allocated length, if needed, so ``count`` more elements can be
+ * appended without reallocating. The logical length doesn't change. The
+ * vector grows by its usual step, or to exactly the length needed if the
+ * step is not enough.
+ *
+ * Complexity: O(n) if the buffer has to be moved, O(1) otherwise
+ *
+ */
+void vector_reserve(vector *v, size_t count);
+
 /**
  * Function: vector_insert
  *
@@ -209,7 +459,8 @@ int vector_insert(vector *v, const void *elem_ptr, int position);
  * Returns
  *
  *   The position of the matching element if found.
- *   VECT_SEARCH_NOT_FOUND if element was not found
+ *   VECT_SEARCH_NOT_FOUND if element was not found (lazily deleted
+ *     elements are never found)
  *   VECT_SEARCH_INVALID_KEY if ``key`` is NULL
  *   VECT_SEARCH_INVALID_START if ``start`` is
  *
@@ -238,7 +489,8 @@ int vector_search(const vector *v, const void *key, vector_cmp_func cmp_func,
  * Returns
  *
  *  A pointer to the element on ``position``.
- *  NULL if position is < 0 or greater than logical length
+ *  NULL if position is < 0 or greater than logical length, or if the
+ *  element was lazily deleted
  *
  * Complexity: O(1)
  *
@@ -287,11 +539,72 @@ int vector_replace(vector *v, int position, const void *elem_ptr);
  */
 void vector_sort(vector *v, vector_cmp_func cmp_func);
 
+/**
+ * Function: vector_stable_sort
+ *
+ * Sorts the vector into ascending order according to the supplied comparator,
+ * keeping elements that compare equal in their original relative order.
+ * The algorithm used is a bottom-up merge sort.
+ *
+ * The merge needs a scratch buffer as large as the vector. It is kept by the
+ * vector and reused by subsequent calls, so repeated sorts don't allocate.
+ * It's released by ``vector_free``.
+ *
+ * If ``cmp_func`` is NULL nothing is done
+ *
+ * Complexity: O(n log n)
+ *
+ */
+void vector_stable_sort(vector *v, vector_cmp_func cmp_func);
+
+/**
+ * Function: vector_partial_sort
+ *
+ * Rearranges the vector so that the first ``k`` positions hold the ``k``
+ * smallest elements in ascending order. The order of the remaining elements
+ * is unspecified.
+ *
+ * If ``k`` is greater or equal to the logical length the whole vector is
+ * sorted. If ``cmp_func`` is NULL nothing is done.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_SORT_INVALID_POSITION if ``k`` is < 0
+ *
+ * Complexity: O(n + k log k)
+ *
+ */
+int vector_partial_sort(vector *v, int k, vector_cmp_func cmp_func);
+
+/**
+ * Function: vector_nth_element
+ *
+ * Rearranges the vector so that the element on ``position`` is the one that
+ * would be there if the vector was sorted. All the elements before it are
+ * less or equal to it and all the elements after it are greater or equal.
+ *
+ * The algorithm used is introselect: quickselect with median of three
+ * pivots, falling back to a full sort of the remaining range if the
+ * partitioning goes too deep.
+ *
+ * If ``cmp_func`` is NULL nothing is done
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_SORT_INVALID_POSITION if ``position`` is < 0 or greater than logical length
+ *
+ * Complexity: O(n) on average, O(n log n) worst case
+ *
+ */
+int vector_nth_element(vector *v, int position, vector_cmp_func cmp_func);
+
 /**
  * Function: vector_map
  *
  * Iterate over the elements of the vector in order and calls a ``vector_map_function``
- * passing each element as parameter.
+ * passing each element as parameter. Lazily deleted elements are skipped.
  *
  * Parameters
  *
@@ -307,6 +620,77 @@ void vector_sort(vector *v, vector_cmp_func cmp_func);
  */
 void vector_map(vector *v, vector_map_func map_func, void *data);
 
+/**
+ * Function: vector_map_range
+ *
+ * Same as ``vector_map`` for the elements from ``start`` (inclusive) to
+ * ``end`` (exclusive) only.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_MAP_INVALID_RANGE if ``start`` is < 0, ``end`` is greater than the
+ *     logical length or ``end`` is less than ``start``
+ *
+ * Complexity: O(end - start)
+ *
+ */
+int vector_map_range(vector *v, int start, int end, vector_map_func map_func, void *data);
+
+/**
+ * Function: vector_next_span
+ * Usage: while ((span = vector_next_span(v, &pos, &count)) != NULL) ...
+ *
+ * Finds the next run of consecutive elements that are not lazily deleted,
+ * starting at ``*position``, for code that reads the buffer in bulk.
+ * ``*position`` is moved past the run and its length stored in ``count``.
+ * A vector with no deleted slots is a single run.
+ *
+ * Returns
+ *
+ *   a pointer to the first element of the run
+ *   NULL if there are no elements left
+ *
+ * Complexity: O(1) per run, plus O(1) per deleted slot skipped
+ *
+ */
+const void *vector_next_span(const vector *v, size_t *position, size_t *count);
+
+/**
+ * Function: vector_map_chunks
+ * Usage: vector_map_chunks(samples, scale_floats, 4096, &factor);
+ *
+ * Iterates over the elements in order, calling ``chunk_func`` once per span
+ * of at most ``chunk_size`` contiguous elements instead of once per element.
+ * Lazily deleted elements are skipped by ending the span before them.
+ *
+ * Parameters
+ *
+ *  ``chunk_size``
+ *    maximum number of elements per call. 0 means no limit: one call per
+ *    contiguous span.
+ *
+ * Complexity: O(n), with O(n / chunk_size) calls
+ *
+ */
+void vector_map_chunks(vector *v, vector_chunk_func chunk_func, size_t chunk_size, void *data);
+
+/**
+ * Function: vector_map_chunks_range
+ *
+ * Same as ``vector_map_chunks`` for the elements from ``start`` (inclusive)
+ * to ``end`` (exclusive) only.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_MAP_INVALID_RANGE if ``start`` is < 0, ``end`` is greater than the
+ *     logical length or ``end`` is less than ``start``
+ *
+ */
+int vector_map_chunks_range(vector *v, int start, int end, vector_chunk_func chunk_func,
+                            size_t chunk_size, void *data);
+
 /**
  * Function: vector_delete
  *
@@ -316,7 +700,38 @@ void vector_map(vector *v, vector_map_func map_func, void *data);
  * to vector_new will be called on the element.
  *
  * All the elements after the specified position will be shifted over to
- * fill the gap. It does not shrink the allocated size.
+ * fill the gap. The allocated size only shrinks if a threshold was set with
+ * ``vector_set_shrink_threshold``.
+ *
+ * With lazy deletion enabled (``vector_set_lazy_delete``) the element is
+ * only marked as deleted: nothing is shifted and the positions of the
+ * other elements don't change until the vector is compacted.
+ *
+ * Parameters
+ *
+ *   ``position``
+ *     index of the element to be removed
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_DELETE_INVALID_POSITION if ``position`` is < 0 or greater than logical length,
+ *     or if the element was already lazily deleted
+ *
+ * Complexity: O(n), O(1) amortized with lazy deletion
+ *
+ */
+int vector_delete(vector *v, int position);
+
+/**
+ * Function: vector_swap_remove
+ *
+ * Deletes the element at the specified position by moving the last element
+ * into its place. Use it instead of ``vector_delete`` when the order of the
+ * elements doesn't matter.
+ *
+ * Before the element is removed, the ``vector_free_func`` that was supplied
+ * to vector_new will be called on the element.
  *
  * Parameters
  *
@@ -331,7 +746,164 @@ void vector_map(vector *v, vector_map_func map_func, void *data);
  * Complexity: O(1)
  *
  */
-int vector_delete(vector *v, int position);
+int vector_swap_remove(vector *v, int position);
+
+/**
+ * Function: vector_remove_if
+ *
+ * Deletes all the elements for which ``pred_func`` returns true, calling
+ * ``vector_free_func`` on each of them. The remaining elements keep their
+ * relative order and are compacted in a single pass, so removing many
+ * elements costs the same as removing one.
+ *
+ * Parameters
+ *
+ *  ``pred_func``
+ *    called for each element passing the element and ``data``. If this
+ *    parameter is NULL nothing is done.
+ *
+ *  ``data``
+ *    auxiliar data the client can pass to each ``pred_func``
+ *
+ * Returns
+ *
+ *   The number of elements removed
+ *
+ * Complexity: O(n)
+ *
+ */
+size_t vector_remove_if(vector *v, vector_pred_func pred_func, void *data);
+
+/**
+ * Function: vector_retain
+ *
+ * The opposite of ``vector_remove_if``: keeps only the elements for which
+ * ``pred_func`` returns true.
+ *
+ * Returns
+ *
+ *   The number of elements removed
+ *
+ * Complexity: O(n)
+ *
+ */
+size_t vector_retain(vector *v, vector_pred_func pred_func, void *data);
+
+/**
+ * Function: vector_dedup
+ *
+ * Deletes consecutive elements that compare equal according to
+ * ``cmp_func``, keeping the first one of each run. On a sorted vector this
+ * leaves only unique elements. ``vector_free_func`` is called on each
+ * removed element.
+ *
+ * If ``cmp_func`` is NULL nothing is done
+ *
+ * Returns
+ *
+ *   The number of elements removed
+ *
+ * Complexity: O(n)
+ *
+ */
+size_t vector_dedup(vector *v, vector_cmp_func cmp_func);
+
+/**
+ * Function: vector_set_shrink_threshold
+ *
+ * Makes the vector give memory back as it empties. After any deletion, if
+ * the logical length falls below ``threshold`` times the allocated length,
+ * the allocated length is halved (but never below the ``initial`` passed to
+ * ``vector_new``).
+ *
+ * Because growing multiplies the allocated length, a threshold well below
+ * 0.5 (0.25 is a good choice) avoids reallocating back and forth when
+ * elements are appended and deleted around the boundary.
+ *
+ * Parameters
+ *
+ *  ``threshold``
+ *    fraction of the allocated length, between 0 and 0.5. 0 (the default)
+ *    disables shrinking. Values out of range are clamped.
+ *
+ */
+void vector_set_shrink_threshold(vector *v, double threshold);
+
+/**
+ * Function: vector_set_lazy_delete
+ * Usage: vector_set_lazy_delete(v, 0.25);
+ *
+ * Makes ``vector_delete`` lazy: deleting an element calls
+ * ``vector_free_func`` on it and marks its slot as deleted in a bitset,
+ * without moving the elements after it. ``vector_get`` returns NULL for
+ * deleted slots, and ``vector_map`` and ``vector_search`` skip them.
+ *
+ * Deleted slots are removed all at once, in a single pass, when they reach
+ * ``threshold`` times the logical length or when ``vector_compact`` is
+ * called. Functions that move elements around (inserting, sorting,
+ * ``vector_swap_remove``, ``vector_remove_if``...) compact the vector
+ * first. The positions given to them are slot positions, as for
+ * ``vector_get``, and still refer to the same element after compacting; a
+ * deleted slot is an invalid position. Views should only be taken of
+ * compacted vectors, and code reading the buffer in bulk skips deleted
+ * slots with ``vector_next_span``.
+ *
+ * Parameters
+ *
+ *  ``threshold``
+ *    fraction of deleted slots that triggers a compaction, between 0 and 1.
+ *    0 (the default) turns lazy deletion off, compacting any deleted slots
+ *    left. Values out of range are clamped.
+ *
+ */
+void vector_set_lazy_delete(vector *v, double threshold);
+
+/**
+ * Function: vector_compact
+ *
+ * Removes the slots of lazily deleted elements, shifting the others down.
+ *
+ * Returns
+ *
+ *   the number of slots removed
+ *
+ * Complexity: O(n)
+ *
+ */
+size_t vector_compact(vector *v);
+
+/**
+ * Function: vector_shrink_to_fit
+ *
+ * Reallocates the vector so the allocated length matches the logical length
+ * (at least one element is always kept allocated), and frees the scratch
+ * buffer kept by ``vector_stable_sort``.
+ *
+ * Complexity: O(n) if the buffer has to be moved
+ *
+ */
+void vector_shrink_to_fit(vector *v);
+
+/**
+ * Function: vector_clear
+ *
+ * Removes all the elements from the vector, calling ``vector_free_func`` on
+ * each of them.
+ *
+ * Parameters
+ *
+ *  ``keep_capacity``
+ *    if true the allocated length is kept, so the vector can be refilled
+ *    without reallocating. Large buffers still have their pages returned to
+ *    the operating system (``madvise(MADV_DONTNEED)``) where available; they
+ *    are faulted back in on reuse. If false, the allocated length goes back
+ *    to the ``initial`` passed to ``vector_new`` and the scratch buffer kept
+ *    by ``vector_stable_sort`` is freed.
+ *
+ * Complexity: O(n), if ``vector_free_func`` is NULL then it's O(1)
+ *
+ */
+void vector_clear(vector *v, bool keep_capacity);
 
 /**
  * Function: vector_free
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vector_concurrent.h"
+
+/*
+ * Each bucket holds its elements followed by one publication flag per
+ * element. Position ``i`` lives in the bucket given by the highest bit of
+ * ``i + first bucket size``, which makes the mapping a couple of
+ * instructions.
+ */
+
+static unsigned int
+highest_bit(unsigned long long n)
+{
+  return 63 - __builtin_clzll(n);
+}
+
+static size_t
+bucket_length(const vector_concurrent *v, unsigned int bucket)
+{
+  return (size_t)1 << (v->first_shift + bucket);
+}
+
+static unsigned char *
+bucket_flags(const vector_concurrent *v, void *bucket, unsigned int b)
+{
+  return (unsigned char *)bucket + bucket_length(v, b) * v->elem_size;
+}
+
+static void
+locate(const vector_concurrent *v, size_t position, unsigned int *bucket, size_t *offset)
+{
+  unsigned long long p = (unsigned long long)position + ((size_t)1 << v->first_shift);
+  unsigned int msb = highest_bit(p);
+
+  *bucket = msb - v->first_shift;
+  *offset = p - (1ULL << msb);
+}
+
+vector_concurrent *
+vector_concurrent_new(size_t elem_size, vector_free_func free_func, int initial)
+{
+  unsigned int b;
+
+  if (elem_size == 0 || initial <= 0) return NULL;
+
+  vector_concurrent *v = malloc(sizeof(vector_concurrent));
+  v->elem_size = elem_size;
+  v->free_func = free_func;
+  v->length = 0;
+  v->first_shift = (initial > 1) ? highest_bit(initial - 1) + 1 : 0;
+  for (b = 0; b < VECTOR_CONCURRENT_BUCKETS; b++)
+    v->buckets[b] = NULL;
+
+  return v;
+}
+
+/*
+ * Returns bucket ``b``, allocating it if needed. Threads racing to allocate
+ * the same bucket all try to install theirs and the losers free their copy.
+ */
+static void *
+get_bucket(vector_concurrent *v, unsigned int b)
+{
+  void *bucket = __atomic_load_n(&v->buckets[b], __ATOMIC_ACQUIRE);
+  void *expected = NULL;
+
+  if (bucket != NULL) return bucket;
+
+  size_t length = bucket_length(v, b);
+  bucket = malloc(length * v->elem_size + length);
+  memset(bucket_flags(v, bucket, b), 0, length);
+
+  if (__atomic_compare_exchange_n(&v->buckets[b], &expected, bucket, false,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    return bucket;
+  }
+
+  free(bucket);
+  return expected;
+}
+
+size_t
+vector_concurrent_append(vector_concurrent *v, const void *elem_ptr)
+{
+  unsigned int b;
+  size_t offset;
+  size_t position = __atomic_fetch_add(&v->length, 1, __ATOMIC_RELAXED);
+
+  locate(v, position, &b, &offset);
+
+  void *bucket = get_bucket(v, b);
+  memcpy((char *)bucket + offset * v->elem_size, elem_ptr, v->elem_size);
+  __atomic_store_n(&bucket_flags(v, bucket, b)[offset], 1, __ATOMIC_RELEASE);
+
+  return position;
+}
+
+void *
+vector_concurrent_get(const vector_concurrent *v, size_t position)
+{
+  unsigned int b;
+  size_t offset;
+
+  if (position >= __atomic_load_n(&v->length, __ATOMIC_ACQUIRE)) return NULL;
+
+  locate(v, position, &b, &offset);
+
+  void *bucket = __atomic_load_n(&v->buckets[b], __ATOMIC_ACQUIRE);
+  if (bucket == NULL) return NULL;
+  if (!__atomic_load_n(&bucket_flags(v, bucket, b)[offset], __ATOMIC_ACQUIRE))
+    return NULL;
+
+  return (char *)bucket + offset * v->elem_size;
+}
+
+size_t
+vector_concurrent_length(const vector_concurrent *v)
+{
+  return __atomic_load_n(&v->length, __ATOMIC_ACQUIRE);
+}
+
+void
+vector_concurrent_free(vector_concurrent *v)
+{
+  unsigned int b;
+  size_t i;
+
+  if (v == NULL) return;
+
+  for (b = 0; b < VECTOR_CONCURRENT_BUCKETS; b++) {
+    void *bucket = v->buckets[b];
+    if (bucket == NULL) continue;
+
+    if (v->free_func != NULL) {
+      unsigned char *flags = bucket_flags(v, bucket, b);
+      for (i = 0; i < bucket_length(v, b); i++) {
+        if (flags[i]) v->free_func((char *)bucket + i * v->elem_size);
+      }
+    }
+    free(bucket);
+  }
+  free(v);
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "vector.h"
+
+/**
+ * Concurrent vector
+ *
+ * An append-only vector that many threads can append to and read from at
+ * the same time without locks.
+ *
+ * Elements are stored in buckets that double in size and are never moved
+ * or reallocated, so a pointer to an element stays valid until the vector
+ * is freed. Appending claims a slot with an atomic increment, copies the
+ * element and then publishes it with a release store; readers check the
+ * publication flag with an acquire load, so ``vector_concurrent_get`` is
+ * wait-free and never sees a partially written element.
+ *
+ * Atomic operations use the GCC/Clang ``__atomic`` builtins.
+ */
+
+#ifndef _VECTOR_CONCURRENT
+#define _VECTOR_CONCURRENT
+
+/* maximum number of buckets, bucket ``b`` holds ``initial << b`` elements */
+#define VECTOR_CONCURRENT_BUCKETS 48
+
+/**
+ * Type: vector_concurrent
+ *
+ * Defines the concrete representation of the concurrent vector.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  void *buckets[VECTOR_CONCURRENT_BUCKETS];
+  size_t elem_size;
+  unsigned int first_shift;
+  size_t length;
+  vector_free_func free_func;
+} vector_concurrent;
+
+
+/**
+ * Function: vector_concurrent_new
+ * Usage: vector_concurrent *events = vector_concurrent_new(sizeof(event), NULL, 1024);
+ *
+ * Constructs an empty concurrent vector.
+ *
+ * Parameters
+ *
+ * ``elem_size``, ``free_func``
+ *   same as in ``vector_new``
+ *
+ * ``initial``
+ *   size of the first bucket, rounded up to a power of two. Each following
+ *   bucket is twice as big as the previous one.
+ *
+ * Returns
+ *
+ *   a vector_concurrent * on success
+ *   NULL if ``elem_size`` or ``initial`` are 0 (zero)
+ *
+ * Note that the call to ``vector_concurrent_free`` is mandatory
+ *
+ */
+vector_concurrent *vector_concurrent_new(size_t elem_size, vector_free_func free_func,
+                                         int initial);
+
+/**
+ * Function: vector_concurrent_append
+ *
+ * Copies the element pointed by ``elem_ptr`` to the end of the vector. Safe
+ * to call from any number of threads at once.
+ *
+ * Returns
+ *
+ *   The position of the new element
+ *
+ * Complexity: O(1), lock-free
+ *
+ */
+size_t vector_concurrent_append(vector_concurrent *v, const void *elem_ptr);
+
+/**
+ * Function: vector_concurrent_get
+ *
+ * Returns a pointer to the element on ``position``. Safe to call while
+ * other threads append.
+ *
+ * The pointer remains valid until ``vector_concurrent_free``. Elements must
+ * not be modified through it while other threads may be reading them.
+ *
+ * Returns
+ *
+ *  A pointer to the element on ``position``.
+ *  NULL if ``position`` is out of bounds or if the element is still being
+ *  appended by another thread.
+ *
+ * Complexity: O(1), wait-free
+ *
+ */
+void *vector_concurrent_get(const vector_concurrent *v, size_t position);
+
+/**
+ * Function: vector_concurrent_length
+ *
+ * Returns
+ *
+ *  The number of slots claimed by appends so far. With appends in flight
+ *  some of the last positions may not be published yet.
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t vector_concurrent_length(const vector_concurrent *v);
+
+/**
+ * Function: vector_concurrent_free
+ *
+ * Frees up all the memory of the vector and its elements, calling
+ * ``free_func`` on each element. No other thread may be using the vector.
+ *
+ */
+void vector_concurrent_free(vector_concurrent *v);
+
+#endif
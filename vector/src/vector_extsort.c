@@ -0,0 +1,355 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vector_extsort.h"
+
+/* stdio buffer of the run files, so spills are written in large blocks */
+#define RUN_IO_BUFFER (1 << 20)
+
+vector_extsort *
+vector_extsort_new(size_t elem_size, vector_cmp_func cmp_func, size_t memory_budget,
+                   int threads)
+{
+  int i;
+
+  if (elem_size == 0 || cmp_func == NULL || threads < 1 ||
+      memory_budget / threads < elem_size)
+    return NULL;
+
+  vector_extsort *es = malloc(sizeof(vector_extsort));
+  es->elem_size = elem_size;
+  es->cmp_func = cmp_func;
+  es->memory_budget = memory_budget;
+  es->run_length = memory_budget / threads / elem_size;
+  es->num_jobs = threads;
+  es->current = 0;
+  es->status = VECT_OK;
+  es->runs = vector_new(sizeof(vector_extsort_run), NULL, 16);
+
+  es->jobs = malloc(threads * sizeof(vector_extsort_job));
+  for (i = 0; i < threads; i++) {
+    es->jobs[i].running = false;
+    es->jobs[i].buffer = vector_new_flags(elem_size, NULL, es->run_length, VECT_NO_ZERO);
+    es->jobs[i].file = NULL;
+    es->jobs[i].cmp_func = cmp_func;
+    es->jobs[i].status = VECT_OK;
+  }
+  return es;
+}
+
+/* sorts a run buffer and writes it to a new temporary file */
+static void *
+spill_run(void *arg)
+{
+  vector_extsort_job *job = arg;
+  vector *buffer = job->buffer;
+
+  vector_sort(buffer, job->cmp_func);
+
+  job->file = tmpfile();
+  if (job->file == NULL) {
+    job->status = VECT_EXTSORT_IO_ERROR;
+    return NULL;
+  }
+  setvbuf(job->file, NULL, _IOFBF, RUN_IO_BUFFER);
+
+  if (fwrite(buffer->elems, buffer->elem_size, buffer->length, job->file) != buffer->length ||
+      fflush(job->file) != 0)
+    job->status = VECT_EXTSORT_IO_ERROR;
+  return NULL;
+}
+
+static void
+start_job(vector_extsort *es, int j)
+{
+  vector_extsort_job *job = &es->jobs[j];
+
+  if (es->num_jobs > 1 && pthread_create(&job->thread, NULL, spill_run, job) == 0)
+    job->running = true;
+  else
+    spill_run(job);
+}
+
+/* waits for a job, keeping its run, so its buffer can be refilled */
+static void
+collect_job(vector_extsort *es, int j)
+{
+  vector_extsort_job *job = &es->jobs[j];
+  vector_extsort_run run;
+
+  if (job->running) {
+    pthread_join(job->thread, NULL);
+    job->running = false;
+  }
+
+  if (job->file != NULL) {
+    run.file = job->file;
+    run.length = vector_length(job->buffer);
+    vector_append(es->runs, &run);
+    job->file = NULL;
+  }
+  if (job->status != VECT_OK)
+    es->status = job->status;
+
+  vector_truncate(job->buffer, 0);
+}
+
+int
+vector_extsort_add(vector_extsort *es, const void *elems, size_t count)
+{
+  const char *src = elems;
+
+  while (count > 0 && es->status == VECT_OK) {
+    vector *buffer = es->jobs[es->current].buffer;
+    size_t n = es->run_length - vector_length(buffer);
+
+    if (n > count) n = count;
+    memcpy(vector_append_uninit(buffer, n), src, n * es->elem_size);
+    src += n * es->elem_size;
+    count -= n;
+
+    if (vector_length(buffer) == es->run_length) {
+      start_job(es, es->current);
+      es->current = (es->current + 1) % es->num_jobs;
+      collect_job(es, es->current);
+    }
+  }
+  return es->status;
+}
+
+int
+vector_extsort_add_vector(vector_extsort *es, const vector *v)
+{
+  const void *span;
+  size_t position = 0, count;
+
+  while ((span = vector_next_span(v, &position, &count)) != NULL) {
+    if (vector_extsort_add(es, span, count) != VECT_OK)
+      break;
+  }
+  return es->status;
+}
+
+/*
+ * Merge phase. Each run is read through a buffer of ``capacity`` records;
+ * a run whose buffer and file are exhausted is done.
+ */
+typedef struct {
+  FILE *file;
+  size_t remaining;
+  char *buf;
+  size_t count;
+  size_t pos;
+} run_reader;
+
+typedef struct {
+  vector_extsort *es;
+  run_reader *readers;
+  int k;
+  int *tree;
+  size_t capacity;
+} merger;
+
+static void
+refill(merger *m, run_reader *r)
+{
+  size_t n = r->remaining < m->capacity ? r->remaining : m->capacity;
+
+  if (fread(r->buf, m->es->elem_size, n, r->file) != n) {
+    m->es->status = VECT_EXTSORT_IO_ERROR;
+    n = 0;
+    r->remaining = 0;
+  }
+  r->remaining -= n;
+  r->count = n;
+  r->pos = 0;
+}
+
+static bool
+exhausted(const run_reader *r)
+{
+  return r->pos == r->count;
+}
+
+static void *
+current(merger *m, run_reader *r)
+{
+  return r->buf + r->pos * m->es->elem_size;
+}
+
+/*
+ * Whether run ``a`` wins over run ``b``. Index ``k`` is a virtual run
+ * smaller than everything, used to build the tree. Ties go to the earlier
+ * run.
+ */
+static bool
+wins(merger *m, int a, int b)
+{
+  int cmp;
+
+  if (a == m->k) return true;
+  if (b == m->k) return false;
+  if (exhausted(&m->readers[a])) return false;
+  if (exhausted(&m->readers[b])) return true;
+
+  cmp = m->es->cmp_func(current(m, &m->readers[a]), current(m, &m->readers[b]));
+  return cmp < 0 || (cmp == 0 && a < b);
+}
+
+/*
+ * Replays the matches of leaf ``s`` up to the root. Inner nodes 1..k-1
+ * keep the loser of their match, tree[0] the overall winner.
+ */
+static void
+adjust(merger *m, int s)
+{
+  int t, loser;
+
+  for (t = (s + m->k) / 2; t > 0; t /= 2) {
+    if (wins(m, m->tree[t], s)) {
+      loser = s;
+      s = m->tree[t];
+      m->tree[t] = loser;
+    }
+  }
+  m->tree[0] = s;
+}
+
+static void
+merge_runs(vector_extsort *es, vector_extsort_output_func output_func, void *aux_data)
+{
+  merger m;
+  char *out;
+  size_t out_count = 0, size = es->elem_size;
+  int i;
+
+  m.es = es;
+  m.k = vector_length(es->runs);
+  m.capacity = es->memory_budget / (m.k + 1) / size;
+  if (m.capacity == 0) m.capacity = 1;
+
+  m.readers = malloc(m.k * sizeof(run_reader));
+  m.tree = malloc(m.k * sizeof(int));
+  out = malloc(m.capacity * size);
+
+  for (i = 0; i < m.k; i++) {
+    vector_extsort_run *run = vector_get(es->runs, i);
+    run_reader *r = &m.readers[i];
+    r->file = run->file;
+    r->remaining = run->length;
+    r->buf = malloc(m.capacity * size);
+    rewind(r->file);
+    refill(&m, r);
+    m.tree[i] = m.k;
+  }
+  for (i = m.k - 1; i >= 0; i--)
+    adjust(&m, i);
+
+  while (es->status == VECT_OK && !exhausted(&m.readers[m.tree[0]])) {
+    run_reader *r = &m.readers[m.tree[0]];
+
+    memcpy(out + out_count * size, current(&m, r), size);
+    if (++out_count == m.capacity) {
+      output_func(out, out_count, aux_data);
+      out_count = 0;
+    }
+
+    if (++r->pos == r->count && r->remaining > 0)
+      refill(&m, r);
+    adjust(&m, m.tree[0]);
+  }
+  if (out_count > 0 && es->status == VECT_OK)
+    output_func(out, out_count, aux_data);
+
+  for (i = 0; i < m.k; i++)
+    free(m.readers[i].buf);
+  free(out);
+  free(m.tree);
+  free(m.readers);
+}
+
+int
+vector_extsort_finish(vector_extsort *es, vector_extsort_output_func output_func,
+                      void *aux_data)
+{
+  vector_extsort_job *job = &es->jobs[es->current];
+  int j;
+
+  /* a job spilled without a thread is not running but still holds its run */
+  for (j = 0; j < es->num_jobs; j++) {
+    if (es->jobs[j].running || es->jobs[j].file != NULL)
+      collect_job(es, j);
+  }
+  if (es->status != VECT_OK)
+    return es->status;
+
+  /* everything fit in one buffer: no need to go through a file */
+  if (vector_length(es->runs) == 0) {
+    vector_sort(job->buffer, es->cmp_func);
+    if (vector_length(job->buffer) > 0)
+      output_func(job->buffer->elems, vector_length(job->buffer), aux_data);
+    vector_clear(job->buffer, true);
+    return VECT_OK;
+  }
+
+  if (vector_length(job->buffer) > 0) {
+    spill_run(job);
+    collect_job(es, es->current);
+    if (es->status != VECT_OK)
+      return es->status;
+  }
+
+  /* the merge's read buffers take the whole budget in their place */
+  for (j = 0; j < es->num_jobs; j++)
+    vector_shrink_to_fit(es->jobs[j].buffer);
+
+  merge_runs(es, output_func, aux_data);
+  return es->status;
+}
+
+typedef struct {
+  FILE *out;
+  size_t elem_size;
+  int status;
+} file_output;
+
+static void
+write_chunk(const void *elems, size_t count, void *aux_data)
+{
+  file_output *f = aux_data;
+
+  if (f->status == VECT_OK && fwrite(elems, f->elem_size, count, f->out) != count)
+    f->status = VECT_EXTSORT_IO_ERROR;
+}
+
+int
+vector_extsort_finish_file(vector_extsort *es, FILE *out)
+{
+  file_output f = { out, es->elem_size, VECT_OK };
+  int status = vector_extsort_finish(es, write_chunk, &f);
+
+  return status != VECT_OK ? status : f.status;
+}
+
+void
+vector_extsort_free(vector_extsort *es)
+{
+  size_t i;
+  int j;
+
+  if (es == NULL) return;
+
+  for (j = 0; j < es->num_jobs; j++) {
+    if (es->jobs[j].running)
+      pthread_join(es->jobs[j].thread, NULL);
+    if (es->jobs[j].file != NULL)
+      fclose(es->jobs[j].file);
+    vector_free(es->jobs[j].buffer);
+  }
+
+  for (i = 0; i < vector_length(es->runs); i++)
+    fclose(((vector_extsort_run *)vector_get(es->runs, i))->file);
+
+  vector_free(es->runs);
+  free(es->jobs);
+  free(es);
+}
@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "vector.h"
+
+/**
+ * External sort
+ *
+ * Sorts more fixed-size records than fit in memory. Records are added in
+ * any number of calls and collected in a run buffer of at most
+ * ``memory_budget`` bytes. Each full buffer is sorted in memory, with
+ * ``vector_sort``, and spilled to a temporary file with one large write.
+ *
+ * When all the records are in, the runs are merged with a loser tree: each
+ * record out costs one comparison per level of a tree over the runs, and
+ * every run is read back sequentially through its own buffer. The sorted
+ * records are delivered in chunks to a callback, or written to a file.
+ *
+ * With ``threads`` > 1 the budget is split in that many run buffers.
+ * Full buffers are sorted and spilled by worker threads while the caller
+ * keeps filling the next one.
+ *
+ * If everything fits in one buffer, no file is created.
+ */
+
+#ifndef _VECTOR_EXTSORT
+#define _VECTOR_EXTSORT
+
+/**
+ * Type: vector_extsort_output_func
+ *
+ * Receives the sorted records, ``count`` records at ``elems`` per call, in
+ * order. The memory is only valid during the call.
+ */
+typedef void (*vector_extsort_output_func)(const void *elems, size_t count, void *aux_data);
+
+typedef struct {
+  pthread_t thread;
+  bool running;
+  vector *buffer;
+  FILE *file;
+  vector_cmp_func cmp_func;
+  int status;
+} vector_extsort_job;
+
+typedef struct {
+  FILE *file;
+  size_t length;
+} vector_extsort_run;
+
+/**
+ * Type: vector_extsort
+ *
+ * Defines the concrete representation of the sorter.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  size_t elem_size;
+  vector_cmp_func cmp_func;
+  size_t memory_budget;
+  size_t run_length;
+  int num_jobs;
+  int current;
+  vector_extsort_job *jobs;
+  vector *runs;
+  int status;
+} vector_extsort;
+
+
+/**
+ * Function: vector_extsort_new
+ * Usage: vector_extsort *es = vector_extsort_new(sizeof(row), compare_rows, 1 << 30, 4);
+ *
+ * Constructs a sorter for records of ``elem_size`` bytes.
+ *
+ * Parameters
+ *
+ * ``memory_budget``
+ *   bytes used for run buffers while adding records, and for read buffers
+ *   while merging
+ *
+ * ``threads``
+ *   number of run buffers sorted and spilled concurrently. 1 sorts
+ *   everything in the calling thread.
+ *
+ * Returns
+ *
+ *   a vector_extsort * on success
+ *   NULL if ``elem_size`` is 0 (zero), ``cmp_func`` is NULL, ``threads`` is
+ *   less than 1 or the budget can't hold one record per run buffer
+ *
+ * Note that the call to ``vector_extsort_free`` is mandatory
+ *
+ */
+vector_extsort *vector_extsort_new(size_t elem_size, vector_cmp_func cmp_func,
+                                   size_t memory_budget, int threads);
+
+/**
+ * Function: vector_extsort_add / vector_extsort_add_vector
+ *
+ * Adds ``count`` records from ``elems``, or all the elements of ``v``
+ * (which must have the same element size), to be sorted. The records are
+ * copied, so a producer can refill and add the same vector over and over.
+ * Lazily deleted elements of ``v`` are left out.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_EXTSORT_IO_ERROR if a run could not be written. The sorter can
+ *     only be freed after an error.
+ *
+ * Complexity: O(n log n) amortized over the records of a run
+ *
+ */
+int vector_extsort_add(vector_extsort *es, const void *elems, size_t count);
+int vector_extsort_add_vector(vector_extsort *es, const vector *v);
+
+/**
+ * Function: vector_extsort_finish / vector_extsort_finish_file
+ *
+ * Merges all the records added and delivers them in order to
+ * ``output_func``, or writes them to ``out``. Can be called only once.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_EXTSORT_IO_ERROR if a run could not be written or read back, or if
+ *     writing to ``out`` failed
+ *
+ * Complexity: O(n log r) for r runs
+ *
+ */
+int vector_extsort_finish(vector_extsort *es, vector_extsort_output_func output_func,
+                          void *aux_data);
+int vector_extsort_finish_file(vector_extsort *es, FILE *out);
+
+/**
+ * Function: vector_extsort_free
+ *
+ * Waits for running workers, removes the temporary files and frees up all
+ * the memory of the sorter.
+ *
+ */
+void vector_extsort_free(vector_extsort *es);
+
+#endif
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vector_merge.h"
+
+#define ELEM(v, i) ((char *)(v)->elems + (i) * (v)->elem_size)
+
+static void
+append_range(vector *out, const vector *v, size_t from, size_t to)
+{
+  if (to > from)
+    memcpy(vector_append_uninit(out, to - from), ELEM(v, from), (to - from) * v->elem_size);
+}
+
+/*
+ * First position at or after ``lo`` whose element is not less than
+ * ``key``. Probes 1, 2, 4... elements ahead to bracket it, then binary
+ * searches the bracket, so the cost is logarithmic in the distance skipped.
+ */
+static size_t
+gallop(const vector *v, size_t lo, const void *key, vector_cmp_func cmp_func)
+{
+  size_t hi = lo, step = 1, n = v->length;
+
+  while (hi < n && cmp_func(ELEM(v, hi), key) < 0) {
+    lo = hi + 1;
+    hi += step;
+    step *= 2;
+  }
+  if (hi > n) hi = n;
+
+  while (lo < hi) {
+    size_t middle = lo + (hi - lo) / 2;
+    if (cmp_func(ELEM(v, middle), key) < 0)
+      lo = middle + 1;
+    else
+      hi = middle;
+  }
+  return lo;
+}
+
+/*
+ * Loser tree over the inputs of ``vector_merge_k``: inner nodes 1..k-1
+ * keep the loser of their match, tree[0] the overall winner. Index ``k``
+ * is a virtual input smaller than everything, used to build the tree.
+ */
+typedef struct {
+  vector **inputs;
+  size_t *pos;
+  int *tree;
+  int k;
+  vector_cmp_func cmp_func;
+} merger;
+
+static bool
+exhausted(const merger *m, int i)
+{
+  return m->inputs[i] == NULL || m->pos[i] == m->inputs[i]->length;
+}
+
+static bool
+wins(const merger *m, int a, int b)
+{
+  int cmp;
+
+  if (a == m->k) return true;
+  if (b == m->k) return false;
+  if (exhausted(m, a)) return false;
+  if (exhausted(m, b)) return true;
+
+  cmp = m->cmp_func(ELEM(m->inputs[a], m->pos[a]), ELEM(m->inputs[b], m->pos[b]));
+  return cmp < 0 || (cmp == 0 && a < b);
+}
+
+static void
+adjust(merger *m, int s)
+{
+  int t, loser;
+
+  for (t = (s + m->k) / 2; t > 0; t /= 2) {
+    if (wins(m, m->tree[t], s)) {
+      loser = s;
+      s = m->tree[t];
+      m->tree[t] = loser;
+    }
+  }
+  m->tree[0] = s;
+}
+
+/* inputs are read by position, so lazily deleted slots would be merged */
+static bool
+usable(const vector *out, const vector *in)
+{
+  return in->elem_size == out->elem_size && in->num_tombstones == 0;
+}
+
+int
+vector_merge_k(vector *out, vector **inputs, int k, vector_cmp_func cmp_func)
+{
+  size_t total = 0;
+  merger m;
+  int i;
+
+  if (k < 0) return VECT_MERGE_INVALID_INPUT;
+
+  for (i = 0; i < k; i++) {
+    if (inputs[i] == NULL) continue;
+    if (!usable(out, inputs[i])) return VECT_MERGE_INVALID_INPUT;
+    total += inputs[i]->length;
+  }
+  if (total == 0) return VECT_OK;
+  vector_reserve(out, total);
+
+  m.inputs = inputs;
+  m.k = k;
+  m.cmp_func = cmp_func;
+  m.pos = calloc(k, sizeof(size_t));
+  m.tree = malloc(k * sizeof(int));
+
+  for (i = 0; i < k; i++)
+    m.tree[i] = k;
+  for (i = k - 1; i >= 0; i--)
+    adjust(&m, i);
+
+  while (!exhausted(&m, m.tree[0])) {
+    int winner = m.tree[0];
+    vector_append(out, ELEM(inputs[winner], m.pos[winner]));
+    m.pos[winner]++;
+    adjust(&m, winner);
+  }
+
+  free(m.tree);
+  free(m.pos);
+  return VECT_OK;
+}
+
+static bool
+usable_pair(const vector *out, const vector *a, const vector *b)
+{
+  return usable(out, a) && usable(out, b);
+}
+
+int
+vector_union(vector *out, const vector *a, const vector *b, vector_cmp_func cmp_func)
+{
+  size_t i = 0, j = 0;
+  int cmp;
+
+  if (!usable_pair(out, a, b)) return VECT_MERGE_INVALID_INPUT;
+  vector_reserve(out, a->length + b->length);
+
+  while (i < a->length && j < b->length) {
+    cmp = cmp_func(ELEM(a, i), ELEM(b, j));
+    if (cmp < 0) {
+      vector_append(out, ELEM(a, i++));
+    } else if (cmp > 0) {
+      vector_append(out, ELEM(b, j++));
+    } else {
+      vector_append(out, ELEM(a, i++));
+      j++;
+    }
+  }
+  append_range(out, a, i, a->length);
+  append_range(out, b, j, b->length);
+  return VECT_OK;
+}
+
+int
+vector_intersect(vector *out, const vector *a, const vector *b, vector_cmp_func cmp_func)
+{
+  size_t i = 0, j = 0;
+  int cmp;
+
+  if (!usable_pair(out, a, b)) return VECT_MERGE_INVALID_INPUT;
+  vector_reserve(out, a->length < b->length ? a->length : b->length);
+
+  while (i < a->length && j < b->length) {
+    cmp = cmp_func(ELEM(a, i), ELEM(b, j));
+    if (cmp < 0) {
+      i = gallop(a, i + 1, ELEM(b, j), cmp_func);
+    } else if (cmp > 0) {
+      j = gallop(b, j + 1, ELEM(a, i), cmp_func);
+    } else {
+      vector_append(out, ELEM(a, i++));
+      j++;
+    }
+  }
+  return VECT_OK;
+}
+
+int
+vector_difference(vector *out, const vector *a, const vector *b, vector_cmp_func cmp_func)
+{
+  size_t i = 0, j = 0, next;
+  int cmp;
+
+  if (!usable_pair(out, a, b)) return VECT_MERGE_INVALID_INPUT;
+  vector_reserve(out, a->length);
+
+  while (i < a->length && j < b->length) {
+    cmp = cmp_func(ELEM(a, i), ELEM(b, j));
+    if (cmp < 0) {
+      /* the whole run of ``a`` before b[j] is kept */
+      next = gallop(a, i + 1, ELEM(b, j), cmp_func);
+      append_range(out, a, i, next);
+      i = next;
+    } else if (cmp > 0) {
+      j = gallop(b, j + 1, ELEM(a, i), cmp_func);
+    } else {
+      i++;
+      j++;
+    }
+  }
+  append_range(out, a, i, a->length);
+  return VECT_OK;
+}
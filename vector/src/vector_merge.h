@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "vector.h"
+
+/**
+ * Merge and set operations
+ *
+ * Combine vectors sorted by the same ``vector_cmp_func`` into an output
+ * vector, in linear time instead of concatenating and sorting again. The
+ * result is appended to ``out``, whose capacity is reserved up front for
+ * the largest possible result, so it never grows halfway.
+ *
+ * Inputs are treated as sorted multisets, as in the C++ standard library:
+ * an element present m times in ``a`` and n times in ``b`` is present
+ * max(m, n) times in the union, min(m, n) in the intersection and m - n in
+ * the difference.
+ *
+ * Elements are copied byte by byte, so ``out`` should not have a
+ * ``vector_free_func`` if the inputs own what their elements point to. All
+ * the vectors must have the same element size, and ``out`` must not be one
+ * of the inputs. Inputs with lazily deleted elements are rejected: compact
+ * them first (see ``vector_compact``).
+ */
+
+#ifndef _VECTOR_MERGE
+#define _VECTOR_MERGE
+
+/**
+ * Function: vector_merge_k
+ * Usage: vector_merge_k(all, shards, num_shards, compare_ids);
+ *
+ * Merges ``k`` sorted vectors. A loser tree selects the next element with
+ * one comparison per level, log2(k) in total. Equal elements keep the
+ * order of the inputs.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_MERGE_INVALID_INPUT if an element size differs from ``out``'s, an
+ *     input has lazily deleted elements or ``k`` is negative
+ *
+ * Complexity: O(n log k)
+ *
+ */
+int vector_merge_k(vector *out, vector **inputs, int k, vector_cmp_func cmp_func);
+
+/**
+ * Function: vector_union
+ *
+ * Appends the elements in either ``a`` or ``b``.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_MERGE_INVALID_INPUT if an element size differs from ``out``'s or
+ *     an input has lazily deleted elements
+ *
+ * Complexity: O(n + m)
+ *
+ */
+int vector_union(vector *out, const vector *a, const vector *b, vector_cmp_func cmp_func);
+
+/**
+ * Function: vector_intersect
+ *
+ * Appends the elements in both ``a`` and ``b``, taken from ``a``.
+ *
+ * The side that is behind catches up with a galloping search (probing 1,
+ * 2, 4... elements ahead, then binary searching), so intersecting a small
+ * vector with a much larger one skips most of the larger.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_MERGE_INVALID_INPUT if an element size differs from ``out``'s or
+ *     an input has lazily deleted elements
+ *
+ * Complexity: O(m log(n / m)) for m <= n
+ *
+ */
+int vector_intersect(vector *out, const vector *a, const vector *b, vector_cmp_func cmp_func);
+
+/**
+ * Function: vector_difference
+ *
+ * Appends the elements of ``a`` that are not in ``b``. Skips through ``b``
+ * galloping, like ``vector_intersect``.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_MERGE_INVALID_INPUT if an element size differs from ``out``'s or
+ *     an input has lazily deleted elements
+ *
+ * Complexity: O(n + m)
+ *
+ */
+int vector_difference(vector *out, const vector *a, const vector *b, vector_cmp_func cmp_func);
+
+#endif
@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vector_packed.h"
+
+#define INITIAL_BLOCKS 4
+
+/* maps small negative and positive differences to small numbers */
+static uint64_t
+zigzag(uint64_t delta)
+{
+  return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+static uint64_t
+unzigzag(uint64_t encoded)
+{
+  return (encoded >> 1) ^ (0 - (encoded & 1));
+}
+
+static unsigned char
+bit_width(uint64_t x)
+{
+  unsigned char bits = 0;
+
+  while (x != 0) {
+    bits++;
+    x >>= 1;
+  }
+  return bits;
+}
+
+vector_packed *
+vector_packed_new(void)
+{
+  vector_packed *p = malloc(sizeof(vector_packed));
+
+  p->alloc_words = INITIAL_BLOCKS * VECTOR_PACKED_BLOCK / 4;
+  p->words = malloc(p->alloc_words * sizeof(uint64_t));
+  p->num_words = 0;
+  p->alloc_blocks = INITIAL_BLOCKS;
+  p->blocks = malloc(p->alloc_blocks * sizeof(vector_packed_block));
+  p->num_blocks = 0;
+  p->tail_length = 0;
+  return p;
+}
+
+size_t
+vector_packed_length(const vector_packed *p)
+{
+  return p->num_blocks * VECTOR_PACKED_BLOCK + p->tail_length;
+}
+
+size_t
+vector_packed_bytes(const vector_packed *p)
+{
+  return p->num_words * sizeof(uint64_t) +
+         p->num_blocks * sizeof(vector_packed_block) +
+         p->tail_length * sizeof(uint64_t);
+}
+
+/* compresses the full tail into a new block */
+static void
+flush_tail(vector_packed *p)
+{
+  uint64_t deltas[VECTOR_PACKED_BLOCK], all = 0;
+  vector_packed_block *b;
+  size_t i, words, pos = 0;
+
+  for (i = 1; i < VECTOR_PACKED_BLOCK; i++) {
+    deltas[i] = zigzag(p->tail[i] - p->tail[i - 1]);
+    all |= deltas[i];
+  }
+
+  if (p->num_blocks == p->alloc_blocks) {
+    p->alloc_blocks *= 2;
+    p->blocks = realloc(p->blocks, p->alloc_blocks * sizeof(vector_packed_block));
+  }
+  b = &p->blocks[p->num_blocks++];
+  b->first = p->tail[0];
+  b->offset = p->num_words;
+  b->bits = bit_width(all);
+
+  words = ((VECTOR_PACKED_BLOCK - 1) * b->bits + 63) / 64;
+  if (p->num_words + words > p->alloc_words) {
+    while (p->num_words + words > p->alloc_words)
+      p->alloc_words *= 2;
+    p->words = realloc(p->words, p->alloc_words * sizeof(uint64_t));
+  }
+  memset(p->words + b->offset, 0, words * sizeof(uint64_t));
+
+  for (i = 1; i < VECTOR_PACKED_BLOCK && b->bits > 0; i++, pos += b->bits) {
+    uint64_t *w = p->words + b->offset + pos / 64;
+    unsigned shift = pos % 64;
+    w[0] |= deltas[i] << shift;
+    if (shift + b->bits > 64)
+      w[1] |= deltas[i] >> (64 - shift);
+  }
+
+  p->num_words += words;
+  p->tail_length = 0;
+}
+
+void
+vector_packed_append(vector_packed *p, uint64_t value)
+{
+  p->tail[p->tail_length++] = value;
+  if (p->tail_length == VECTOR_PACKED_BLOCK)
+    flush_tail(p);
+}
+
+/*
+ * Unpacks the first ``count`` values of block ``index``. The bit width is
+ * fixed for the whole block, so the loop has no data dependent branches.
+ */
+static void
+decode_block(const vector_packed *p, size_t index, uint64_t *out, size_t count)
+{
+  const vector_packed_block *b = &p->blocks[index];
+  const uint64_t *words = p->words + b->offset;
+  uint64_t mask = b->bits == 64 ? ~(uint64_t)0 : ((uint64_t)1 << b->bits) - 1;
+  size_t i, pos = 0;
+
+  out[0] = b->first;
+  for (i = 1; i < count; i++, pos += b->bits) {
+    uint64_t delta = 0;
+    unsigned shift = pos % 64;
+
+    if (b->bits > 0) {
+      delta = words[pos / 64] >> shift;
+      if (shift + b->bits > 64)
+        delta |= words[pos / 64 + 1] << (64 - shift);
+    }
+    out[i] = out[i - 1] + unzigzag(delta & mask);
+  }
+}
+
+uint64_t
+vector_packed_get(const vector_packed *p, size_t position)
+{
+  uint64_t values[VECTOR_PACKED_BLOCK];
+  size_t block = position / VECTOR_PACKED_BLOCK;
+
+  if (block == p->num_blocks)
+    return p->tail[position % VECTOR_PACKED_BLOCK];
+
+  decode_block(p, block, values, position % VECTOR_PACKED_BLOCK + 1);
+  return values[position % VECTOR_PACKED_BLOCK];
+}
+
+static int
+scan(const uint64_t *values, size_t count, size_t base, uint64_t key)
+{
+  size_t i;
+
+  for (i = 0; i < count && values[i] <= key; i++) {
+    if (values[i] == key) return base + i;
+  }
+  return VECT_SEARCH_NOT_FOUND;
+}
+
+int
+vector_packed_search(const vector_packed *p, uint64_t key)
+{
+  uint64_t values[VECTOR_PACKED_BLOCK];
+  size_t low = 0, high = p->num_blocks;
+
+  if (p->tail_length > 0 && key >= p->tail[0])
+    return scan(p->tail, p->tail_length, p->num_blocks * VECTOR_PACKED_BLOCK, key);
+
+  /* last block whose first value is <= key */
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (p->blocks[middle].first <= key)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  if (low == 0)
+    return VECT_SEARCH_NOT_FOUND;
+
+  decode_block(p, low - 1, values, VECTOR_PACKED_BLOCK);
+  return scan(values, VECTOR_PACKED_BLOCK, (low - 1) * VECTOR_PACKED_BLOCK, key);
+}
+
+void
+vector_packed_iter_init(const vector_packed *p, vector_packed_iter *it)
+{
+  it->packed = p;
+  it->block = 0;
+  it->position = 0;
+  it->count = 0;
+}
+
+bool
+vector_packed_next(vector_packed_iter *it, uint64_t *value)
+{
+  const vector_packed *p = it->packed;
+
+  if (it->position == it->count) {
+    if (it->block < p->num_blocks) {
+      decode_block(p, it->block, it->values, VECTOR_PACKED_BLOCK);
+      it->count = VECTOR_PACKED_BLOCK;
+    } else if (it->block == p->num_blocks && p->tail_length > 0) {
+      memcpy(it->values, p->tail, p->tail_length * sizeof(uint64_t));
+      it->count = p->tail_length;
+    } else {
+      return false;
+    }
+    it->block++;
+    it->position = 0;
+  }
+
+  *value = it->values[it->position++];
+  return true;
+}
+
+vector_packed *
+vector_packed_from_vector(const vector *v)
+{
+  vector_packed *p;
+  const uint64_t *span;
+  size_t pos = 0, count, i;
+
+  if (v->elem_size != sizeof(uint64_t))
+    return NULL;
+
+  p = vector_packed_new();
+  while ((span = vector_next_span(v, &pos, &count)) != NULL) {
+    for (i = 0; i < count; i++)
+      vector_packed_append(p, span[i]);
+  }
+  return p;
+}
+
+vector *
+vector_packed_to_vector(const vector_packed *p)
+{
+  size_t length = vector_packed_length(p), i;
+  vector *v = vector_new_flags(sizeof(uint64_t), NULL, VECTOR_GROWTH_STEP, VECT_NO_ZERO);
+  uint64_t *out = vector_append_uninit(v, length);
+
+  for (i = 0; i < p->num_blocks; i++)
+    decode_block(p, i, out + i * VECTOR_PACKED_BLOCK, VECTOR_PACKED_BLOCK);
+  memcpy(out + p->num_blocks * VECTOR_PACKED_BLOCK, p->tail,
+         p->tail_length * sizeof(uint64_t));
+  return v;
+}
+
+void
+vector_packed_free(vector_packed *p)
+{
+  if (p == NULL) return;
+
+  free(p->words);
+  free(p->blocks);
+  free(p);
+}
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "vector.h"
+
+/**
+ * Packed integer vector
+ *
+ * A compressed sequence of 64-bit unsigned integers, for sorted ID lists
+ * and similar data where consecutive values are close to each other.
+ *
+ * Values are grouped in blocks of VECTOR_PACKED_BLOCK. A block stores its
+ * first value and then the difference of each value to the previous one,
+ * all bit-packed with the width of the largest difference in the block.
+ * Differences are zigzag encoded, so unsorted sequences work too, only
+ * compressing worse. Appended values wait uncompressed in a tail until a
+ * block is full.
+ *
+ * Access is meant to be sequential (``vector_packed_next``) or by search,
+ * which on sorted sequences skips whole blocks by their first value and
+ * decodes just one.
+ */
+
+#ifndef _VECTOR_PACKED
+#define _VECTOR_PACKED
+
+#define VECTOR_PACKED_BLOCK 128
+
+typedef struct {
+  uint64_t first;
+  size_t offset;
+  unsigned char bits;
+} vector_packed_block;
+
+/**
+ * Type: vector_packed
+ *
+ * Defines the concrete representation of the packed vector.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  uint64_t *words;
+  size_t num_words;
+  size_t alloc_words;
+  vector_packed_block *blocks;
+  size_t num_blocks;
+  size_t alloc_blocks;
+  uint64_t tail[VECTOR_PACKED_BLOCK];
+  size_t tail_length;
+} vector_packed;
+
+/**
+ * Type: vector_packed_iter
+ *
+ * Position of a sequential scan, obtained with ``vector_packed_iter_init``.
+ * It holds one decoded block.
+ */
+typedef struct {
+  const vector_packed *packed;
+  size_t block;
+  size_t position;
+  size_t count;
+  uint64_t values[VECTOR_PACKED_BLOCK];
+} vector_packed_iter;
+
+
+/**
+ * Function: vector_packed_new
+ *
+ * Constructs an empty packed vector.
+ *
+ * Note that the call to ``vector_packed_free`` is mandatory
+ *
+ */
+vector_packed *vector_packed_new(void);
+
+/**
+ * Function: vector_packed_from_vector
+ *
+ * Builds a packed vector with the elements of ``v``, which must be
+ * ``uint64_t``. Lazily deleted elements are left out.
+ *
+ * Returns
+ *
+ *   a vector_packed * on success
+ *   NULL if the element size of ``v`` is not ``sizeof(uint64_t)``
+ *
+ * Complexity: O(n)
+ *
+ */
+vector_packed *vector_packed_from_vector(const vector *v);
+
+/**
+ * Function: vector_packed_to_vector
+ *
+ * Returns a new vector of ``uint64_t`` with all the values decoded.
+ *
+ * Complexity: O(n)
+ *
+ */
+vector *vector_packed_to_vector(const vector_packed *p);
+
+/**
+ * Function: vector_packed_length
+ *
+ * Returns
+ *
+ *  The number of values in the vector.
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t vector_packed_length(const vector_packed *p);
+
+/**
+ * Function: vector_packed_bytes
+ *
+ * Returns
+ *
+ *  The number of bytes used by the values, blocks and tail included.
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t vector_packed_bytes(const vector_packed *p);
+
+/**
+ * Function: vector_packed_append
+ *
+ * Adds ``value`` at the end of the sequence.
+ *
+ * Complexity: O(1) amortized
+ *
+ */
+void vector_packed_append(vector_packed *p, uint64_t value);
+
+/**
+ * Function: vector_packed_get
+ *
+ * Returns the value on ``position``, which must be lower than the length.
+ * It decodes the values of the block before it, so prefer
+ * ``vector_packed_next`` for scans.
+ *
+ * Complexity: O(VECTOR_PACKED_BLOCK)
+ *
+ */
+uint64_t vector_packed_get(const vector_packed *p, size_t position);
+
+/**
+ * Function: vector_packed_search
+ *
+ * Searches a sorted (non-decreasing) packed vector for ``key``.
+ *
+ * Returns
+ *
+ *   The position of a value equal to ``key`` if found.
+ *   VECT_SEARCH_NOT_FOUND if not found
+ *
+ * Complexity: O(log n + VECTOR_PACKED_BLOCK)
+ *
+ */
+int vector_packed_search(const vector_packed *p, uint64_t key);
+
+/**
+ * Function: vector_packed_iter_init / vector_packed_next
+ * Usage: for (vector_packed_iter_init(p, &it); vector_packed_next(&it, &id); ) ...
+ *
+ * Scan the values in order, decoding a block at a time. ``next`` stores
+ * the next value in ``value`` and returns false once past the end.
+ *
+ * Complexity: O(1) amortized per value
+ *
+ */
+void vector_packed_iter_init(const vector_packed *p, vector_packed_iter *it);
+bool vector_packed_next(vector_packed_iter *it, uint64_t *value);
+
+/**
+ * Function: vector_packed_free
+ *
+ * Frees up all the memory of the packed vector.
+ *
+ */
+void vector_packed_free(vector_packed *p);
+
+#endif
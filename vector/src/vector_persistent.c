@@ -0,0 +1,640 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vector_persistent.h"
+
+#define BITS VECTOR_PERSISTENT_BITS
+#define BRANCH VECTOR_PERSISTENT_BRANCH
+
+/* slack allowed when redistributing nodes on concatenation */
+#define EXTRAS 2
+
+typedef vector_persistent_node node;
+
+#define CHILDREN(n) ((node **)((n) + 1))
+#define ELEMS(n) ((char *)((n) + 1))
+
+/*
+ * Nodes. A node at level ``shift`` is a leaf when ``shift`` is 0, and
+ * otherwise has children at level ``shift - BITS``, each with at most
+ * 2^shift elements below it.
+ */
+static node *
+node_new(int shift, size_t elem_size)
+{
+  size_t payload = shift == 0 ? BRANCH * elem_size : BRANCH * sizeof(node *);
+  node *n = malloc(sizeof(node) + payload);
+
+  n->refs = 1;
+  n->count = 0;
+  n->sizes = NULL;
+  return n;
+}
+
+static void
+retain(node *n)
+{
+  __atomic_add_fetch(&n->refs, 1, __ATOMIC_RELAXED);
+}
+
+static void
+release(node *n, int shift)
+{
+  int i;
+
+  if (n == NULL || __atomic_sub_fetch(&n->refs, 1, __ATOMIC_ACQ_REL) > 0) return;
+
+  if (shift > 0) {
+    for (i = 0; i < n->count; i++)
+      release(CHILDREN(n)[i], shift - BITS);
+  }
+  free(n->sizes);
+  free(n);
+}
+
+static node *
+node_copy(const node *n, int shift, size_t elem_size)
+{
+  node *copy = node_new(shift, elem_size);
+  int i;
+
+  copy->count = n->count;
+  if (shift == 0) {
+    memcpy(ELEMS(copy), ELEMS(n), n->count * elem_size);
+  } else {
+    memcpy(CHILDREN(copy), CHILDREN(n), n->count * sizeof(node *));
+    for (i = 0; i < n->count; i++)
+      retain(CHILDREN(n)[i]);
+  }
+  if (n->sizes != NULL) {
+    copy->sizes = malloc(BRANCH * sizeof(size_t));
+    memcpy(copy->sizes, n->sizes, n->count * sizeof(size_t));
+  }
+  return copy;
+}
+
+/*
+ * Returns ``*slot`` ready to be modified in place: as is when nothing else
+ * refers to it, otherwise replaced by a copy. A transient copies each shared
+ * node once, and its copies are its own afterwards.
+ */
+static node *
+own(node **slot, int shift, size_t elem_size)
+{
+  node *n = *slot;
+
+  if (__atomic_load_n(&n->refs, __ATOMIC_ACQUIRE) == 1) return n;
+
+  *slot = node_copy(n, shift, elem_size);
+  release(n, shift);
+  return *slot;
+}
+
+/* number of elements below ``n`` */
+static size_t
+node_size(const node *n, int shift)
+{
+  if (shift == 0) return n->count;
+  if (n->sizes != NULL) return n->sizes[n->count - 1];
+  return ((size_t)(n->count - 1) << shift) + node_size(CHILDREN(n)[n->count - 1], shift - BITS);
+}
+
+/*
+ * Index of the child holding element ``*i`` (relative to ``n``), which is
+ * made relative to that child. In relaxed nodes the radix guess is a lower
+ * bound, as no child holds more than 2^shift elements.
+ */
+static int
+child_index(const node *n, int shift, size_t *i)
+{
+  size_t index = *i >> shift;
+
+  if (n->sizes == NULL) {
+    *i -= index << shift;
+    return index;
+  }
+
+  while (n->sizes[index] <= *i)
+    index++;
+  if (index > 0)
+    *i -= n->sizes[index - 1];
+  return index;
+}
+
+/* drops the size table if the children allow radix indexing, or fills it */
+static void
+update_sizes(node *n, int shift)
+{
+  size_t total = 0;
+  bool dense = true;
+  int i;
+
+  for (i = 0; i < n->count - 1 && dense; i++)
+    dense = node_size(CHILDREN(n)[i], shift - BITS) == (size_t)1 << shift;
+
+  if (dense) {
+    free(n->sizes);
+    n->sizes = NULL;
+    return;
+  }
+
+  if (n->sizes == NULL)
+    n->sizes = malloc(BRANCH * sizeof(size_t));
+  for (i = 0; i < n->count; i++) {
+    total += node_size(CHILDREN(n)[i], shift - BITS);
+    n->sizes[i] = total;
+  }
+}
+
+static void
+add_child(node *n, int shift, node *child)
+{
+  CHILDREN(n)[n->count++] = child;
+
+  if (n->sizes != NULL)
+    n->sizes[n->count - 1] = (n->count > 1 ? n->sizes[n->count - 2] : 0) +
+                             node_size(child, shift - BITS);
+  else if (n->count > 1 &&
+           node_size(CHILDREN(n)[n->count - 2], shift - BITS) != (size_t)1 << shift)
+    update_sizes(n, shift);
+}
+
+/*
+ * Appending. The tail collects elements until it's full, and then is pushed
+ * as a leaf after the last leaf of the tree, adding a level when the tree
+ * has no room left.
+ */
+static bool
+has_room(const node *n, int shift)
+{
+  if (n->count < BRANCH) return true;
+  return shift > BITS && has_room(CHILDREN(n)[n->count - 1], shift - BITS);
+}
+
+/* a chain of single child nodes from level ``shift`` down to ``leaf`` */
+static node *
+new_path(int shift, node *leaf, size_t elem_size)
+{
+  node *n;
+
+  if (shift == 0) return leaf;
+
+  n = node_new(shift, elem_size);
+  add_child(n, shift, new_path(shift - BITS, leaf, elem_size));
+  return n;
+}
+
+static void
+insert_leaf(node **slot, int shift, node *leaf, size_t elem_size)
+{
+  node *n = own(slot, shift, elem_size);
+
+  if (shift > BITS && has_room(CHILDREN(n)[n->count - 1], shift - BITS)) {
+    insert_leaf(&CHILDREN(n)[n->count - 1], shift - BITS, leaf, elem_size);
+    if (n->sizes != NULL)
+      n->sizes[n->count - 1] += leaf->count;
+  } else {
+    add_child(n, shift, new_path(shift - BITS, leaf, elem_size));
+  }
+}
+
+/* moves ``leaf``, and the reference to it, into the tree */
+static void
+push_leaf(vector_persistent *p, node *leaf)
+{
+  node *root;
+
+  if (p->root == NULL) {
+    p->root = new_path(BITS, leaf, p->elem_size);
+    p->shift = BITS;
+  } else if (has_room(p->root, p->shift)) {
+    insert_leaf(&p->root, p->shift, leaf, p->elem_size);
+  } else {
+    root = node_new(p->shift + BITS, p->elem_size);
+    add_child(root, p->shift + BITS, p->root);
+    add_child(root, p->shift + BITS, new_path(p->shift, leaf, p->elem_size));
+    p->root = root;
+    p->shift += BITS;
+  }
+}
+
+static void
+append_elems(vector_persistent *t, const char *elems, size_t count)
+{
+  size_t n, size = t->elem_size;
+  node *tail;
+
+  while (count > 0) {
+    if (t->tail->count == BRANCH) {
+      push_leaf(t, t->tail);
+      t->tail = node_new(0, size);
+    }
+
+    tail = own(&t->tail, 0, size);
+    n = BRANCH - tail->count;
+    if (n > count) n = count;
+
+    memcpy(ELEMS(tail) + tail->count * size, elems, n * size);
+    tail->count += n;
+    t->length += n;
+    elems += n * size;
+    count -= n;
+  }
+}
+
+vector_persistent *
+vector_persistent_new(size_t elem_size)
+{
+  if (elem_size == 0) return NULL;
+
+  vector_persistent *p = malloc(sizeof(vector_persistent));
+  p->elem_size = elem_size;
+  p->length = 0;
+  p->shift = BITS;
+  p->root = NULL;
+  p->tail = node_new(0, elem_size);
+  p->transient = false;
+  return p;
+}
+
+vector_persistent *
+vector_persistent_transient(const vector_persistent *p)
+{
+  vector_persistent *t = malloc(sizeof(vector_persistent));
+
+  *t = *p;
+  if (t->root != NULL) retain(t->root);
+  retain(t->tail);
+  t->transient = true;
+  return t;
+}
+
+void
+vector_persistent_freeze(vector_persistent *t)
+{
+  t->transient = false;
+}
+
+vector_persistent *
+vector_persistent_from_vector(const vector *v)
+{
+  vector_persistent *t = vector_persistent_new(v->elem_size);
+  const void *span;
+  size_t position = 0, count;
+
+  t->transient = true;
+  while ((span = vector_next_span(v, &position, &count)) != NULL)
+    append_elems(t, span, count);
+  vector_persistent_freeze(t);
+  return t;
+}
+
+static void
+copy_leaves(const node *n, int shift, size_t elem_size, vector *out)
+{
+  int i;
+
+  if (shift == 0) {
+    memcpy(vector_append_uninit(out, n->count), ELEMS(n), n->count * elem_size);
+    return;
+  }
+  for (i = 0; i < n->count; i++)
+    copy_leaves(CHILDREN(n)[i], shift - BITS, elem_size, out);
+}
+
+vector *
+vector_persistent_to_vector(const vector_persistent *p)
+{
+  vector *out = vector_new_flags(p->elem_size, NULL, VECTOR_GROWTH_STEP, VECT_NO_ZERO);
+
+  vector_reserve(out, p->length);
+  if (p->root != NULL)
+    copy_leaves(p->root, p->shift, p->elem_size, out);
+  copy_leaves(p->tail, 0, p->elem_size, out);
+  return out;
+}
+
+size_t
+vector_persistent_length(const vector_persistent *p)
+{
+  return p->length;
+}
+
+const void *
+vector_persistent_get(const vector_persistent *p, size_t position)
+{
+  size_t tail_offset = p->length - p->tail->count;
+  const node *n = p->root;
+  int shift = p->shift;
+
+  if (position >= p->length) return NULL;
+
+  if (position >= tail_offset)
+    return ELEMS(p->tail) + (position - tail_offset) * p->elem_size;
+
+  for (; shift > 0; shift -= BITS)
+    n = CHILDREN(n)[child_index(n, shift, &position)];
+  return ELEMS(n) + position * p->elem_size;
+}
+
+int
+vector_persistent_append(vector_persistent *t, const void *elem_ptr)
+{
+  if (!t->transient) return VECT_PERSISTENT_NOT_TRANSIENT;
+
+  append_elems(t, elem_ptr, 1);
+  return VECT_OK;
+}
+
+int
+vector_persistent_replace(vector_persistent *t, size_t position, const void *elem_ptr)
+{
+  size_t tail_offset = t->length - t->tail->count, size = t->elem_size;
+  node **slot = &t->root, *n;
+  int shift = t->shift;
+
+  if (!t->transient) return VECT_PERSISTENT_NOT_TRANSIENT;
+  if (position >= t->length) return VECT_REPLACE_INVALID_POSITION;
+
+  if (position >= tail_offset) {
+    n = own(&t->tail, 0, size);
+    memcpy(ELEMS(n) + (position - tail_offset) * size, elem_ptr, size);
+    return VECT_OK;
+  }
+
+  for (; shift > 0; shift -= BITS) {
+    n = own(slot, shift, size);
+    slot = &CHILDREN(n)[child_index(n, shift, &position)];
+  }
+  n = own(slot, 0, size);
+  memcpy(ELEMS(n) + position * size, elem_ptr, size);
+  return VECT_OK;
+}
+
+vector_persistent *
+vector_persistent_push(const vector_persistent *p, const void *elem_ptr)
+{
+  vector_persistent *next = vector_persistent_transient(p);
+
+  vector_persistent_append(next, elem_ptr);
+  vector_persistent_freeze(next);
+  return next;
+}
+
+vector_persistent *
+vector_persistent_set(const vector_persistent *p, size_t position, const void *elem_ptr)
+{
+  vector_persistent *next;
+
+  if (position >= p->length) return NULL;
+
+  next = vector_persistent_transient(p);
+  vector_persistent_replace(next, position, elem_ptr);
+  vector_persistent_freeze(next);
+  return next;
+}
+
+/*
+ * Concatenation (Bagwell and Rompf, "RRB-Trees: Efficient Immutable
+ * Vectors"). The right edge of the left tree and the left edge of the
+ * right tree are merged level by level, from the leaves up. At each level
+ * the nodes around the seam are redistributed so there are at most EXTRAS
+ * more of them than strictly needed, which keeps the height O(log n).
+ * Everything off the seam is shared.
+ */
+
+/*
+ * Plans the redistribution of nodes with ``counts`` slots each, merging
+ * the first underfull nodes into the ones after them. Returns the new
+ * number of nodes, whose counts are left in ``counts``.
+ */
+static int
+plan_counts(int *counts, int n)
+{
+  int i, total = 0, optimal, remaining, merged;
+
+  for (i = 0; i < n; i++)
+    total += counts[i];
+  optimal = (total + BRANCH - 1) / BRANCH;
+
+  i = 0;
+  while (n > optimal + EXTRAS) {
+    while (counts[i] > BRANCH - EXTRAS / 2)
+      i++;
+
+    /* node i is spread over the following ones, until one of them empties */
+    remaining = counts[i];
+    while (remaining > 0) {
+      merged = remaining + counts[i + 1];
+      counts[i] = merged < BRANCH ? merged : BRANCH;
+      remaining = merged - counts[i];
+      i++;
+    }
+
+    memmove(&counts[i], &counts[i + 1], (n - i - 1) * sizeof(int));
+    n--;
+    i--;
+  }
+  return n;
+}
+
+/*
+ * Rebuilds ``nodes`` (at level ``shift``) with the slot counts of the plan.
+ * Nodes the plan leaves as they are are shared instead of copied. Stores
+ * the new nodes in ``out``, each with its own reference.
+ */
+static void
+redistribute(node **nodes, const int *counts, int m, int shift, size_t elem_size, node **out)
+{
+  int i, j = 0, k = 0, filled, take;
+  node *dst;
+
+  for (i = 0; i < m; i++) {
+    if (k == 0 && nodes[j]->count == counts[i]) {
+      retain(nodes[j]);
+      out[i] = nodes[j++];
+      continue;
+    }
+
+    dst = node_new(shift, elem_size);
+    for (filled = 0; filled < counts[i]; filled += take) {
+      take = nodes[j]->count - k;
+      if (take > counts[i] - filled) take = counts[i] - filled;
+
+      if (shift == 0) {
+        memcpy(ELEMS(dst) + filled * elem_size, ELEMS(nodes[j]) + k * elem_size,
+               take * elem_size);
+      } else {
+        int c;
+        for (c = 0; c < take; c++) {
+          retain(CHILDREN(nodes[j])[k + c]);
+          CHILDREN(dst)[filled + c] = CHILDREN(nodes[j])[k + c];
+        }
+      }
+
+      k += take;
+      if (k == nodes[j]->count) {
+        j++;
+        k = 0;
+      }
+    }
+    dst->count = counts[i];
+    if (shift > 0)
+      update_sizes(dst, shift);
+    out[i] = dst;
+  }
+}
+
+/* node at level ``shift`` holding ``children``, whose references it takes */
+static node *
+pack(node **children, int n, int shift, size_t elem_size)
+{
+  node *parent = node_new(shift, elem_size);
+  int i;
+
+  for (i = 0; i < n; i++)
+    CHILDREN(parent)[i] = children[i];
+  parent->count = n;
+  update_sizes(parent, shift);
+  return parent;
+}
+
+/*
+ * Merges the children of ``left`` (but its last), of ``center`` and of
+ * ``right`` (but its first), all nodes at level ``shift``. Returns a node
+ * one level up with one or two children. ``center`` is released.
+ */
+static node *
+rebalance(node *left, node *center, node *right, int shift, size_t elem_size)
+{
+  node *all[2 * BRANCH], *merged[2 * BRANCH], *top[2];
+  int counts[2 * BRANCH], i, n = 0, m;
+
+  if (left != NULL) {
+    for (i = 0; i < left->count - 1; i++)
+      all[n++] = CHILDREN(left)[i];
+  }
+  for (i = 0; i < center->count; i++)
+    all[n++] = CHILDREN(center)[i];
+  if (right != NULL) {
+    for (i = 1; i < right->count; i++)
+      all[n++] = CHILDREN(right)[i];
+  }
+
+  for (i = 0; i < n; i++)
+    counts[i] = all[i]->count;
+  m = plan_counts(counts, n);
+  redistribute(all, counts, m, shift - BITS, elem_size, merged);
+  release(center, shift);
+
+  top[0] = pack(merged, m < BRANCH ? m : BRANCH, shift, elem_size);
+  if (m <= BRANCH)
+    return pack(top, 1, shift + BITS, elem_size);
+
+  top[1] = pack(merged + BRANCH, m - BRANCH, shift, elem_size);
+  return pack(top, 2, shift + BITS, elem_size);
+}
+
+/*
+ * Merges the trees ``left`` and ``right`` at levels ``lshift`` and
+ * ``rshift`` into a node one level above the highest, with one or two
+ * children.
+ */
+static node *
+merge(node *left, int lshift, node *right, int rshift, size_t elem_size)
+{
+  node *center, *leaves[2];
+
+  if (lshift > rshift) {
+    center = merge(CHILDREN(left)[left->count - 1], lshift - BITS, right, rshift, elem_size);
+    return rebalance(left, center, NULL, lshift, elem_size);
+  }
+
+  if (lshift < rshift) {
+    center = merge(left, lshift, CHILDREN(right)[0], rshift - BITS, elem_size);
+    return rebalance(NULL, center, right, rshift, elem_size);
+  }
+
+  if (lshift == 0) {
+    if (left->count + right->count <= BRANCH) {
+      leaves[0] = node_copy(left, 0, elem_size);
+      memcpy(ELEMS(leaves[0]) + left->count * elem_size, ELEMS(right), right->count * elem_size);
+      leaves[0]->count += right->count;
+      return pack(leaves, 1, BITS, elem_size);
+    }
+    retain(left);
+    retain(right);
+    leaves[0] = left;
+    leaves[1] = right;
+    return pack(leaves, 2, BITS, elem_size);
+  }
+
+  center = merge(CHILDREN(left)[left->count - 1], lshift - BITS,
+                 CHILDREN(right)[0], rshift - BITS, elem_size);
+  return rebalance(left, center, right, lshift, elem_size);
+}
+
+vector_persistent *
+vector_persistent_concat(const vector_persistent *a, const vector_persistent *b)
+{
+  vector_persistent *t;
+  node *root;
+  int shift;
+
+  if (a->elem_size != b->elem_size) return NULL;
+
+  t = vector_persistent_transient(a);
+
+  /* a short right side is just appended */
+  if (b->root == NULL || a->length == 0) {
+    if (a->length == 0) {
+      vector_persistent_free(t);
+      t = vector_persistent_transient(b);
+    } else {
+      append_elems(t, ELEMS(b->tail), b->tail->count);
+    }
+    vector_persistent_freeze(t);
+    return t;
+  }
+
+  /* the left side's tail goes into its tree, even if it's not full */
+  if (t->tail->count > 0)
+    push_leaf(t, t->tail);
+  else
+    release(t->tail, 0);
+
+  if (t->root == NULL) {
+    retain(b->root);
+    t->root = b->root;
+    t->shift = b->shift;
+  } else {
+    root = merge(t->root, t->shift, b->root, b->shift, t->elem_size);
+    shift = (t->shift > b->shift ? t->shift : b->shift) + BITS;
+    release(t->root, t->shift);
+
+    if (root->count == 1) {
+      t->root = CHILDREN(root)[0];
+      retain(t->root);
+      release(root, shift);
+      shift -= BITS;
+    } else {
+      t->root = root;
+    }
+    t->shift = shift;
+  }
+
+  retain(b->tail);
+  t->tail = b->tail;
+  t->length = a->length + b->length;
+  vector_persistent_freeze(t);
+  return t;
+}
+
+void
+vector_persistent_free(vector_persistent *p)
+{
+  if (p == NULL) return;
+
+  release(p->root, p->shift);
+  release(p->tail, 0);
+  free(p);
+}
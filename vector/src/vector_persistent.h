@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "vector.h"
+
+/**
+ * Persistent vector
+ *
+ * An immutable sequence of fixed-size elements. Modifying it returns a new
+ * version and leaves the old one untouched, and both share every node the
+ * change didn't go through, so keeping many versions of a large vector
+ * costs a little more than one.
+ *
+ * The elements are kept in a 32-way tree (relaxed radix balanced, RRB) with
+ * the last elements in a separate tail node:
+ *
+ *  - ``vector_persistent_get`` is O(log32 n), at most 7 levels for 2^32
+ *    elements
+ *  - ``vector_persistent_push`` is O(1) amortized: it usually copies only
+ *    the tail
+ *  - ``vector_persistent_set`` copies the path to one leaf
+ *  - ``vector_persistent_concat`` is O(log n): it rebuilds only the nodes
+ *    along the seam, redistributing their contents so they stay nearly full
+ *
+ * For bulk loads, a transient version (``vector_persistent_transient``) is
+ * modified in place with ``vector_persistent_append`` and
+ * ``vector_persistent_replace``, copying only nodes shared with other
+ * versions, and then frozen into a regular version.
+ *
+ * Nodes are reference counted with atomic operations, so different versions
+ * may be used and freed from different threads. Elements are copied byte
+ * by byte, so they should not own memory.
+ */
+
+#ifndef _VECTOR_PERSISTENT
+#define _VECTOR_PERSISTENT
+
+#define VECTOR_PERSISTENT_BITS 5
+#define VECTOR_PERSISTENT_BRANCH (1 << VECTOR_PERSISTENT_BITS)
+
+/*
+ * Node header, followed by VECTOR_PERSISTENT_BRANCH child pointers or, in
+ * leaves, elements. ``sizes`` holds the cumulative number of elements below
+ * each child of relaxed nodes, and is NULL in leaves and in nodes whose
+ * children, except the last, are full.
+ */
+typedef struct {
+  size_t refs;
+  int count;
+  size_t *sizes;
+} vector_persistent_node;
+
+/**
+ * Type: vector_persistent
+ *
+ * Defines the concrete representation of one version of the vector.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  size_t elem_size;
+  size_t length;
+  int shift;
+  vector_persistent_node *root;
+  vector_persistent_node *tail;
+  bool transient;
+} vector_persistent;
+
+
+/**
+ * Function: vector_persistent_new
+ *
+ * Constructs an empty version.
+ *
+ * Every version, including the ones returned by the functions bellow, must
+ * be released with ``vector_persistent_free``
+ *
+ * Returns
+ *
+ *   a vector_persistent * on success
+ *   NULL if ``elem_size`` is 0 (zero)
+ *
+ */
+vector_persistent *vector_persistent_new(size_t elem_size);
+
+/**
+ * Function: vector_persistent_from_vector
+ *
+ * Builds a version with the elements of ``v``, filling the leaves through
+ * a transient.
+ * Lazily deleted elements of ``v`` are left out.
+ *
+ * Complexity: O(n)
+ *
+ */
+vector_persistent *vector_persistent_from_vector(const vector *v);
+
+/**
+ * Function: vector_persistent_to_vector
+ *
+ * Returns a new vector with a copy of all the elements, leaf by leaf.
+ *
+ * Complexity: O(n)
+ *
+ */
+vector *vector_persistent_to_vector(const vector_persistent *p);
+
+/**
+ * Function: vector_persistent_length
+ *
+ * Returns
+ *
+ *  The number of elements in the version.
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t vector_persistent_length(const vector_persistent *p);
+
+/**
+ * Function: vector_persistent_get
+ *
+ * Returns
+ *
+ *   A pointer to the element on ``position``, which must not be modified.
+ *   NULL if ``position`` is out of range
+ *
+ * Complexity: O(log32 n)
+ *
+ */
+const void *vector_persistent_get(const vector_persistent *p, size_t position);
+
+/**
+ * Function: vector_persistent_push
+ * Usage: vector_persistent *next = vector_persistent_push(prev, &event);
+ *
+ * Returns a new version with ``elem_ptr`` added at the end.
+ *
+ * Complexity: O(1) amortized
+ *
+ */
+vector_persistent *vector_persistent_push(const vector_persistent *p, const void *elem_ptr);
+
+/**
+ * Function: vector_persistent_set
+ *
+ * Returns a new version with the element on ``position`` replaced by the
+ * contents of ``elem_ptr``.
+ *
+ * Returns
+ *
+ *   a vector_persistent * on success
+ *   NULL if ``position`` is out of range
+ *
+ * Complexity: O(log32 n)
+ *
+ */
+vector_persistent *vector_persistent_set(const vector_persistent *p, size_t position,
+                                         const void *elem_ptr);
+
+/**
+ * Function: vector_persistent_concat
+ *
+ * Returns a new version with the elements of ``a`` followed by the ones of
+ * ``b``. Both are left untouched and share their nodes with the result.
+ *
+ * Returns
+ *
+ *   a vector_persistent * on success
+ *   NULL if the element sizes differ
+ *
+ * Complexity: O(log n)
+ *
+ */
+vector_persistent *vector_persistent_concat(const vector_persistent *a,
+                                            const vector_persistent *b);
+
+/**
+ * Function: vector_persistent_transient
+ *
+ * Returns a transient copy of ``p``: a version that may be modified in
+ * place with ``vector_persistent_append`` and ``vector_persistent_replace``
+ * until ``vector_persistent_freeze`` is called. It must not be shared
+ * while transient.
+ *
+ * Complexity: O(1)
+ *
+ */
+vector_persistent *vector_persistent_transient(const vector_persistent *p);
+
+/**
+ * Function: vector_persistent_freeze
+ *
+ * Makes a transient version immutable, like the ones returned by
+ * ``vector_persistent_push``.
+ *
+ * Complexity: O(1)
+ *
+ */
+void vector_persistent_freeze(vector_persistent *t);
+
+/**
+ * Function: vector_persistent_append
+ *
+ * Adds ``elem_ptr`` at the end of the transient ``t``.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_PERSISTENT_NOT_TRANSIENT if ``t`` is not transient
+ *
+ * Complexity: O(1) amortized
+ *
+ */
+int vector_persistent_append(vector_persistent *t, const void *elem_ptr);
+
+/**
+ * Function: vector_persistent_replace
+ *
+ * Replaces the element on ``position`` of the transient ``t``.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_PERSISTENT_NOT_TRANSIENT if ``t`` is not transient
+ *   VECT_REPLACE_INVALID_POSITION if ``position`` is out of range
+ *
+ * Complexity: O(log32 n)
+ *
+ */
+int vector_persistent_replace(vector_persistent *t, size_t position, const void *elem_ptr);
+
+/**
+ * Function: vector_persistent_free
+ *
+ * Releases one version. Nodes are freed once no version uses them.
+ *
+ */
+void vector_persistent_free(vector_persistent *p);
+
+#endif
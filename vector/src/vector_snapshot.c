@@ -0,0 +1,169 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include "vector_snapshot.h"
+
+/*
+ * Epochs: ``s->epoch`` starts at 1 and is incremented every time a version
+ * is retired, the retired version being stamped with the new value.
+ * A reader publishes the epoch it saw before loading ``s->current``, so a
+ * reader that may hold a retired version always shows an epoch older than
+ * its stamp. All these operations are sequentially consistent.
+ */
+
+vector_snapshot *
+vector_snapshot_new(vector *v)
+{
+  int i;
+
+  if (v == NULL || v->free_func != NULL) return NULL;
+
+  vector_snapshot *s = malloc(sizeof(vector_snapshot));
+  for (i = 0; i < VECTOR_SNAPSHOT_READERS; i++) {
+    s->readers[i].epoch = 0;
+    s->readers[i].registered = 0;
+  }
+  s->current = v;
+  s->epoch = 1;
+  s->retired = NULL;
+  pthread_mutex_init(&s->write_lock, NULL);
+  return s;
+}
+
+int
+vector_snapshot_register(vector_snapshot *s)
+{
+  int i, expected;
+
+  for (i = 0; i < VECTOR_SNAPSHOT_READERS; i++) {
+    expected = 0;
+    if (__atomic_compare_exchange_n(&s->readers[i].registered, &expected, 1, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      return i;
+    }
+  }
+  return VECT_SNAPSHOT_TOO_MANY_READERS;
+}
+
+void
+vector_snapshot_unregister(vector_snapshot *s, int reader)
+{
+  __atomic_store_n(&s->readers[reader].registered, 0, __ATOMIC_RELEASE);
+}
+
+const vector *
+vector_snapshot_acquire(vector_snapshot *s, int reader)
+{
+  size_t epoch = __atomic_load_n(&s->epoch, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&s->readers[reader].epoch, epoch, __ATOMIC_SEQ_CST);
+  return __atomic_load_n(&s->current, __ATOMIC_SEQ_CST);
+}
+
+void
+vector_snapshot_release(vector_snapshot *s, int reader)
+{
+  __atomic_store_n(&s->readers[reader].epoch, 0, __ATOMIC_RELEASE);
+}
+
+static vector *
+copy_version(const vector *v)
+{
+  vector *copy = vector_new_flags(v->elem_size, NULL, v->step, v->flags);
+  int i;
+
+  if (v->length > 0)
+    memcpy(vector_append_uninit(copy, v->length), v->elems, v->length * v->elem_size);
+
+  /*
+   * lazily deleted slots stay deleted at the same positions; the threshold
+   * is only set at the end so no compaction moves them halfway
+   */
+  if (v->compact_threshold > 0) {
+    vector_set_lazy_delete(copy, 1);
+    for (i = 0; i < (int)v->length; i++) {
+      if (vector_get(v, i) == NULL)
+        vector_delete(copy, i);
+    }
+    vector_set_lazy_delete(copy, v->compact_threshold);
+  }
+  return copy;
+}
+
+vector *
+vector_snapshot_begin_write(vector_snapshot *s)
+{
+  pthread_mutex_lock(&s->write_lock);
+  return copy_version(s->current);
+}
+
+/* oldest epoch a reader may still be using, or SIZE_MAX if nobody reads */
+static size_t
+oldest_reader(vector_snapshot *s)
+{
+  size_t epoch, oldest = (size_t)-1;
+  int i;
+
+  for (i = 0; i < VECTOR_SNAPSHOT_READERS; i++) {
+    epoch = __atomic_load_n(&s->readers[i].epoch, __ATOMIC_SEQ_CST);
+    if (epoch != 0 && epoch < oldest) oldest = epoch;
+  }
+  return oldest;
+}
+
+static void
+reclaim(vector_snapshot *s)
+{
+  vector_snapshot_retired **link = &s->retired;
+  size_t oldest = oldest_reader(s);
+
+  while (*link != NULL) {
+    vector_snapshot_retired *r = *link;
+    if (r->epoch <= oldest) {
+      *link = r->next;
+      vector_free(r->version);
+      free(r);
+    } else {
+      link = &r->next;
+    }
+  }
+}
+
+void
+vector_snapshot_commit_write(vector_snapshot *s, vector *next)
+{
+  vector_snapshot_retired *r = malloc(sizeof(vector_snapshot_retired));
+
+  r->version = __atomic_exchange_n(&s->current, next, __ATOMIC_SEQ_CST);
+  r->epoch = __atomic_add_fetch(&s->epoch, 1, __ATOMIC_SEQ_CST);
+  r->next = s->retired;
+  s->retired = r;
+
+  reclaim(s);
+  pthread_mutex_unlock(&s->write_lock);
+}
+
+void
+vector_snapshot_abort_write(vector_snapshot *s, vector *next)
+{
+  vector_free(next);
+  pthread_mutex_unlock(&s->write_lock);
+}
+
+void
+vector_snapshot_free(vector_snapshot *s)
+{
+  vector_snapshot_retired *r;
+
+  if (s == NULL) return;
+
+  while (s->retired != NULL) {
+    r = s->retired;
+    s->retired = r->next;
+    vector_free(r->version);
+    free(r);
+  }
+  vector_free(s->current);
+  pthread_mutex_destroy(&s->write_lock);
+  free(s);
+}
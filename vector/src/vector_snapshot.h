@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "vector.h"
+
+/**
+ * Vector snapshots
+ *
+ * Shares a read-mostly vector between threads without locking readers.
+ *
+ * The shared vector is never modified in place. A writer takes a private
+ * copy with ``vector_snapshot_begin_write``, changes it with the regular
+ * vector functions, and ``vector_snapshot_commit_write`` publishes it with
+ * a single atomic store. Readers pin the current version with
+ * ``vector_snapshot_acquire``, which costs a couple of atomic operations on
+ * the reader's own cache line, and read it with ``vector_get``,
+ * ``vector_search``, ``vector_map``...
+ *
+ * Replaced versions are reclaimed by epoch: each version is stamped when
+ * it's retired and freed once no reader that started before that point is
+ * still reading.
+ *
+ * Elements are copied byte by byte between versions, so the vector must
+ * not have a ``vector_free_func``: store values, or manage what the
+ * elements point to outside of the snapshot.
+ */
+
+#ifndef _VECTOR_SNAPSHOT
+#define _VECTOR_SNAPSHOT
+
+/* maximum number of registered reader threads */
+#ifndef VECTOR_SNAPSHOT_READERS
+#define VECTOR_SNAPSHOT_READERS 128
+#endif
+
+#define VECTOR_SNAPSHOT_CACHE_LINE 64
+
+/**
+ * Type: vector_snapshot_slot
+ *
+ * Epoch observed by one reader (0 when not reading), padded to its own
+ * cache line so readers don't contend.
+ */
+typedef struct {
+  size_t epoch;
+  int registered;
+  char pad[VECTOR_SNAPSHOT_CACHE_LINE - sizeof(size_t) - sizeof(int)];
+} vector_snapshot_slot;
+
+typedef struct vector_snapshot_retired {
+  vector *version;
+  size_t epoch;
+  struct vector_snapshot_retired *next;
+} vector_snapshot_retired;
+
+/**
+ * Type: vector_snapshot
+ *
+ * Defines the concrete representation of the snapshot.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  vector_snapshot_slot readers[VECTOR_SNAPSHOT_READERS];
+  vector *current;
+  size_t epoch;
+  vector_snapshot_retired *retired;
+  pthread_mutex_t write_lock;
+} vector_snapshot;
+
+
+/**
+ * Function: vector_snapshot_new
+ * Usage: vector_snapshot *routes = vector_snapshot_new(initial_routes);
+ *
+ * Constructs a snapshot whose first version is ``v``. The snapshot takes
+ * ownership of ``v``.
+ *
+ * Returns
+ *
+ *   a vector_snapshot * on success
+ *   NULL if ``v`` is NULL or has a ``vector_free_func``
+ *
+ * Note that the call to ``vector_snapshot_free`` is mandatory
+ *
+ */
+vector_snapshot *vector_snapshot_new(vector *v);
+
+/**
+ * Function: vector_snapshot_register
+ *
+ * Registers a reader thread. Each reader thread needs its own id, used in
+ * ``vector_snapshot_acquire`` and ``vector_snapshot_release``.
+ *
+ * Returns
+ *
+ *   the reader id (>= 0) on success
+ *   VECT_SNAPSHOT_TOO_MANY_READERS if all VECTOR_SNAPSHOT_READERS ids are in use
+ *
+ */
+int vector_snapshot_register(vector_snapshot *s);
+
+/**
+ * Function: vector_snapshot_unregister
+ *
+ * Gives back a reader id. The reader must not be between acquire and release.
+ *
+ */
+void vector_snapshot_unregister(vector_snapshot *s, int reader);
+
+/**
+ * Function: vector_snapshot_acquire
+ *
+ * Returns the current version of the vector. It remains valid, and
+ * unchanged, until ``vector_snapshot_release`` is called with the same
+ * ``reader``, even if writers publish newer versions in the meantime.
+ * The version must only be read.
+ *
+ * Complexity: O(1), lock-free
+ *
+ */
+const vector *vector_snapshot_acquire(vector_snapshot *s, int reader);
+
+/**
+ * Function: vector_snapshot_release
+ *
+ * Ends the read started by ``vector_snapshot_acquire``.
+ *
+ * Complexity: O(1)
+ *
+ */
+void vector_snapshot_release(vector_snapshot *s, int reader);
+
+/**
+ * Function: vector_snapshot_begin_write
+ *
+ * Waits for other writers and returns a private copy of the current version
+ * that can be modified with any vector function. It must be passed to
+ * either ``vector_snapshot_commit_write`` or ``vector_snapshot_abort_write``.
+ *
+ * Complexity: O(n)
+ *
+ */
+vector *vector_snapshot_begin_write(vector_snapshot *s);
+
+/**
+ * Function: vector_snapshot_commit_write
+ *
+ * Publishes ``next`` as the current version. Readers that acquire from now
+ * on see it; the replaced version is freed once the readers still using it
+ * release it. Versions retired earlier are reclaimed here as well.
+ *
+ */
+void vector_snapshot_commit_write(vector_snapshot *s, vector *next);
+
+/**
+ * Function: vector_snapshot_abort_write
+ *
+ * Discards ``next`` leaving the current version in place.
+ *
+ */
+void vector_snapshot_abort_write(vector_snapshot *s, vector *next);
+
+/**
+ * Function: vector_snapshot_free
+ *
+ * Frees the current and all retired versions. No thread may be reading or
+ * writing.
+ *
+ */
+void vector_snapshot_free(vector_snapshot *s);
+
+#endif
@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vector_soa.h"
+
+#define COLUMN_AT(v, f, i) ((char *)(v)->columns[f] + (i) * (v)->fields[f].size)
+
+vector_soa *
+vector_soa_new(size_t elem_size, const vector_soa_field *fields,
+               size_t num_fields, vector_free_func free_func, int initial)
+{
+  size_t f;
+
+  if (elem_size == 0 || fields == NULL || num_fields == 0 || initial <= 0)
+    return NULL;
+
+  for (f = 0; f < num_fields; f++) {
+    if (fields[f].size == 0 || fields[f].offset + fields[f].size > elem_size)
+      return NULL;
+  }
+
+  vector_soa *v = malloc(sizeof(vector_soa));
+  v->elem_size = elem_size;
+  v->num_fields = num_fields;
+  v->free_func = free_func;
+  v->length = 0;
+  v->alloc_length = initial;
+
+  v->fields = malloc(num_fields * sizeof(vector_soa_field));
+  memcpy(v->fields, fields, num_fields * sizeof(vector_soa_field));
+
+  v->columns = malloc(num_fields * sizeof(void *));
+  for (f = 0; f < num_fields; f++)
+    v->columns[f] = malloc(initial * fields[f].size);
+
+  return v;
+}
+
+size_t
+vector_soa_length(const vector_soa *v)
+{
+  return v->length;
+}
+
+static void
+grow_if_needed(vector_soa *v)
+{
+  size_t f;
+
+  if (v->length == v->alloc_length) {
+    v->alloc_length *= 2;
+    for (f = 0; f < v->num_fields; f++)
+      v->columns[f] = realloc(v->columns[f], v->alloc_length * v->fields[f].size);
+  }
+}
+
+static void
+scatter(vector_soa *v, size_t position, const void *elem_ptr)
+{
+  size_t f;
+  for (f = 0; f < v->num_fields; f++)
+    memcpy(COLUMN_AT(v, f, position),
+           (const char *)elem_ptr + v->fields[f].offset, v->fields[f].size);
+}
+
+static void
+gather(const vector_soa *v, size_t position, void *elem_ptr)
+{
+  size_t f;
+  for (f = 0; f < v->num_fields; f++)
+    memcpy((char *)elem_ptr + v->fields[f].offset,
+           COLUMN_AT(v, f, position), v->fields[f].size);
+}
+
+void
+vector_soa_append(vector_soa *v, const void *elem_ptr)
+{
+  grow_if_needed(v);
+  scatter(v, v->length, elem_ptr);
+  v->length++;
+}
+
+int
+vector_soa_get(const vector_soa *v, int position, void *elem_ptr)
+{
+  if (position < 0 || position >= (int)v->length)
+    return VECT_GET_INVALID_POSITION;
+
+  gather(v, position, elem_ptr);
+  return VECT_OK;
+}
+
+void *
+vector_soa_get_field(const vector_soa *v, int position, size_t field)
+{
+  if (position < 0 || position >= (int)v->length || field >= v->num_fields)
+    return NULL;
+  return COLUMN_AT(v, field, position);
+}
+
+void *
+vector_soa_column(const vector_soa *v, size_t field)
+{
+  if (field >= v->num_fields) return NULL;
+  return v->columns[field];
+}
+
+static void
+free_record(const vector_soa *v, size_t position, void *scratch)
+{
+  gather(v, position, scratch);
+  v->free_func(scratch);
+}
+
+int
+vector_soa_delete(vector_soa *v, int position)
+{
+  size_t f;
+
+  if (position < 0 || position >= (int)v->length) {
+    return VECT_DELETE_INVALID_POSITION;
+  }
+
+  if (v->free_func != NULL) {
+    void *scratch = calloc(1, v->elem_size);
+    free_record(v, position, scratch);
+    free(scratch);
+  }
+
+  if (position != (int)v->length - 1) {
+    for (f = 0; f < v->num_fields; f++) {
+      memmove(COLUMN_AT(v, f, position), COLUMN_AT(v, f, position + 1),
+              (v->length - (position + 1)) * v->fields[f].size);
+    }
+  }
+
+  v->length--;
+  return VECT_OK;
+}
+
+/*
+ * Sorting permutes every column, so the order is computed once on an array
+ * of indices (bottom-up merge sort comparing values of the sort column) and
+ * then applied to each column with a single gather pass.
+ */
+static void
+sort_indices(const vector_soa *v, size_t field, vector_cmp_func cmp_func,
+             size_t *idx, size_t *tmp)
+{
+  size_t width, lo, n = v->length;
+
+  for (width = 1; width < n; width *= 2) {
+    for (lo = 0; lo < n; lo += 2 * width) {
+      size_t mid = (lo + width < n) ? lo + width : n;
+      size_t hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+      size_t i = lo, j = mid, k = lo;
+
+      while (i < mid && j < hi) {
+        if (cmp_func(COLUMN_AT(v, field, idx[j]), COLUMN_AT(v, field, idx[i])) < 0)
+          tmp[k++] = idx[j++];
+        else
+          tmp[k++] = idx[i++];
+      }
+      while (i < mid) tmp[k++] = idx[i++];
+      while (j < hi) tmp[k++] = idx[j++];
+    }
+    memcpy(idx, tmp, n * sizeof(size_t));
+  }
+}
+
+void
+vector_soa_sort(vector_soa *v, size_t field, vector_cmp_func cmp_func)
+{
+  size_t f, i, *idx, *tmp;
+
+  if (cmp_func == NULL || field >= v->num_fields || v->length < 2) return;
+
+  idx = malloc(v->length * sizeof(size_t));
+  tmp = malloc(v->length * sizeof(size_t));
+  for (i = 0; i < v->length; i++)
+    idx[i] = i;
+
+  sort_indices(v, field, cmp_func, idx, tmp);
+
+  for (f = 0; f < v->num_fields; f++) {
+    size_t size = v->fields[f].size;
+    char *sorted = malloc(v->alloc_length * size);
+    for (i = 0; i < v->length; i++)
+      memcpy(sorted + i * size, COLUMN_AT(v, f, idx[i]), size);
+    free(v->columns[f]);
+    v->columns[f] = sorted;
+  }
+
+  free(tmp);
+  free(idx);
+}
+
+void
+vector_soa_free(vector_soa *v)
+{
+  size_t f, i;
+
+  if (v == NULL) return;
+
+  if (v->free_func != NULL) {
+    void *scratch = calloc(1, v->elem_size);
+    for (i = 0; i < v->length; i++)
+      free_record(v, i, scratch);
+    free(scratch);
+  }
+
+  for (f = 0; f < v->num_fields; f++)
+    free(v->columns[f]);
+  free(v->columns);
+  free(v->fields);
+  free(v);
+}
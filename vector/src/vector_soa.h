@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "vector.h"
+
+/**
+ * Columnar vector (struct of arrays)
+ *
+ * The columnar vector stores records of ``elem_size`` bytes like ``vector``
+ * does, but instead of keeping each record contiguous it splits them into
+ * fields and stores each field in its own contiguous array (column).
+ *
+ * Scans that touch only one field walk a single dense array, so every byte
+ * brought into cache is useful and the loop can be vectorized by the compiler.
+ */
+
+#ifndef _VECTOR_SOA
+#define _VECTOR_SOA
+
+/**
+ * Type: vector_soa_field
+ *
+ * Describes where a field lives inside the client's record: ``offset`` is
+ * the byte offset of the field (use ``offsetof``) and ``size`` its size
+ * in bytes.
+ */
+typedef struct {
+  size_t offset;
+  size_t size;
+} vector_soa_field;
+
+
+/**
+ * Type: vector_soa
+ *
+ * Defines the concrete representation of the columnar vector.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  void **columns;
+  vector_soa_field *fields;
+  size_t num_fields;
+  size_t elem_size;
+  size_t length;
+  size_t alloc_length;
+  vector_free_func free_func;
+} vector_soa;
+
+
+/**
+ * Function: vector_soa_new
+ * Usage: vector_soa *v = vector_soa_new(sizeof(point), fields, 2, NULL, 10);
+ *
+ * Constructs an empty columnar vector.
+ *
+ * Parameters
+ *
+ * ``elem_size``
+ *   size of the client's record, as in ``vector_new``.
+ *
+ * ``fields``
+ *   array with the layout of each field in the record. It is copied, so the
+ *   client may release it after the call. Fields are identified by their
+ *   index in this array in the other functions.
+ *
+ * ``num_fields``
+ *   number of entries in ``fields``
+ *
+ * ``free_func``
+ *   called with a pointer to a reassembled record that is about to be
+ *   deleted or freed. Should be NULL if the records don't require any
+ *   special handling.
+ *
+ * ``initial``
+ *   initial allocated length. The allocated length doubles every time the
+ *   vector gets full.
+ *
+ * Returns
+ *
+ *   a vector_soa * on success
+ *   NULL if ``elem_size``, ``num_fields`` or ``initial`` are 0 (zero), or if a
+ *   field doesn't fit inside ``elem_size``
+ *
+ * Note that the call to ``vector_soa_free`` is mandatory
+ *
+ */
+vector_soa *vector_soa_new(size_t elem_size, const vector_soa_field *fields,
+                           size_t num_fields, vector_free_func free_func,
+                           int initial);
+
+/**
+ * Function: vector_soa_length
+ *
+ * Returns
+ *
+ *  The number of records currently in the vector (logical length).
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t vector_soa_length(const vector_soa *v);
+
+/**
+ * Function: vector_soa_append
+ *
+ * Add a record to the end of the vector. Each field of the record pointed
+ * by ``elem_ptr`` is copied to the end of its column.
+ *
+ * Complexity: O(number of fields), ignoring the grow if necessary
+ *
+ */
+void vector_soa_append(vector_soa *v, const void *elem_ptr);
+
+/**
+ * Function: vector_soa_get
+ *
+ * Reassembles the record on ``position`` into the memory pointed by
+ * ``elem_ptr``, which must have room for ``elem_size`` bytes. Bytes not
+ * covered by any field are left untouched.
+ *
+ * Returns
+ *
+ *  VECT_OK on success
+ *  VECT_GET_INVALID_POSITION if ``position`` is < 0 or greater than logical length
+ *
+ * Complexity: O(number of fields)
+ *
+ */
+int vector_soa_get(const vector_soa *v, int position, void *elem_ptr);
+
+/**
+ * Function: vector_soa_get_field
+ *
+ * Returns a pointer to the value of ``field`` in the record on ``position``.
+ *
+ * The pointer becomes invalid after any insertion, deletion or sorting, see
+ * ``vector_get``.
+ *
+ * Returns
+ *
+ *  A pointer into the column of ``field``
+ *  NULL if ``position`` or ``field`` are out of bounds
+ *
+ * Complexity: O(1)
+ *
+ */
+void *vector_soa_get_field(const vector_soa *v, int position, size_t field);
+
+/**
+ * Function: vector_soa_column
+ *
+ * Returns the base of the contiguous array holding ``field`` for all the
+ * records, ``vector_soa_length`` values of the field size each. This is the
+ * entry point for tight per-field scans.
+ *
+ * Returns NULL if ``field`` is out of bounds.
+ *
+ * Complexity: O(1)
+ *
+ */
+void *vector_soa_column(const vector_soa *v, size_t field);
+
+/**
+ * Function: vector_soa_delete
+ *
+ * Deletes the record at the specified position, calling ``free_func`` on
+ * the reassembled record first. All the records after ``position`` are
+ * shifted over in every column.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_DELETE_INVALID_POSITION if ``position`` is < 0 or greater than logical length
+ *
+ * Complexity: O(n)
+ *
+ */
+int vector_soa_delete(vector_soa *v, int position);
+
+/**
+ * Function: vector_soa_sort
+ *
+ * Sorts all the records into ascending order of ``field``. ``cmp_func``
+ * receives pointers to values of the field, not to records.
+ * The sort is stable.
+ *
+ * If ``cmp_func`` is NULL or ``field`` is out of bounds nothing is done
+ *
+ * Complexity: O(n log n)
+ *
+ */
+void vector_soa_sort(vector_soa *v, size_t field, vector_cmp_func cmp_func);
+
+/**
+ * Function: vector_soa_free
+ *
+ * Frees up all the memory of the specified vector and its records.
+ * ``free_func`` will be called for all records in the vector.
+ *
+ */
+void vector_soa_free(vector_soa *v);
+
+#endif
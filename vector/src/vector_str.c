@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vector_str.h"
+
+#define PREFIX_BYTES 8
+
+/* first bytes of the string, big-endian and zero padded */
+static uint64_t
+make_prefix(const char *data, size_t length)
+{
+  uint64_t prefix = 0;
+  size_t i;
+
+  for (i = 0; i < PREFIX_BYTES; i++) {
+    prefix <<= 8;
+    if (i < length)
+      prefix |= (unsigned char)data[i];
+  }
+  return prefix;
+}
+
+vector_str *
+vector_str_new(size_t initial_bytes, size_t initial)
+{
+  if (initial_bytes == 0 || initial == 0)
+    return NULL;
+
+  vector_str *v = malloc(sizeof(vector_str));
+  v->arena = malloc(initial_bytes);
+  v->arena_length = 0;
+  v->arena_alloc = initial_bytes;
+  v->entries = malloc(initial * sizeof(vector_str_entry));
+  v->length = 0;
+  v->alloc_length = initial;
+  return v;
+}
+
+size_t
+vector_str_length(const vector_str *v)
+{
+  return v->length;
+}
+
+void
+vector_str_append(vector_str *v, const char *data, size_t length)
+{
+  vector_str_entry *e;
+
+  if (v->arena_length + length + 1 > v->arena_alloc) {
+    while (v->arena_length + length + 1 > v->arena_alloc)
+      v->arena_alloc *= 2;
+    v->arena = realloc(v->arena, v->arena_alloc);
+  }
+
+  if (v->length == v->alloc_length) {
+    v->alloc_length *= 2;
+    v->entries = realloc(v->entries, v->alloc_length * sizeof(vector_str_entry));
+  }
+
+  e = &v->entries[v->length++];
+  e->prefix = make_prefix(data, length);
+  e->offset = v->arena_length;
+  e->length = length;
+
+  memcpy(v->arena + v->arena_length, data, length);
+  v->arena[v->arena_length + length] = '\0';
+  v->arena_length += length + 1;
+}
+
+const char *
+vector_str_get(const vector_str *v, size_t position, size_t *length)
+{
+  if (position >= v->length)
+    return NULL;
+
+  if (length != NULL)
+    *length = v->entries[position].length;
+  return v->arena + v->entries[position].offset;
+}
+
+/*
+ * Byte order of two strings. Different prefixes settle it; otherwise the
+ * first 8 bytes (or all of the shorter string) are equal, and only the rest
+ * is compared.
+ */
+static int
+compare(const vector_str *v, const vector_str_entry *e, uint64_t prefix,
+        const char *data, size_t length)
+{
+  size_t common;
+  int cmp;
+
+  if (e->prefix != prefix)
+    return e->prefix < prefix ? -1 : 1;
+
+  common = e->length < length ? e->length : length;
+  if (common > PREFIX_BYTES) {
+    cmp = memcmp(v->arena + e->offset + PREFIX_BYTES, data + PREFIX_BYTES,
+                 common - PREFIX_BYTES);
+    if (cmp != 0)
+      return cmp;
+  }
+
+  if (e->length == length)
+    return 0;
+  return e->length < length ? -1 : 1;
+}
+
+static int
+compare_entries(const vector_str *v, const vector_str_entry *e1, const vector_str_entry *e2)
+{
+  return compare(v, e1, e2->prefix, v->arena + e2->offset, e2->length);
+}
+
+/* bottom-up merge sort of the entries, like ``vector_soa_sort`` */
+void
+vector_str_sort(vector_str *v)
+{
+  size_t width, lo, n = v->length;
+  vector_str_entry *src = v->entries, *dst, *tmp;
+
+  if (n < 2) return;
+
+  dst = malloc(n * sizeof(vector_str_entry));
+  tmp = dst;
+
+  for (width = 1; width < n; width *= 2) {
+    for (lo = 0; lo < n; lo += 2 * width) {
+      size_t mid = (lo + width < n) ? lo + width : n;
+      size_t hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+      size_t i = lo, j = mid, k = lo;
+
+      while (i < mid && j < hi) {
+        if (compare_entries(v, &src[j], &src[i]) < 0)
+          dst[k++] = src[j++];
+        else
+          dst[k++] = src[i++];
+      }
+      while (i < mid) dst[k++] = src[i++];
+      while (j < hi) dst[k++] = src[j++];
+    }
+    tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  if (src != v->entries) {
+    memcpy(v->entries, src, n * sizeof(vector_str_entry));
+    free(src);
+  } else {
+    free(dst);
+  }
+}
+
+int
+vector_str_search(const vector_str *v, const char *key, size_t length, bool is_sorted)
+{
+  uint64_t prefix;
+  size_t i;
+
+  if (key == NULL) {
+    return VECT_SEARCH_INVALID_KEY;
+  }
+
+  prefix = make_prefix(key, length);
+
+  if (is_sorted) {
+    size_t low = 0, high = v->length;
+    while (low < high) {
+      size_t middle = low + (high - low) / 2;
+      int cmp = compare(v, &v->entries[middle], prefix, key, length);
+      if (cmp < 0)
+        low = middle + 1;
+      else if (cmp > 0)
+        high = middle;
+      else
+        return middle;
+    }
+  } else {
+    for (i = 0; i < v->length; i++) {
+      if (compare(v, &v->entries[i], prefix, key, length) == 0) return i;
+    }
+  }
+  return VECT_SEARCH_NOT_FOUND;
+}
+
+void
+vector_str_clear(vector_str *v)
+{
+  v->arena_length = 0;
+  v->length = 0;
+}
+
+void
+vector_str_free(vector_str *v)
+{
+  if (v == NULL) return;
+
+  free(v->entries);
+  free(v->arena);
+  free(v);
+}
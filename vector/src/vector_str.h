@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "vector.h"
+
+/**
+ * String pool vector
+ *
+ * Stores variable length strings (or any byte blobs) back to back in one
+ * growing arena, plus an array with the position and length of each one.
+ * Compared to a ``vector`` of ``char *`` filled with ``strdup`` there is no
+ * malloc per string, strings appended together are adjacent in memory, and
+ * freeing the whole vector is two calls to free().
+ *
+ * Each entry also keeps the first 8 bytes of its string packed in a
+ * big-endian integer, so sorting and searching decide most comparisons with
+ * a single integer compare, without touching the arena.
+ */
+
+#ifndef _VECTOR_STR
+#define _VECTOR_STR
+
+typedef struct {
+  uint64_t prefix;
+  size_t offset;
+  size_t length;
+} vector_str_entry;
+
+/**
+ * Type: vector_str
+ *
+ * Defines the concrete representation of the string pool vector.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  char *arena;
+  size_t arena_length;
+  size_t arena_alloc;
+  vector_str_entry *entries;
+  size_t length;
+  size_t alloc_length;
+} vector_str;
+
+
+/**
+ * Function: vector_str_new
+ * Usage: vector_str *tokens = vector_str_new(1 << 20, 1 << 16);
+ *
+ * Constructs an empty string pool vector.
+ *
+ * Parameters
+ *
+ * ``initial_bytes``
+ *   initial size of the arena, doubled every time it gets full
+ *
+ * ``initial``
+ *   initial number of strings, doubled every time it's reached
+ *
+ * Returns
+ *
+ *   a vector_str * on success
+ *   NULL if ``initial_bytes`` or ``initial`` are 0 (zero)
+ *
+ * Note that the call to ``vector_str_free`` is mandatory
+ *
+ */
+vector_str *vector_str_new(size_t initial_bytes, size_t initial);
+
+/**
+ * Function: vector_str_length
+ *
+ * Returns
+ *
+ *  The number of strings in the vector.
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t vector_str_length(const vector_str *v);
+
+/**
+ * Function: vector_str_append
+ * Usage: vector_str_append(tokens, line + start, end - start);
+ *
+ * Copies ``length`` bytes from ``data`` to the end of the arena, followed
+ * by a '\0' so the string can also be used as a C string.
+ *
+ * Complexity: O(length) amortized
+ *
+ */
+void vector_str_append(vector_str *v, const char *data, size_t length);
+
+/**
+ * Function: vector_str_get
+ *
+ * Returns a pointer to the string on ``position`` and stores its length in
+ * ``length`` (if not NULL). Like ``vector_get``, the pointer becomes invalid
+ * after the next append.
+ *
+ * Returns
+ *
+ *  A pointer to the string on ``position``.
+ *  NULL if position is greater than logical length
+ *
+ * Complexity: O(1)
+ *
+ */
+const char *vector_str_get(const vector_str *v, size_t position, size_t *length);
+
+/**
+ * Function: vector_str_sort
+ *
+ * Sorts the strings in byte order (as ``memcmp``, with a string sorted
+ * before the longer strings it's a prefix of). Only the entries are
+ * reordered, the bytes in the arena don't move.
+ *
+ * Complexity: O(n log n)
+ *
+ */
+void vector_str_sort(vector_str *v);
+
+/**
+ * Function: vector_str_search
+ *
+ * Searches for a string equal to the ``length`` bytes of ``key``.
+ *
+ * Parameters
+ *
+ *   ``is_sorted``
+ *     if true a binary search is performed, the vector must have been
+ *     sorted with ``vector_str_sort``. If false it uses a linear search
+ *
+ * Returns
+ *
+ *   The position of the matching string if found.
+ *   VECT_SEARCH_NOT_FOUND if it was not found
+ *   VECT_SEARCH_INVALID_KEY if ``key`` is NULL
+ *
+ * Complexity: O(log n) if ``is_sorted`` is true. O(n) if ``is_sorted`` is false.
+ *
+ */
+int vector_str_search(const vector_str *v, const char *key, size_t length, bool is_sorted);
+
+/**
+ * Function: vector_str_clear
+ *
+ * Removes all the strings, keeping the allocated memory for reuse.
+ *
+ * Complexity: O(1)
+ *
+ */
+void vector_str_clear(vector_str *v);
+
+/**
+ * Function: vector_str_free
+ *
+ * Frees up all the memory of the vector and its strings.
+ *
+ * Complexity: O(1)
+ *
+ */
+void vector_str_free(vector_str *v);
+
+#endif
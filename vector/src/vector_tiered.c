@@ -0,0 +1,268 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vector_tiered.h"
+
+#define BLOCK(t) ((size_t)1 << (t)->block_bits)
+#define MASK(t) (BLOCK(t) - 1)
+
+/* position ``i`` of a block's circular buffer */
+static char *
+slot(const vector_tiered *t, const vector_tiered_block *b, size_t i)
+{
+  return b->elems + ((b->head + i) & MASK(t)) * t->elem_size;
+}
+
+/* elements in block ``k``: all of them are full but the last */
+static size_t
+block_count(const vector_tiered *t, size_t k)
+{
+  return k + 1 < t->num_blocks ? BLOCK(t) : t->length - (k << t->block_bits);
+}
+
+static void
+add_block(vector_tiered *t)
+{
+  vector_tiered_block *b;
+
+  if (t->num_blocks == t->alloc_blocks) {
+    t->alloc_blocks = t->alloc_blocks > 0 ? t->alloc_blocks * 2 : 4;
+    t->blocks = realloc(t->blocks, t->alloc_blocks * sizeof(vector_tiered_block));
+  }
+
+  b = &t->blocks[t->num_blocks++];
+  b->elems = t->spare != NULL ? t->spare : malloc(BLOCK(t) * t->elem_size);
+  b->head = 0;
+  t->spare = NULL;
+}
+
+static void
+init_fields(vector_tiered *t, size_t elem_size, vector_free_func free_func, int block_bits)
+{
+  t->elem_size = elem_size;
+  t->length = 0;
+  t->block_bits = block_bits;
+  t->blocks = NULL;
+  t->num_blocks = 0;
+  t->alloc_blocks = 0;
+  t->spare = NULL;
+  t->free_func = free_func;
+}
+
+/* smallest block size of at least sqrt(length) */
+static int
+block_bits_for(size_t length)
+{
+  int bits = VECTOR_TIERED_MIN_BITS;
+
+  while (((size_t)1 << (2 * bits)) < length)
+    bits++;
+  return bits;
+}
+
+/* copies ``count`` elements to the end, filling up the last block first */
+static void
+append_run(vector_tiered *t, const char *elems, size_t count)
+{
+  size_t n, used;
+
+  while (count > 0) {
+    used = t->length & MASK(t);
+    if (used == 0)
+      add_block(t);
+    n = BLOCK(t) - used < count ? BLOCK(t) - used : count;
+    memcpy(slot(t, &t->blocks[t->num_blocks - 1], used), elems, n * t->elem_size);
+    t->length += n;
+    elems += n * t->elem_size;
+    count -= n;
+  }
+}
+
+/* moves everything to blocks twice as big */
+static void
+grow_blocks(vector_tiered *t)
+{
+  vector_tiered old = *t;
+  size_t k, count, first;
+
+  init_fields(t, old.elem_size, old.free_func, old.block_bits + 1);
+  for (k = 0; k < old.num_blocks; k++) {
+    vector_tiered_block *b = &old.blocks[k];
+
+    /* the two contiguous pieces of the circular buffer */
+    count = block_count(&old, k);
+    first = BLOCK(&old) - b->head;
+    if (first > count) first = count;
+
+    append_run(t, slot(&old, b, 0), first);
+    append_run(t, b->elems, count - first);
+
+    free(b->elems);
+  }
+  free(old.blocks);
+  free(old.spare);
+}
+
+vector_tiered *
+vector_tiered_new(size_t elem_size, vector_free_func free_func)
+{
+  if (elem_size == 0) return NULL;
+
+  vector_tiered *t = malloc(sizeof(vector_tiered));
+  init_fields(t, elem_size, free_func, VECTOR_TIERED_MIN_BITS);
+  return t;
+}
+
+vector_tiered *
+vector_tiered_from_vector(const vector *v)
+{
+  vector_tiered *t = malloc(sizeof(vector_tiered));
+  const void *span;
+  size_t position = 0, count;
+
+  init_fields(t, v->elem_size, NULL, block_bits_for(vector_length(v)));
+  while ((span = vector_next_span(v, &position, &count)) != NULL)
+    append_run(t, span, count);
+  return t;
+}
+
+size_t
+vector_tiered_length(const vector_tiered *t)
+{
+  return t->length;
+}
+
+void *
+vector_tiered_get(const vector_tiered *t, size_t position)
+{
+  if (position >= t->length) return NULL;
+  return slot(t, &t->blocks[position >> t->block_bits], position & MASK(t));
+}
+
+int
+vector_tiered_insert(vector_tiered *t, const void *elem_ptr, size_t position)
+{
+  size_t k, i, offset, count, size = t->elem_size;
+  vector_tiered_block *b;
+
+  if (position > t->length) {
+    return VECT_INSERT_INVALID_POSITION;
+  }
+
+  if (t->length >= BLOCK(t) * BLOCK(t) * 4)
+    grow_blocks(t);
+  if (t->length == t->num_blocks << t->block_bits)
+    add_block(t);
+
+  /* each block after the target one hands its last element to the next */
+  for (k = t->num_blocks - 1; k > position >> t->block_bits; k--) {
+    b = &t->blocks[k];
+    b->head = (b->head - 1) & MASK(t);
+    memcpy(slot(t, b, 0), slot(t, &t->blocks[k - 1], BLOCK(t) - 1), size);
+  }
+
+  /* the target block has a free slot at its end, make room at offset */
+  b = &t->blocks[position >> t->block_bits];
+  offset = position & MASK(t);
+  count = (position >> t->block_bits) + 1 < t->num_blocks ? BLOCK(t) - 1 :
+          t->length - ((t->num_blocks - 1) << t->block_bits);
+
+  if (offset < count - offset) {
+    b->head = (b->head - 1) & MASK(t);
+    for (i = 0; i < offset; i++)
+      memcpy(slot(t, b, i), slot(t, b, i + 1), size);
+  } else {
+    for (i = count; i > offset; i--)
+      memcpy(slot(t, b, i), slot(t, b, i - 1), size);
+  }
+  memcpy(slot(t, b, offset), elem_ptr, size);
+  t->length++;
+
+  return VECT_OK;
+}
+
+void
+vector_tiered_append(vector_tiered *t, const void *elem_ptr)
+{
+  vector_tiered_insert(t, elem_ptr, t->length);
+}
+
+int
+vector_tiered_delete(vector_tiered *t, size_t position)
+{
+  size_t k, i, offset, count, size = t->elem_size;
+  vector_tiered_block *b;
+
+  if (position >= t->length) {
+    return VECT_DELETE_INVALID_POSITION;
+  }
+
+  k = position >> t->block_bits;
+  b = &t->blocks[k];
+  offset = position & MASK(t);
+  count = block_count(t, k);
+
+  if (t->free_func != NULL) {
+    t->free_func(slot(t, b, offset));
+  }
+
+  /* close the gap from the nearest end of the block */
+  if (offset < count - 1 - offset) {
+    for (i = offset; i > 0; i--)
+      memcpy(slot(t, b, i), slot(t, b, i - 1), size);
+    b->head = (b->head + 1) & MASK(t);
+  } else {
+    for (i = offset; i + 1 < count; i++)
+      memcpy(slot(t, b, i), slot(t, b, i + 1), size);
+  }
+
+  /* and refill it with the first element of each following block */
+  for (k = k + 1; k < t->num_blocks; k++) {
+    b = &t->blocks[k];
+    memcpy(slot(t, &t->blocks[k - 1], BLOCK(t) - 1), slot(t, b, 0), size);
+    b->head = (b->head + 1) & MASK(t);
+  }
+
+  /* keep the emptied block, so deletes and inserts around a block
+     boundary do not free and malloc it each time */
+  t->length--;
+  if (t->length == (t->num_blocks - 1) << t->block_bits) {
+    free(t->spare);
+    t->spare = t->blocks[--t->num_blocks].elems;
+  }
+
+  return VECT_OK;
+}
+
+void
+vector_tiered_map(vector_tiered *t, vector_map_func map_func, void *data)
+{
+  size_t k, i, count;
+
+  if (map_func == NULL) return;
+
+  for (k = 0; k < t->num_blocks; k++) {
+    count = block_count(t, k);
+    for (i = 0; i < count; i++)
+      map_func(slot(t, &t->blocks[k], i), data);
+  }
+}
+
+void
+vector_tiered_free(vector_tiered *t)
+{
+  size_t k, i, count;
+
+  if (t == NULL) return;
+
+  for (k = 0; k < t->num_blocks; k++) {
+    if (t->free_func != NULL) {
+      count = block_count(t, k);
+      for (i = 0; i < count; i++)
+        t->free_func(slot(t, &t->blocks[k], i));
+    }
+    free(t->blocks[k].elems);
+  }
+  free(t->blocks);
+  free(t->spare);
+  free(t);
+}
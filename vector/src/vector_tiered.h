@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "vector.h"
+
+/**
+ * Tiered vector
+ *
+ * An indexed sequence like ``vector`` for large vectors edited in the
+ * middle. ``vector_insert`` moves every element after the position, while
+ * here inserting and deleting cost O(sqrt n).
+ *
+ * The elements are split in blocks of B elements, B being a power of two
+ * close to sqrt(n). Every block but the last is full, so the block of a
+ * position is found with a shift, and each block is a circular buffer. An
+ * insert makes room in its block moving at most B/2 elements, then the
+ * element pushed out of the block's end becomes the first of the next
+ * block, and so on: O(1) for each of the following n/B blocks. B doubles
+ * when there are 4B blocks. The last block emptied by a delete is kept as
+ * a spare for the next insert.
+ *
+ * Elements inside a block are contiguous except for a wrap around, so
+ * ``vector_tiered_map`` still scans memory mostly sequentially.
+ */
+
+#ifndef _VECTOR_TIERED
+#define _VECTOR_TIERED
+
+/* log2 of the smallest block size */
+#define VECTOR_TIERED_MIN_BITS 6
+
+typedef struct {
+  char *elems;
+  size_t head;
+} vector_tiered_block;
+
+/**
+ * Type: vector_tiered
+ *
+ * Defines the concrete representation of the tiered vector.
+ * This type should not be accessed directly, all the fields are private. The
+ * client should interact using the functions defined bellow.
+ */
+typedef struct {
+  size_t elem_size;
+  size_t length;
+  int block_bits;
+  vector_tiered_block *blocks;
+  size_t num_blocks;
+  size_t alloc_blocks;
+  char *spare;
+  vector_free_func free_func;
+} vector_tiered;
+
+
+/**
+ * Function: vector_tiered_new
+ *
+ * Constructs an empty tiered vector. ``free_func`` has the same meaning as
+ * in ``vector_new``.
+ *
+ * Returns
+ *
+ *   a vector_tiered * on success
+ *   NULL if ``elem_size`` is 0 (zero)
+ *
+ */
+vector_tiered *vector_tiered_new(size_t elem_size, vector_free_func free_func);
+
+/**
+ * Function: vector_tiered_from_vector
+ *
+ * Builds a tiered vector with the elements of ``v``, with the block size
+ * picked for its length. Elements are copied byte by byte and no
+ * ``vector_free_func`` is set. Lazily deleted elements of ``v`` are left
+ * out.
+ *
+ * Complexity: O(n)
+ *
+ */
+vector_tiered *vector_tiered_from_vector(const vector *v);
+
+/**
+ * Function: vector_tiered_length
+ *
+ * Returns
+ *
+ *  The number of elements in the vector.
+ *
+ * Complexity: O(1)
+ *
+ */
+size_t vector_tiered_length(const vector_tiered *t);
+
+/**
+ * Function: vector_tiered_get
+ *
+ * Returns
+ *
+ *   A pointer to the element on ``position``. It becomes invalid after an
+ *   insert or delete.
+ *   NULL if ``position`` is out of range
+ *
+ * Complexity: O(1)
+ *
+ */
+void *vector_tiered_get(const vector_tiered *t, size_t position);
+
+/**
+ * Function: vector_tiered_insert
+ *
+ * Inserts a copy of the element pointed by ``elem_ptr`` on ``position``,
+ * moving the elements from ``position`` one place up.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_INSERT_INVALID_POSITION if ``position`` is greater than the length
+ *
+ * Complexity: O(sqrt n), O(n) when the block size doubles
+ *
+ */
+int vector_tiered_insert(vector_tiered *t, const void *elem_ptr, size_t position);
+
+/**
+ * Function: vector_tiered_append
+ *
+ * Same as ``vector_tiered_insert`` on the last position.
+ *
+ * Complexity: O(1) amortized
+ *
+ */
+void vector_tiered_append(vector_tiered *t, const void *elem_ptr);
+
+/**
+ * Function: vector_tiered_delete
+ *
+ * Deletes the element on ``position``, calling ``vector_free_func`` on it,
+ * and moves the elements after it one place down.
+ *
+ * Returns
+ *
+ *   VECT_OK on success
+ *   VECT_DELETE_INVALID_POSITION if ``position`` is out of range
+ *
+ * Complexity: O(sqrt n)
+ *
+ */
+int vector_tiered_delete(vector_tiered *t, size_t position);
+
+/**
+ * Function: vector_tiered_map
+ *
+ * Calls ``map_func`` on each element, in order. See ``vector_map``.
+ *
+ * Complexity: O(n)
+ *
+ */
+void vector_tiered_map(vector_tiered *t, vector_map_func map_func, void *data);
+
+/**
+ * Function: vector_tiered_free
+ *
+ * Frees up all the memory of the tiered vector, calling
+ * ``vector_free_func`` on each element.
+ *
+ */
+void vector_tiered_free(vector_tiered *t);
+
+#endif
@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <check.h>
+#include "../src/bitset.h"
+
+START_TEST (bitset_set_clear_and_test_should_change_single_bits)
+{
+  bitset *b = bitset_new(130);
+  size_t i;
+
+  fail_unless(bitset_length(b) == 130);
+  for (i = 0; i < 130; i++)
+    fail_unless(bitset_test(b, i) == false);
+
+  bitset_set(b, 0);
+  bitset_set(b, 63);
+  bitset_set(b, 64);
+  bitset_set(b, 129);
+  bitset_clear(b, 63);
+
+  fail_unless(bitset_test(b, 0) && bitset_test(b, 64) && bitset_test(b, 129));
+  fail_unless(bitset_test(b, 63) == false);
+  fail_unless(bitset_count(b) == 3);
+
+  bitset_fill(b, true);
+  fail_unless(bitset_count(b) == 130, "bits past the length should stay clear");
+  bitset_fill(b, false);
+  fail_unless(bitset_count(b) == 0);
+
+  bitset_free(b);
+}
+END_TEST
+
+START_TEST (bitset_resize_should_clear_new_and_dropped_bits)
+{
+  bitset *b = bitset_new(0);
+  size_t i;
+
+  for (i = 0; i < 1000; i++) {
+    bitset_resize(b, i + 1);
+    bitset_set(b, i);
+  }
+  fail_unless(bitset_count(b) == 1000);
+
+  bitset_resize(b, 100);
+  fail_unless(bitset_count(b) == 100);
+  bitset_resize(b, 1000);
+  fail_unless(bitset_count(b) == 100, "growing again should not bring old bits back");
+  fail_unless(bitset_test(b, 100) == false);
+
+  bitset_free(b);
+}
+END_TEST
+
+START_TEST (bitset_bulk_operations_should_combine_words)
+{
+  bitset *a = bitset_new(200), *b = bitset_new(200), *short_set = bitset_new(70);
+  size_t i;
+
+  for (i = 0; i < 200; i++) {
+    if (i % 2 == 0) bitset_set(a, i);
+    if (i % 3 == 0) bitset_set(b, i);
+  }
+
+  bitset_and(a, b);
+  for (i = 0; i < 200; i++)
+    fail_unless(bitset_test(a, i) == (i % 6 == 0));
+
+  bitset_or(a, b);
+  for (i = 0; i < 200; i++)
+    fail_unless(bitset_test(a, i) == (i % 3 == 0));
+
+  bitset_xor(a, b);
+  fail_unless(bitset_count(a) == 0);
+
+  bitset_fill(a, true);
+  bitset_andnot(a, b);
+  for (i = 0; i < 200; i++)
+    fail_unless(bitset_test(a, i) == (i % 3 != 0));
+
+  /* shorter sources are extended with clear bits */
+  bitset_fill(short_set, true);
+  bitset_and(a, short_set);
+  fail_unless(bitset_next_set(a, 70) == BITSET_NONE);
+  bitset_or(short_set, b);
+  fail_unless(bitset_count(short_set) == 70);
+
+  bitset_free(a);
+  bitset_free(b);
+  bitset_free(short_set);
+}
+END_TEST
+
+START_TEST (bitset_next_set_should_iterate_set_bits)
+{
+  bitset *b = bitset_new(1000);
+  size_t i, expected[] = { 3, 64, 65, 500, 999 }, n = 0;
+
+  for (i = 0; i < 5; i++)
+    bitset_set(b, expected[i]);
+
+  for (i = bitset_next_set(b, 0); i != BITSET_NONE; i = bitset_next_set(b, i + 1))
+    fail_unless(i == expected[n++]);
+  fail_unless(n == 5);
+  fail_unless(bitset_next_set(b, 1000) == BITSET_NONE);
+
+  bitset_free(b);
+}
+END_TEST
+
+START_TEST (bitset_rank_and_select_should_be_inverse)
+{
+  bitset *b = bitset_new(5000);
+  size_t i, count = 0;
+
+  fail_unless(bitset_select(b, 0) == BITSET_NONE);
+
+  for (i = 0; i < 5000; i++) {
+    if (i % 7 == 0 || i % 13 == 0)
+      bitset_set(b, i);
+  }
+
+  for (i = 0; i <= 5000; i++) {
+    fail_unless(bitset_rank(b, i) == count);
+    if (i < 5000 && bitset_test(b, i)) {
+      fail_unless(bitset_select(b, count) == i);
+      count++;
+    }
+  }
+  fail_unless(bitset_select(b, count) == BITSET_NONE);
+
+  /* the index follows later changes */
+  bitset_clear(b, 0);
+  fail_unless(bitset_rank(b, 5000) == count - 1);
+  fail_unless(bitset_select(b, 0) == 7);
+
+  bitset_free(b);
+}
+END_TEST
+
+Suite *
+bitset_suite(void) {
+  Suite *s = suite_create("bitset");
+  TCase *tc_bitset = tcase_create("bitset");
+
+  tcase_add_test(tc_bitset, bitset_set_clear_and_test_should_change_single_bits);
+  tcase_add_test(tc_bitset, bitset_resize_should_clear_new_and_dropped_bits);
+  tcase_add_test(tc_bitset, bitset_bulk_operations_should_combine_words);
+  tcase_add_test(tc_bitset, bitset_next_set_should_iterate_set_bits);
+  tcase_add_test(tc_bitset, bitset_rank_and_select_should_be_inverse);
+
+  suite_add_tcase(s, tc_bitset);
+
+  return s;
+}
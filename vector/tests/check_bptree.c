@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <check.h>
+#include "../src/bptree.h"
+
+typedef struct {
+  long key;
+  long value;
+} record;
+
+static int compare_longs(const void *l1, const void *l2)
+{
+  if (*(long *)l1 > *(long *)l2) return  1;
+  if (*(long *)l1 < *(long *)l2) return -1;
+  return 0;
+}
+
+/* small nodes, so a few hundred keys already build several levels */
+#define SMALL_NODES 64
+
+START_TEST (bptree_new_should_fail_on_invalid_arguments)
+{
+  fail_unless(bptree_new(0, sizeof(long), compare_longs, 0) == NULL);
+  fail_unless(bptree_new(sizeof(long), sizeof(long), NULL, 0) == NULL);
+}
+END_TEST
+
+START_TEST (bptree_insert_and_find_should_keep_every_key)
+{
+  bptree *t = bptree_new(sizeof(long), sizeof(long), compare_longs, SMALL_NODES);
+  long i, key, value;
+
+  /* a permutation of 0..999 */
+  for (i = 0; i < 1000; i++) {
+    key = (i * 7919) % 1000;
+    value = key * 10;
+    fail_unless(bptree_insert(t, &key, &value) == true);
+  }
+  fail_unless(bptree_length(t) == 1000);
+
+  for (key = 0; key < 1000; key++)
+    fail_unless(*(long *)bptree_find(t, &key) == key * 10);
+
+  key = 1000;
+  fail_unless(bptree_find(t, &key) == NULL);
+
+  key = 5;
+  value = -1;
+  fail_unless(bptree_insert(t, &key, &value) == false, "existing key should be updated");
+  fail_unless(*(long *)bptree_find(t, &key) == -1);
+  fail_unless(bptree_length(t) == 1000);
+
+  bptree_free(t);
+}
+END_TEST
+
+START_TEST (bptree_iteration_should_follow_key_order)
+{
+  bptree *t = bptree_new(sizeof(long), sizeof(long), compare_longs, SMALL_NODES);
+  bptree_iter it;
+  long i, key, expected = 0;
+  bool more;
+
+  fail_unless(bptree_first(t, &it) == false);
+
+  for (i = 0; i < 500; i++) {
+    key = ((i * 331) % 500) * 2;
+    bptree_insert(t, &key, &i);
+  }
+
+  for (more = bptree_first(t, &it); more; more = bptree_next(&it)) {
+    fail_unless(*(long *)bptree_iter_key(&it) == expected);
+    expected += 2;
+  }
+  fail_unless(expected == 1000);
+
+  /* ranges start at the first key >= the one sought */
+  key = 301;
+  fail_unless(bptree_seek(t, &key, &it) == true);
+  fail_unless(*(long *)bptree_iter_key(&it) == 302);
+  key = 998;
+  fail_unless(bptree_seek(t, &key, &it) == true);
+  fail_unless(bptree_next(&it) == false);
+  key = 999;
+  fail_unless(bptree_seek(t, &key, &it) == false);
+
+  bptree_free(t);
+}
+END_TEST
+
+START_TEST (bptree_remove_should_skip_emptied_leaves)
+{
+  bptree *t = bptree_new(sizeof(long), 0, compare_longs, SMALL_NODES);
+  bptree_iter it;
+  long key;
+
+  for (key = 0; key < 300; key++)
+    bptree_insert(t, &key, NULL);
+
+  for (key = 0; key < 300; key++) {
+    if (key < 100 || key % 50 != 0)
+      fail_unless(bptree_remove(t, &key) == true);
+  }
+  fail_unless(bptree_remove(t, &key) == false);
+  fail_unless(bptree_length(t) == 4);
+
+  key = 0;
+  fail_unless(bptree_find(t, &key) == NULL);
+
+  fail_unless(bptree_first(t, &it) == true);
+  fail_unless(*(long *)bptree_iter_key(&it) == 100);
+  key = 101;
+  fail_unless(bptree_seek(t, &key, &it) == true);
+  fail_unless(*(long *)bptree_iter_key(&it) == 150);
+  fail_unless(bptree_next(&it) == true);
+  fail_unless(bptree_next(&it) == true);
+  fail_unless(*(long *)bptree_iter_key(&it) == 250);
+  fail_unless(bptree_next(&it) == false);
+
+  bptree_free(t);
+}
+END_TEST
+
+START_TEST (bptree_should_round_trip_through_sorted_vector)
+{
+  vector *v = vector_new(sizeof(record), NULL, 16);
+  vector *out;
+  bptree *t;
+  record r, *rp;
+  long i, key, value;
+
+  t = bptree_from_vector(v, sizeof(long), compare_longs, SMALL_NODES);
+  fail_unless(bptree_length(t) == 0);
+  bptree_free(t);
+
+  for (i = 0; i < 1000; i++) {
+    r.key = i * 3;
+    r.value = -i;
+    vector_append(v, &r);
+  }
+  fail_unless(bptree_from_vector(v, sizeof(record) + 1, compare_longs, 0) == NULL);
+
+  t = bptree_from_vector(v, sizeof(long), compare_longs, SMALL_NODES);
+  fail_unless(bptree_length(t) == 1000);
+  for (i = 0; i < 1000; i++) {
+    key = i * 3;
+    fail_unless(*(long *)bptree_find(t, &key) == -i);
+  }
+
+  /* the bulk loaded tree keeps working as a regular one */
+  for (i = 0; i < 1000; i++) {
+    key = i * 3 + 1;
+    value = i;
+    bptree_insert(t, &key, &value);
+  }
+  key = 2998;
+  fail_unless(*(long *)bptree_find(t, &key) == 999);
+
+  out = bptree_to_vector(t);
+  fail_unless(vector_length(out) == 2000);
+  for (i = 0; i < 2000; i++) {
+    rp = vector_get(out, i);
+    fail_unless(rp->key == (i / 2) * 3 + i % 2);
+    fail_unless(rp->value == (i % 2 ? i / 2 : -(i / 2)));
+  }
+
+  /* the exported vector grows like any other */
+  r.key = 6000;
+  vector_append(out, &r);
+  fail_unless(out->alloc_length == 4000);
+
+  vector_free(out);
+  vector_free(v);
+  bptree_free(t);
+}
+END_TEST
+
+START_TEST (bptree_set_should_round_trip_through_sorted_vector)
+{
+  bptree *t = bptree_new(sizeof(long), 0, compare_longs, SMALL_NODES);
+  vector *keys;
+  long i, key;
+
+  for (i = 0; i < 500; i++) {
+    key = i * 2;
+    bptree_insert(t, &key, NULL);
+  }
+  for (i = 0; i < 500; i += 2) {
+    key = i * 2;
+    bptree_remove(t, &key);
+  }
+
+  /* rebuilding is how a set that shrank gets compacted */
+  keys = bptree_to_vector(t);
+  fail_unless(keys->elem_size == sizeof(long));
+  fail_unless(vector_length(keys) == 250);
+  bptree_free(t);
+
+  t = bptree_from_vector(keys, sizeof(long), compare_longs, SMALL_NODES);
+  fail_unless(t != NULL);
+  fail_unless(bptree_length(t) == 250);
+  for (i = 0; i < 500; i++) {
+    key = i * 2;
+    fail_unless((bptree_find(t, &key) != NULL) == (i % 2 == 1));
+  }
+
+  vector_free(keys);
+  bptree_free(t);
+}
+END_TEST
+
+Suite *
+bptree_suite(void) {
+  Suite *s = suite_create("bptree");
+  TCase *tc_bptree = tcase_create("bptree");
+
+  tcase_add_test(tc_bptree, bptree_new_should_fail_on_invalid_arguments);
+  tcase_add_test(tc_bptree, bptree_insert_and_find_should_keep_every_key);
+  tcase_add_test(tc_bptree, bptree_iteration_should_follow_key_order);
+  tcase_add_test(tc_bptree, bptree_remove_should_skip_emptied_leaves);
+  tcase_add_test(tc_bptree, bptree_should_round_trip_through_sorted_vector);
+  tcase_add_test(tc_bptree, bptree_set_should_round_trip_through_sorted_vector);
+
+  suite_add_tcase(s, tc_bptree);
+
+  return s;
+}
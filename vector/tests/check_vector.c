@@ -1,6 +1,10 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <ctype.h>
 #include <check.h>
 #include "../src/vector.h"
@@ -444,6 +448,114 @@ START_TEST (sort_does_nothing_if_compare_function_is_null)
 }
 END_TEST
 
+typedef struct {
+  int key;
+  int seq;
+} keyed;
+
+int compare_keys(const void *k1, const void *k2)
+{
+  return compare_ints(&((keyed *)k1)->key, &((keyed *)k2)->key);
+}
+
+START_TEST (stable_sort_should_keep_order_of_equal_elements)
+{
+  int i;
+  keyed k, *prev, *cur;
+
+  vector *v = vector_new(sizeof(keyed), NULL, 16);
+  for (i = 0; i < 1000; i++) {
+    k.key = (i * 7919) % 13;
+    k.seq = i;
+    vector_append(v, &k);
+  }
+
+  vector_stable_sort(v, compare_keys);
+
+  for (i = 1; i < 1000; i++) {
+    prev = vector_get(v, i - 1);
+    cur = vector_get(v, i);
+    fail_unless(prev->key <= cur->key, "not sorted at %d", i);
+    if (prev->key == cur->key)
+      fail_unless(prev->seq < cur->seq, "equal keys reordered at %d", i);
+  }
+
+  /* scratch buffer is reused by the next sort */
+  void *buffer = v->sort_buffer;
+  vector_stable_sort(v, compare_keys);
+  fail_unless(buffer == v->sort_buffer);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (partial_sort_should_sort_only_the_k_smallest)
+{
+  int i, num;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 500; i++) {
+    num = (i * 7919) % 500;
+    vector_append(v, &num);
+  }
+
+  fail_unless(vector_partial_sort(v, 10, compare_ints) == VECT_OK);
+
+  for (i = 0; i < 10; i++)
+    fail_unless(*(int *)vector_get(v, i) == i, "position %d should be %d", i, i);
+  for (i = 10; i < 500; i++)
+    fail_unless(*(int *)vector_get(v, i) >= 10);
+
+  fail_unless(vector_partial_sort(v, -1, compare_ints) == VECT_SORT_INVALID_POSITION);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (partial_sort_bigger_than_length_should_sort_everything)
+{
+  int num1 = 3, num2 = 1, num3 = 2;
+
+  vector *v = vector_new(sizeof(int), NULL, 5);
+  vector_append(v, &num1);
+  vector_append(v, &num2);
+  vector_append(v, &num3);
+
+  fail_unless(vector_partial_sort(v, 10, compare_ints) == VECT_OK);
+  fail_unless(*(int *)vector_get(v, 0) == 1);
+  fail_unless(*(int *)vector_get(v, 1) == 2);
+  fail_unless(*(int *)vector_get(v, 2) == 3);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (nth_element_should_partition_around_position)
+{
+  int i, num, nth;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 1000; i++) {
+    num = (i * 31) % 100;  /* lots of duplicates */
+    vector_append(v, &num);
+  }
+
+  fail_unless(vector_nth_element(v, 500, compare_ints) == VECT_OK);
+  nth = *(int *)vector_get(v, 500);
+  fail_unless(nth == 50, "500th element should be 50, not %d", nth);
+
+  for (i = 0; i < 500; i++)
+    fail_unless(*(int *)vector_get(v, i) <= nth);
+  for (i = 501; i < 1000; i++)
+    fail_unless(*(int *)vector_get(v, i) >= nth);
+
+  fail_unless(vector_nth_element(v, 1000, compare_ints) == VECT_SORT_INVALID_POSITION);
+  fail_unless(vector_nth_element(v, -1, compare_ints) == VECT_SORT_INVALID_POSITION);
+
+  vector_free(v);
+}
+END_TEST
+
 START_TEST (map_should_call_functionl_for_each_element)
 {
 
@@ -577,6 +689,794 @@ START_TEST (delete_element_should_fail_if_invalid_position)
 }
 END_TEST
 
+START_TEST (swap_remove_should_move_last_element_into_the_gap)
+{
+  char *sport1 = strdup("winsurf");
+  char *sport2 = strdup("kitesurf");
+  char *sport3 = strdup("motocross");
+
+  vector *v = vector_new(sizeof(char *), free_string, 5);
+  vector_append(v, &sport1);
+  vector_append(v, &sport2);
+  vector_append(v, &sport3);
+
+  fail_unless(vector_swap_remove(v, 0) == VECT_OK);
+  fail_unless(vector_length(v) == 2);
+  fail_unless(sport3 == *(char **)vector_get(v, 0));
+  fail_unless(sport2 == *(char **)vector_get(v, 1));
+
+  fail_unless(vector_swap_remove(v, 1) == VECT_OK);
+  fail_unless(vector_length(v) == 1);
+  fail_unless(sport3 == *(char **)vector_get(v, 0));
+
+  fail_unless(vector_swap_remove(v, 1) == VECT_DELETE_INVALID_POSITION);
+  fail_unless(vector_swap_remove(v, -1) == VECT_DELETE_INVALID_POSITION);
+
+  vector_free(v);
+}
+END_TEST
+
+bool is_multiple(const void *num, void *factor)
+{
+  return *(int *)num % *(int *)factor == 0;
+}
+
+bool starts_with(const void *string, void *prefix)
+{
+  return strncmp(*(char **)string, prefix, strlen(prefix)) == 0;
+}
+
+START_TEST (remove_if_should_compact_keeping_order)
+{
+  int i, factor = 3;
+
+  vector *v = vector_new(sizeof(int), NULL, 8);
+  for (i = 0; i < 20; i++)
+    vector_append(v, &i);
+
+  fail_unless(vector_remove_if(v, is_multiple, &factor) == 7);
+  fail_unless(vector_length(v) == 13);
+  for (i = 0; i < 13; i++)
+    fail_unless(*(int *)vector_get(v, i) == i + i / 2 + 1,
+                "unexpected element at %d: %d", i, *(int *)vector_get(v, i));
+
+  fail_unless(vector_remove_if(v, NULL, NULL) == 0);
+  fail_unless(vector_length(v) == 13);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (retain_should_call_free_function_on_removed_elements)
+{
+  char *sport1 = strdup("kitesurf");
+  char *sport2 = strdup("motocross");
+  char *sport3 = strdup("kayak");
+
+  vector *v = vector_new(sizeof(char *), free_string, 5);
+  vector_append(v, &sport1);
+  vector_append(v, &sport2);
+  vector_append(v, &sport3);
+
+  fail_unless(vector_retain(v, starts_with, "k") == 1);
+  fail_unless(vector_length(v) == 2);
+  fail_unless(sport1 == *(char **)vector_get(v, 0));
+  fail_unless(sport3 == *(char **)vector_get(v, 1));
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (dedup_should_leave_unique_elements_of_sorted_vector)
+{
+  int nums[] = { 1, 1, 2, 3, 3, 3, 4, 5, 5 };
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 4);
+  for (i = 0; i < 9; i++)
+    vector_append(v, &nums[i]);
+
+  fail_unless(vector_dedup(v, compare_ints) == 4);
+  fail_unless(vector_length(v) == 5);
+  for (i = 0; i < 5; i++)
+    fail_unless(*(int *)vector_get(v, i) == i + 1);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (shrink_threshold_should_halve_allocated_length)
+{
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 4);
+  for (i = 0; i < 64; i++)
+    vector_append(v, &i);
+  fail_unless(v->alloc_length == 64);
+
+  vector_set_shrink_threshold(v, 0.25);
+  for (i = 0; i < 48; i++)
+    vector_swap_remove(v, 0);
+  fail_unless(v->alloc_length == 64, "length 16 is not below a quarter of 64");
+
+  vector_delete(v, 0);
+  fail_unless(v->alloc_length == 32, ".alloc_length should be 32 not %d", (int)v->alloc_length);
+
+  for (i = 0; i < 15; i++)
+    vector_delete(v, 0);
+  fail_unless(v->alloc_length == 4, "should not shrink below initial");
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (shrink_to_fit_should_match_logical_length)
+{
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 10);
+  for (i = 0; i < 3; i++)
+    vector_append(v, &i);
+
+  vector_shrink_to_fit(v);
+  fail_unless(v->alloc_length == 3);
+  fail_unless(*(int *)vector_get(v, 2) == 2);
+
+  vector_append(v, &i);
+  fail_unless(*(int *)vector_get(v, 3) == 3);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (shrink_to_fit_and_clear_should_free_sort_buffer)
+{
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 8);
+  for (i = 8; i > 0; i--)
+    vector_append(v, &i);
+
+  vector_stable_sort(v, compare_ints);
+  fail_unless(v->sort_buffer != NULL);
+  vector_shrink_to_fit(v);
+  fail_unless(v->sort_buffer == NULL && v->sort_buffer_length == 0);
+  fail_unless(*(int *)vector_get(v, 0) == 1);
+
+  vector_stable_sort(v, compare_ints);
+  vector_clear(v, true);
+  fail_unless(v->sort_buffer != NULL, "keep_capacity should keep the scratch buffer");
+  vector_clear(v, false);
+  fail_unless(v->sort_buffer == NULL && v->sort_buffer_length == 0);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (clear_should_free_elements_and_optionally_keep_capacity)
+{
+  char *sport1 = strdup("winsurf");
+  char *sport2 = strdup("kitesurf");
+  char *sport3 = strdup("motocross");
+
+  vector *v = vector_new(sizeof(char *), free_string, 2);
+  vector_append(v, &sport1);
+  vector_append(v, &sport2);
+  vector_append(v, &sport3);
+
+  vector_clear(v, true);
+  fail_unless(vector_length(v) == 0);
+  fail_unless(v->alloc_length == 4);
+
+  sport1 = strdup("surf");
+  vector_append(v, &sport1);
+  vector_clear(v, false);
+  fail_unless(vector_length(v) == 0);
+  fail_unless(v->alloc_length == 2);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (clear_should_not_release_borrowed_memory)
+{
+  size_t i, count = 4 << 20;
+  int *ids = malloc(count * sizeof(int));
+  vector view;
+
+  for (i = 0; i < count; i++)
+    ids[i] = 7;
+
+  vector *v = vector_from_buffer(ids, sizeof(int), count, count, NULL, false);
+  vector_clear(v, true);
+  vector_free(v);
+  fail_unless(ids[0] == 7 && ids[count / 2] == 7 && ids[count - 1] == 7,
+              "the client's buffer should keep its data");
+
+  v = vector_from_buffer(ids, sizeof(int), count, count, NULL, true);
+  ids[count - 1] = 9;
+  fail_unless(vector_view(v, 0, count, &view) == VECT_OK);
+  vector_clear(&view, true);
+  fail_unless(vector_length(v) == count);
+  fail_unless(*(int *)vector_get(v, count / 2) == 7);
+  fail_unless(*(int *)vector_get(v, count - 1) == 9, "the parent should keep its data");
+
+  vector_free(v);
+}
+END_TEST
+
+void sum_ints(void *num, void *total)
+{
+  *(int *)total += *(int *)num;
+}
+
+START_TEST (lazy_delete_should_mark_slots_until_compaction)
+{
+  int i, sum = 0, key;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 10; i++)
+    vector_append(v, &i);
+
+  vector_set_lazy_delete(v, 1);
+  fail_unless(vector_delete(v, 3) == VECT_OK);
+  fail_unless(vector_delete(v, 4) == VECT_OK);
+  fail_unless(vector_delete(v, 3) == VECT_DELETE_INVALID_POSITION);
+
+  fail_unless(vector_length(v) == 10, "slots are kept until compaction");
+  fail_unless(vector_get(v, 3) == NULL);
+  fail_unless(*(int *)vector_get(v, 5) == 5, "later positions should not shift");
+
+  vector_map(v, sum_ints, &sum);
+  fail_unless(sum == 45 - 3 - 4);
+
+  key = 4;
+  fail_unless(vector_search(v, &key, compare_ints, 0, false) == VECT_SEARCH_NOT_FOUND);
+  fail_unless(vector_search(v, &key, compare_ints, 0, true) == VECT_SEARCH_NOT_FOUND);
+  for (key = 5; key < 10; key++)
+    fail_unless(vector_search(v, &key, compare_ints, 0, true) == key);
+
+  key = 40;
+  fail_unless(vector_replace(v, 3, &key) == VECT_OK, "replace should revive the slot");
+  fail_unless(*(int *)vector_get(v, 3) == 40);
+
+  fail_unless(vector_compact(v) == 1);
+  fail_unless(vector_length(v) == 9);
+  fail_unless(*(int *)vector_get(v, 4) == 5);
+  fail_unless(vector_compact(v) == 0);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (lazy_delete_should_compact_past_threshold)
+{
+  int i;
+  char *str;
+
+  vector *v = vector_new(sizeof(char *), free_string, 4);
+  for (i = 0; i < 8; i++) {
+    str = strdup("item");
+    vector_append(v, &str);
+  }
+
+  vector_set_lazy_delete(v, 0.5);
+  for (i = 0; i < 3; i++)
+    vector_delete(v, i * 2);
+  fail_unless(vector_length(v) == 8);
+
+  vector_delete(v, 7);
+  fail_unless(vector_length(v) == 4, "4 of 8 slots deleted should compact");
+  for (i = 0; i < 4; i++)
+    fail_unless(strcmp(*(char **)vector_get(v, i), "item") == 0);
+
+  /* moving elements around compacts first, deleted slots can't be moved */
+  vector_delete(v, 0);
+  fail_unless(vector_swap_remove(v, 0) == VECT_DELETE_INVALID_POSITION);
+  vector_swap_remove(v, 1);
+  fail_unless(vector_length(v) == 2);
+
+  vector_delete(v, 1);
+  vector_set_lazy_delete(v, 0);
+  fail_unless(vector_length(v) == 1, "turning lazy deletion off should compact");
+
+  vector_free(v);
+}
+END_TEST
+
+static void
+assert_ints(vector *v, const int *expected, int n)
+{
+  int i;
+
+  fail_unless(vector_length(v) == (size_t)n, "length should be %d not %d", n,
+              (int)vector_length(v));
+  for (i = 0; i < n; i++)
+    fail_unless(*(int *)vector_get(v, i) == expected[i], "position %d should be %d not %d",
+                i, expected[i], *(int *)vector_get(v, i));
+}
+
+START_TEST (lazy_delete_positions_should_survive_compaction)
+{
+  int i, num = 100;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 10; i++)
+    vector_append(v, &i);
+  vector_set_lazy_delete(v, 0.9);
+
+  /* slot 3 holds 3, which the new element should precede */
+  vector_delete(v, 1);
+  fail_unless(vector_insert(v, &num, 1) == VECT_INSERT_INVALID_POSITION);
+  fail_unless(vector_insert(v, &num, 3) == VECT_OK);
+  assert_ints(v, (int[]){ 0, 2, 100, 3, 4, 5, 6, 7, 8, 9 }, 10);
+
+  vector_delete(v, 5);
+  fail_unless(vector_swap_remove(v, 5) == VECT_DELETE_INVALID_POSITION);
+  fail_unless(vector_swap_remove(v, 8) == VECT_OK);
+  assert_ints(v, (int[]){ 0, 2, 100, 3, 4, 6, 7, 9 }, 8);
+
+  /* the nth smallest of what's live, at the slot given */
+  vector_delete(v, 0);
+  vector_delete(v, 2);
+  fail_unless(vector_nth_element(v, 0, compare_ints) == VECT_SORT_INVALID_POSITION);
+  fail_unless(vector_nth_element(v, 3, compare_ints) == VECT_OK);
+  fail_unless(vector_length(v) == 6);
+  fail_unless(*(int *)vector_get(v, 1) == 3);
+
+  /* the first 3 slots, one of them deleted, are the 2 smallest */
+  vector_delete(v, 1);
+  vector_partial_sort(v, 3, compare_ints);
+  fail_unless(vector_length(v) == 5);
+  fail_unless(*(int *)vector_get(v, 0) == 2 && *(int *)vector_get(v, 1) == 4);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (next_span_should_skip_deleted_slots)
+{
+  size_t pos = 0, count;
+  const int *span;
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  fail_unless(vector_next_span(v, &pos, &count) == NULL);
+  for (i = 0; i < 10; i++)
+    vector_append(v, &i);
+
+  span = vector_next_span(v, &pos, &count);
+  fail_unless(span != NULL && span[0] == 0 && count == 10 && pos == 10);
+  fail_unless(vector_next_span(v, &pos, &count) == NULL);
+
+  vector_set_lazy_delete(v, 1);
+  vector_delete(v, 0);
+  vector_delete(v, 4);
+  vector_delete(v, 5);
+  vector_delete(v, 9);
+
+  pos = 0;
+  span = vector_next_span(v, &pos, &count);
+  fail_unless(span[0] == 1 && count == 3);
+  span = vector_next_span(v, &pos, &count);
+  fail_unless(span[0] == 6 && count == 3 && pos == 9);
+  fail_unless(vector_next_span(v, &pos, &count) == NULL);
+
+  vector_free(v);
+}
+END_TEST
+
+typedef struct {
+  int sum;
+  int calls;
+  size_t max_count;
+} chunk_totals;
+
+void sum_int_chunks(void *base, size_t count, void *aux)
+{
+  chunk_totals *totals = aux;
+  int *nums = base;
+  size_t i;
+
+  for (i = 0; i < count; i++)
+    totals->sum += nums[i];
+  totals->calls++;
+  if (count > totals->max_count) totals->max_count = count;
+}
+
+START_TEST (map_range_should_only_visit_the_range)
+{
+  int i, sum = 0;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 10; i++)
+    vector_append(v, &i);
+
+  fail_unless(vector_map_range(v, 2, 5, sum_ints, &sum) == VECT_OK);
+  fail_unless(sum == 2 + 3 + 4);
+
+  fail_unless(vector_map_range(v, 5, 5, sum_ints, &sum) == VECT_OK);
+  fail_unless(sum == 9, "an empty range should not call the function");
+
+  fail_unless(vector_map_range(v, -1, 5, sum_ints, &sum) == VECT_MAP_INVALID_RANGE);
+  fail_unless(vector_map_range(v, 5, 4, sum_ints, &sum) == VECT_MAP_INVALID_RANGE);
+  fail_unless(vector_map_range(v, 0, 11, sum_ints, &sum) == VECT_MAP_INVALID_RANGE);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (map_chunks_should_hand_over_contiguous_spans)
+{
+  chunk_totals totals = { 0, 0, 0 };
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 1000; i++)
+    vector_append(v, &i);
+
+  vector_map_chunks(v, sum_int_chunks, 64, &totals);
+  fail_unless(totals.sum == 999 * 1000 / 2);
+  fail_unless(totals.calls == 16 && totals.max_count == 64);
+
+  memset(&totals, 0, sizeof(totals));
+  vector_map_chunks(v, sum_int_chunks, 0, &totals);
+  fail_unless(totals.calls == 1 && totals.max_count == 1000);
+
+  memset(&totals, 0, sizeof(totals));
+  fail_unless(vector_map_chunks_range(v, 100, 300, sum_int_chunks, 150, &totals) == VECT_OK);
+  fail_unless(totals.sum == (299 * 300 - 99 * 100) / 2);
+  fail_unless(totals.calls == 2);
+  fail_unless(vector_map_chunks_range(v, 0, 1001, sum_int_chunks, 150, &totals) ==
+              VECT_MAP_INVALID_RANGE);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (map_chunks_should_skip_lazily_deleted_elements)
+{
+  chunk_totals totals = { 0, 0, 0 };
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 10; i++)
+    vector_append(v, &i);
+
+  vector_set_lazy_delete(v, 1);
+  vector_delete(v, 0);
+  vector_delete(v, 4);
+  vector_delete(v, 5);
+
+  vector_map_chunks(v, sum_int_chunks, 0, &totals);
+  fail_unless(totals.sum == 45 - 4 - 5);
+  fail_unless(totals.calls == 2, "spans should end at deleted elements");
+  fail_unless(totals.max_count == 4);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (aligned_vector_should_keep_buffer_aligned_when_growing)
+{
+  char c = 'x';
+  int i;
+
+  vector *v = vector_new_flags(sizeof(char), NULL, 3, VECT_ALIGNED);
+  for (i = 0; i < 1000; i++) {
+    vector_append(v, &c);
+    fail_unless((uintptr_t)v->elems % 64 == 0, "buffer not aligned after %d appends", i);
+  }
+  fail_unless(*(char *)vector_get(v, 999) == 'x');
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (huge_pages_vector_should_map_big_buffers)
+{
+  size_t elem_size = 1 << 20;
+  char *elem = malloc(elem_size);
+  int i;
+
+  vector *v = vector_new_flags(elem_size, NULL, 2, VECT_HUGE_PAGES);
+  fail_unless(v->mapped_length == 0, "small buffer should stay on the heap");
+
+  for (i = 0; i < 40; i++) {
+    memset(elem, 'a' + i % 26, elem_size);
+    vector_append(v, elem);
+  }
+  fail_unless(v->mapped_length >= 40 * elem_size, "big buffer should be mapped");
+  fail_unless((uintptr_t)v->elems % 4096 == 0);
+
+  for (i = 0; i < 40; i++) {
+    char *found = vector_get(v, i);
+    fail_unless(found[0] == 'a' + i % 26 && found[elem_size - 1] == 'a' + i % 26,
+                "element %d lost when moving the buffer", i);
+  }
+
+  vector_free(v);
+  free(elem);
+}
+END_TEST
+
+START_TEST (append_uninit_should_reserve_slots_to_fill_in_place)
+{
+  int i, *slots;
+  int num = 7;
+
+  vector *v = vector_new_flags(sizeof(int), NULL, 2, VECT_NO_ZERO);
+  vector_append(v, &num);
+
+  slots = vector_append_uninit(v, 10);
+  for (i = 0; i < 10; i++)
+    slots[i] = i * 2;
+
+  fail_unless(vector_length(v) == 11);
+  fail_unless(v->alloc_length >= 11);
+  fail_unless(*(int *)vector_get(v, 0) == 7);
+  for (i = 0; i < 10; i++)
+    fail_unless(*(int *)vector_get(v, i + 1) == i * 2);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (bulk_appends_should_not_overshoot_the_request)
+{
+  vector *v = vector_new(sizeof(int), NULL, 1000);
+
+  vector_append_uninit(v, 1000001);
+  fail_unless(v->alloc_length == 1000001, ".alloc_length should be 1000001 not %lu",
+              (unsigned long)v->alloc_length);
+  vector_free(v);
+
+  v = vector_new(sizeof(int), NULL, 4);
+  vector_reserve(v, 10);
+  fail_unless(v->alloc_length == 16, "a small request grows by the usual step");
+  vector_reserve(v, 100);
+  fail_unless(v->alloc_length == 100);
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (truncate_should_give_back_unwritten_slots)
+{
+  int i, *slots;
+  char *sport;
+
+  vector *v = vector_new(sizeof(int), NULL, 4);
+  slots = vector_append_uninit(v, 8);
+  for (i = 0; i < 5; i++)   /* a short read */
+    slots[i] = i;
+  vector_truncate(v, vector_length(v) - 8 + 5);
+  fail_unless(vector_length(v) == 5);
+  fail_unless(v->alloc_length == 16, "capacity should be kept");
+
+  vector_truncate(v, 10);
+  fail_unless(vector_length(v) == 5);
+  vector_free(v);
+
+  /* freed elements and lazily deleted ones */
+  v = vector_new(sizeof(char *), free_string, 4);
+  for (i = 0; i < 4; i++) {
+    sport = strdup("surf");
+    vector_append(v, &sport);
+  }
+  vector_set_lazy_delete(v, 1);
+  vector_delete(v, 2);
+  vector_truncate(v, 1);
+  fail_unless(vector_length(v) == 1);
+  fail_unless(strcmp(*(char **)vector_get(v, 0), "surf") == 0);
+  sport = strdup("kite");
+  vector_append(v, &sport);
+  fail_unless(vector_get(v, 1) != NULL, "slot 2 was deleted, 1 should be live");
+  sport = strdup("kite");
+  vector_append(v, &sport);
+  fail_unless(vector_get(v, 2) != NULL, "the truncated deletion should be gone");
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (from_buffer_should_adopt_buffer_without_copying)
+{
+  int i, *ids = malloc(4 * sizeof(int));
+  for (i = 0; i < 3; i++)
+    ids[i] = i + 1;
+
+  vector *v = vector_from_buffer(ids, sizeof(int), 3, 4, NULL, true);
+  fail_unless(v->elems == ids);
+  fail_unless(vector_length(v) == 3);
+  fail_unless(*(int *)vector_get(v, 2) == 3);
+
+  vector_append(v, &i);
+  vector_append(v, &i);   /* grow, may move the buffer */
+  fail_unless(vector_length(v) == 5);
+  fail_unless(*(int *)vector_get(v, 0) == 1);
+
+  fail_unless(vector_from_buffer(ids, sizeof(int), 5, 4, NULL, true) == NULL);
+
+  vector_free(v);
+
+  /* the buffer size is not the growth step */
+  ids = malloc(200000 * sizeof(int));
+  v = vector_from_buffer(ids, sizeof(int), 200000, 200000, NULL, true);
+  vector_append(v, &i);
+  fail_unless(v->alloc_length == 400000, ".alloc_length should be 400000 not %d",
+              (int)v->alloc_length);
+  fail_unless(*(int *)vector_get(v, 200000) == i);
+  vector_clear(v, false);
+  fail_unless(v->alloc_length == VECTOR_GROWTH_STEP);
+
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (from_borrowed_buffer_should_copy_on_grow)
+{
+  int ids[2] = { 10, 20 }, num = 30;
+
+  vector *v = vector_from_buffer(ids, sizeof(int), 2, 2, NULL, false);
+  fail_unless(v->elems == ids);
+
+  vector_append(v, &num);
+  fail_if(v->elems == ids, "borrowed buffer should not be reallocated");
+  fail_unless(*(int *)vector_get(v, 0) == 10);
+  fail_unless(*(int *)vector_get(v, 2) == 30);
+
+  vector_free(v);  /* must not free ids */
+}
+END_TEST
+
+START_TEST (detach_should_hand_over_buffer)
+{
+  int i, *elems;
+  size_t length;
+
+  vector *v = vector_new(sizeof(int), NULL, 4);
+  for (i = 0; i < 3; i++)
+    vector_append(v, &i);
+  void *buffer = v->elems;
+
+  elems = vector_detach(v, &length);
+  fail_unless(elems == buffer, "heap buffer should not be copied");
+  fail_unless(length == 3);
+  fail_unless(elems[0] == 0 && elems[2] == 2);
+
+  free(elems);
+}
+END_TEST
+
+START_TEST (clone_should_share_buffer_until_modified)
+{
+  int i, num = 100;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 10; i++)
+    vector_append(v, &i);
+
+  vector *clone = vector_clone(v);
+  fail_unless(clone->elems == v->elems, "the clone should share the buffer");
+  fail_unless(vector_length(clone) == 10);
+  fail_unless(*(int *)vector_get(clone, 9) == 9);
+
+  vector_append(clone, &num);
+  fail_if(clone->elems == v->elems, "appending should copy the buffer");
+  fail_unless(vector_length(clone) == 11 && vector_length(v) == 10);
+
+  vector *other = vector_clone(v);
+  vector_replace(v, 0, &num);
+  fail_unless(*(int *)vector_get(v, 0) == 100);
+  fail_unless(*(int *)vector_get(other, 0) == 0, "the clone should keep the old value");
+
+  vector *last = vector_clone(other);
+  vector_free(other);
+  void *buffer = last->elems;
+  vector_delete(last, 0);
+  fail_unless(last->elems == buffer, "the last owner should write in place");
+  fail_unless(*(int *)vector_get(last, 0) == 1);
+
+  vector_free(v);
+  vector_free(clone);
+  vector_free(last);
+}
+END_TEST
+
+void double_int(void *num, void *data)
+{
+  (void)data;
+  *(int *)num *= 2;
+}
+
+void double_int_chunk(void *base, size_t count, void *data)
+{
+  size_t i;
+  for (i = 0; i < count; i++)
+    double_int((int *)base + i, data);
+}
+
+START_TEST (map_should_not_write_to_shared_buffer)
+{
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 8);
+  for (i = 0; i < 8; i++)
+    vector_append(v, &i);
+
+  vector *clone = vector_clone(v);
+  vector_map(clone, double_int, NULL);
+  fail_unless(*(int *)vector_get(clone, 3) == 6);
+  fail_unless(*(int *)vector_get(v, 3) == 3, "the original should not change");
+
+  vector *other = vector_clone(v);
+  vector_map_chunks_range(other, 2, 6, double_int_chunk, 2, NULL);
+  fail_unless(*(int *)vector_get(other, 5) == 10);
+  fail_unless(*(int *)vector_get(v, 5) == 5, "the original should not change");
+  fail_unless(*(int *)vector_get(clone, 5) == 10);
+
+  vector_free(v);
+  vector_free(clone);
+  vector_free(other);
+}
+END_TEST
+
+START_TEST (clone_should_keep_lazy_deletions_and_copy_borrowed_buffers)
+{
+  int ids[4] = { 10, 20, 30, 40 }, num = 50;
+
+  vector *v = vector_from_buffer(ids, sizeof(int), 4, 4, NULL, false);
+  vector *clone = vector_clone(v);
+  fail_if(clone->elems == ids, "a borrowed buffer should be copied");
+
+  vector_set_lazy_delete(v, 1);
+  vector_delete(v, 1);
+  vector_free(clone);
+
+  clone = vector_clone(v);
+  fail_unless(vector_get(clone, 1) == NULL);
+  vector_insert(clone, &num, 0);
+  fail_unless(vector_length(clone) == 4);
+  fail_unless(*(int *)vector_get(clone, 0) == 50 && *(int *)vector_get(clone, 2) == 30);
+  fail_unless(ids[1] == 20, "the original should not change");
+
+  vector_free(v);
+  vector_free(clone);
+
+  v = vector_new(sizeof(char *), free_string, 4);
+  fail_unless(vector_clone(v) == NULL);
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (view_should_expose_subrange_to_search_and_map)
+{
+  int i, total = 0, key = 6;
+  vector view;
+
+  vector *v = vector_new(sizeof(int), NULL, 10);
+  for (i = 0; i < 10; i++)
+    vector_append(v, &i);
+
+  fail_unless(vector_view(v, 4, 8, &view) == VECT_OK);
+  fail_unless(vector_length(&view) == 4);
+  fail_unless(*(int *)vector_get(&view, 0) == 4);
+  fail_unless(vector_get(&view, 4) == NULL);
+
+  fail_unless(vector_search(&view, &key, compare_ints, 0, false) == 2);
+  key = 9;
+  fail_unless(vector_search(&view, &key, compare_ints, 0, false) == VECT_SEARCH_NOT_FOUND);
+
+  vector_map(&view, sum_ints, &total);
+  fail_unless(total == 4 + 5 + 6 + 7);
+
+  fail_unless(vector_view(v, 4, 11, &view) == VECT_VIEW_INVALID_RANGE);
+  fail_unless(vector_view(v, 5, 4, &view) == VECT_VIEW_INVALID_RANGE);
+  fail_unless(vector_view(v, -1, 4, &view) == VECT_VIEW_INVALID_RANGE);
+
+  vector_free(v);
+}
+END_TEST
+
 Suite *
 vector_suite(void) {
   Suite *s = suite_create("vector");
@@ -588,6 +1488,9 @@ vector_suite(void) {
   tcase_add_test(tc_vector, should_append_and_get_one_element);
   tcase_add_test(tc_vector, should_append_and_get_multiple_elements);
   tcase_add_test(tc_vector, append_should_grown_if_needed);
+  tcase_add_test(tc_vector, append_uninit_should_reserve_slots_to_fill_in_place);
+  tcase_add_test(tc_vector, bulk_appends_should_not_overshoot_the_request);
+  tcase_add_test(tc_vector, truncate_should_give_back_unwritten_slots);
   tcase_add_test(tc_vector, get_should_fail_if_invalid_index);
   tcase_add_test(tc_vector, should_use_free_function_to_dealloc_elemns);
 
@@ -608,6 +1511,10 @@ vector_suite(void) {
 
   tcase_add_test(tc_vector, sort_should_sort_the_vector);
   tcase_add_test(tc_vector, sort_does_nothing_if_compare_function_is_null);
+  tcase_add_test(tc_vector, stable_sort_should_keep_order_of_equal_elements);
+  tcase_add_test(tc_vector, partial_sort_should_sort_only_the_k_smallest);
+  tcase_add_test(tc_vector, partial_sort_bigger_than_length_should_sort_everything);
+  tcase_add_test(tc_vector, nth_element_should_partition_around_position);
 
   tcase_add_test(tc_vector, map_should_call_functionl_for_each_element);
   tcase_add_test(tc_vector, map_should_call_functionl_for_each_element_passing_auxiliar_data);
@@ -618,15 +1525,67 @@ vector_suite(void) {
   tcase_add_test(tc_vector, delete_element_should_shift_elements);
   tcase_add_test(tc_vector, delete_element_should_fail_if_invalid_position);
 
+  tcase_add_test(tc_vector, swap_remove_should_move_last_element_into_the_gap);
+  tcase_add_test(tc_vector, remove_if_should_compact_keeping_order);
+  tcase_add_test(tc_vector, retain_should_call_free_function_on_removed_elements);
+  tcase_add_test(tc_vector, dedup_should_leave_unique_elements_of_sorted_vector);
+
+  tcase_add_test(tc_vector, shrink_threshold_should_halve_allocated_length);
+  tcase_add_test(tc_vector, shrink_to_fit_should_match_logical_length);
+  tcase_add_test(tc_vector, shrink_to_fit_and_clear_should_free_sort_buffer);
+  tcase_add_test(tc_vector, clear_should_free_elements_and_optionally_keep_capacity);
+  tcase_add_test(tc_vector, clear_should_not_release_borrowed_memory);
+  tcase_add_test(tc_vector, lazy_delete_should_mark_slots_until_compaction);
+  tcase_add_test(tc_vector, lazy_delete_should_compact_past_threshold);
+  tcase_add_test(tc_vector, lazy_delete_positions_should_survive_compaction);
+  tcase_add_test(tc_vector, next_span_should_skip_deleted_slots);
+  tcase_add_test(tc_vector, map_range_should_only_visit_the_range);
+  tcase_add_test(tc_vector, map_chunks_should_hand_over_contiguous_spans);
+  tcase_add_test(tc_vector, map_chunks_should_skip_lazily_deleted_elements);
+
+  tcase_add_test(tc_vector, aligned_vector_should_keep_buffer_aligned_when_growing);
+  tcase_add_test(tc_vector, huge_pages_vector_should_map_big_buffers);
+
+  tcase_add_test(tc_vector, from_buffer_should_adopt_buffer_without_copying);
+  tcase_add_test(tc_vector, from_borrowed_buffer_should_copy_on_grow);
+  tcase_add_test(tc_vector, detach_should_hand_over_buffer);
+  tcase_add_test(tc_vector, view_should_expose_subrange_to_search_and_map);
+  tcase_add_test(tc_vector, clone_should_share_buffer_until_modified);
+  tcase_add_test(tc_vector, map_should_not_write_to_shared_buffer);
+  tcase_add_test(tc_vector, clone_should_keep_lazy_deletions_and_copy_borrowed_buffers);
+
   suite_add_tcase(s, tc_vector);
 
   return s;
 }
 
+Suite *vector_soa_suite(void);
+Suite *vector_concurrent_suite(void);
+Suite *vector_snapshot_suite(void);
+Suite *bptree_suite(void);
+Suite *bitset_suite(void);
+Suite *vector_str_suite(void);
+Suite *vector_packed_suite(void);
+Suite *vector_extsort_suite(void);
+Suite *vector_merge_suite(void);
+Suite *vector_persistent_suite(void);
+Suite *vector_tiered_suite(void);
+
 int main(void) {
   int nfailed;
   Suite *s = vector_suite();
   SRunner *sr = srunner_create(s);
+  srunner_add_suite(sr, vector_soa_suite());
+  srunner_add_suite(sr, vector_concurrent_suite());
+  srunner_add_suite(sr, vector_snapshot_suite());
+  srunner_add_suite(sr, bptree_suite());
+  srunner_add_suite(sr, bitset_suite());
+  srunner_add_suite(sr, vector_str_suite());
+  srunner_add_suite(sr, vector_packed_suite());
+  srunner_add_suite(sr, vector_extsort_suite());
+  srunner_add_suite(sr, vector_merge_suite());
+  srunner_add_suite(sr, vector_persistent_suite());
+  srunner_add_suite(sr, vector_tiered_suite());
 
   srunner_run_all(sr, CK_NORMAL);
   nfailed = srunner_ntests_failed(sr);
@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <check.h>
+#include "../src/vector_concurrent.h"
+
+#define WRITERS 4
+#define PER_WRITER 50000
+
+typedef struct {
+  vector_concurrent *v;
+  long writer;
+} worker;
+
+static void *append_many(void *arg)
+{
+  worker *w = arg;
+  long i, value;
+
+  for (i = 0; i < PER_WRITER; i++) {
+    value = w->writer * PER_WRITER + i;
+    vector_concurrent_append(w->v, &value);
+  }
+  return NULL;
+}
+
+static void *read_while_appending(void *arg)
+{
+  vector_concurrent *v = arg;
+  size_t i, seen = 0;
+
+  while (seen < WRITERS * PER_WRITER) {
+    for (i = 0; i < vector_concurrent_length(v); i++) {
+      long *found = vector_concurrent_get(v, i);
+      if (found != NULL && (*found < 0 || *found >= WRITERS * PER_WRITER))
+        return (void *)1;
+    }
+    seen = vector_concurrent_length(v);
+  }
+  return NULL;
+}
+
+START_TEST (concurrent_append_and_get_in_one_thread)
+{
+  int i, *found, *first;
+
+  vector_concurrent *v = vector_concurrent_new(sizeof(int), NULL, 3);
+  for (i = 0; i < 100; i++)
+    fail_unless(vector_concurrent_append(v, &i) == (size_t)i);
+
+  first = vector_concurrent_get(v, 0);
+  fail_unless(vector_concurrent_length(v) == 100);
+  for (i = 0; i < 100; i++) {
+    found = vector_concurrent_get(v, i);
+    fail_unless(found != NULL && *found == i, "wrong element at %d", i);
+  }
+  fail_unless(vector_concurrent_get(v, 100) == NULL);
+  fail_unless(first == vector_concurrent_get(v, 0), "elements should never move");
+
+  vector_concurrent_free(v);
+}
+END_TEST
+
+START_TEST (concurrent_append_from_many_threads)
+{
+  pthread_t writers[WRITERS], reader;
+  worker workers[WRITERS];
+  void *reader_failed;
+  char *seen;
+  size_t i;
+  long w;
+
+  vector_concurrent *v = vector_concurrent_new(sizeof(long), NULL, 16);
+
+  pthread_create(&reader, NULL, read_while_appending, v);
+  for (w = 0; w < WRITERS; w++) {
+    workers[w].v = v;
+    workers[w].writer = w;
+    pthread_create(&writers[w], NULL, append_many, &workers[w]);
+  }
+  for (w = 0; w < WRITERS; w++)
+    pthread_join(writers[w], NULL);
+  pthread_join(reader, &reader_failed);
+
+  fail_unless(reader_failed == NULL, "reader saw a torn element");
+  fail_unless(vector_concurrent_length(v) == WRITERS * PER_WRITER);
+
+  seen = calloc(WRITERS * PER_WRITER, 1);
+  for (i = 0; i < WRITERS * PER_WRITER; i++) {
+    long *found = vector_concurrent_get(v, i);
+    fail_unless(found != NULL);
+    fail_if(seen[*found], "value %ld appended twice", *found);
+    seen[*found] = 1;
+  }
+  free(seen);
+
+  vector_concurrent_free(v);
+}
+END_TEST
+
+Suite *
+vector_concurrent_suite(void) {
+  Suite *s = suite_create("vector_concurrent");
+  TCase *tc_concurrent = tcase_create("vector_concurrent");
+
+  tcase_add_test(tc_concurrent, concurrent_append_and_get_in_one_thread);
+  tcase_add_test(tc_concurrent, concurrent_append_from_many_threads);
+
+  suite_add_tcase(s, tc_concurrent);
+
+  return s;
+}
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <check.h>
+#include "../src/vector_extsort.h"
+
+typedef struct {
+  int key;
+  int seq;
+} record;
+
+static int compare_records(const void *r1, const void *r2)
+{
+  const record *a = r1, *b = r2;
+  if (a->key > b->key) return  1;
+  if (a->key < b->key) return -1;
+  return 0;
+}
+
+typedef struct {
+  size_t count;
+  size_t chunks;
+  long key_sum;
+  bool sorted;
+  record last;
+} check_output;
+
+static void check_chunk(const void *elems, size_t count, void *aux)
+{
+  check_output *out = aux;
+  const record *r = elems;
+  size_t i;
+
+  out->chunks++;
+  for (i = 0; i < count; i++) {
+    if (out->count > 0 && compare_records(&out->last, &r[i]) > 0)
+      out->sorted = false;
+    out->last = r[i];
+    out->key_sum += r[i].key;
+    out->count++;
+  }
+}
+
+static long add_records(vector_extsort *es, int n)
+{
+  vector *batch = vector_new(sizeof(record), NULL, 100);
+  record r;
+  long key_sum = 0;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    r.key = (int)(((long)i * 7919) % 10007);
+    r.seq = i;
+    key_sum += r.key;
+    vector_append(batch, &r);
+
+    /* a producer handing over batches of a reused vector */
+    if (vector_length(batch) == 100) {
+      fail_unless(vector_extsort_add_vector(es, batch) == VECT_OK);
+      vector_clear(batch, true);
+    }
+  }
+  fail_unless(vector_extsort_add_vector(es, batch) == VECT_OK);
+  vector_free(batch);
+  return key_sum;
+}
+
+START_TEST (extsort_new_should_fail_on_invalid_arguments)
+{
+  fail_unless(vector_extsort_new(0, compare_records, 1024, 1) == NULL);
+  fail_unless(vector_extsort_new(sizeof(record), NULL, 1024, 1) == NULL);
+  fail_unless(vector_extsort_new(sizeof(record), compare_records, 1024, 0) == NULL);
+  fail_unless(vector_extsort_new(sizeof(record), compare_records, 4, 1) == NULL);
+}
+END_TEST
+
+START_TEST (extsort_should_sort_in_memory_when_it_fits)
+{
+  vector_extsort *es = vector_extsort_new(sizeof(record), compare_records, 1 << 20, 1);
+  check_output out = { 0, 0, 0, true, { 0, 0 } };
+  long key_sum = add_records(es, 1000);
+
+  fail_unless(vector_extsort_finish(es, check_chunk, &out) == VECT_OK);
+  fail_unless(vector_length(es->runs) == 0, "no run should be spilled");
+  fail_unless(out.count == 1000 && out.sorted && out.key_sum == key_sum);
+  fail_unless(out.chunks == 1);
+
+  vector_extsort_free(es);
+}
+END_TEST
+
+START_TEST (extsort_should_merge_spilled_runs)
+{
+  /* 512 records per run, about 40 runs */
+  vector_extsort *es = vector_extsort_new(sizeof(record), compare_records, 4096, 1);
+  check_output out = { 0, 0, 0, true, { 0, 0 } };
+  long key_sum = add_records(es, 20000);
+
+  fail_unless(vector_extsort_finish(es, check_chunk, &out) == VECT_OK);
+  fail_unless(vector_length(es->runs) == 40);
+  fail_unless(out.count == 20000 && out.sorted && out.key_sum == key_sum);
+  fail_unless(out.chunks > 1, "output should come in chunks");
+
+  vector_extsort_free(es);
+}
+END_TEST
+
+START_TEST (extsort_should_sort_runs_in_parallel)
+{
+  vector_extsort *es = vector_extsort_new(sizeof(record), compare_records, 4096 * 4, 4);
+  check_output out = { 0, 0, 0, true, { 0, 0 } };
+  long key_sum = add_records(es, 50000);
+  int j;
+
+  fail_unless(vector_extsort_finish(es, check_chunk, &out) == VECT_OK);
+  fail_unless(out.count == 50000 && out.sorted && out.key_sum == key_sum);
+  for (j = 0; j < 4; j++)
+    fail_unless(es->jobs[j].buffer->alloc_length == 1,
+                "run buffers should be released before merging");
+
+  vector_extsort_free(es);
+}
+END_TEST
+
+START_TEST (extsort_should_write_sorted_file)
+{
+  vector_extsort *es = vector_extsort_new(sizeof(record), compare_records, 1024, 1);
+  FILE *out = tmpfile();
+  record r, last = { -1, 0 };
+  size_t count = 0;
+
+  add_records(es, 5000);
+  fail_unless(vector_extsort_finish_file(es, out) == VECT_OK);
+
+  rewind(out);
+  while (fread(&r, sizeof(record), 1, out) == 1) {
+    fail_unless(compare_records(&last, &r) <= 0);
+    last = r;
+    count++;
+  }
+  fail_unless(count == 5000);
+
+  fclose(out);
+  vector_extsort_free(es);
+}
+END_TEST
+
+START_TEST (extsort_should_skip_deleted_elements)
+{
+  vector_extsort *es = vector_extsort_new(sizeof(record), compare_records, 4096, 1);
+  check_output out = { 0, 0, 0, true, { 0, 0 } };
+  vector *v = vector_new(sizeof(record), NULL, 1000);
+  record r;
+  long key_sum = 0;
+  int i;
+
+  vector_set_lazy_delete(v, 1);
+  for (i = 0; i < 1000; i++) {
+    r.key = 999 - i;
+    r.seq = i;
+    vector_append(v, &r);
+  }
+  for (i = 0; i < 1000; i += 3)
+    vector_delete(v, i);
+  for (i = 0; i < 1000; i++) {
+    if (i % 3 != 0) key_sum += 999 - i;
+  }
+
+  fail_unless(vector_extsort_add_vector(es, v) == VECT_OK);
+  fail_unless(vector_extsort_finish(es, check_chunk, &out) == VECT_OK);
+  fail_unless(out.count == 666 && out.sorted && out.key_sum == key_sum);
+
+  vector_free(v);
+  vector_extsort_free(es);
+}
+END_TEST
+
+Suite *
+vector_extsort_suite(void) {
+  Suite *s = suite_create("vector_extsort");
+  TCase *tc_extsort = tcase_create("vector_extsort");
+
+  tcase_add_test(tc_extsort, extsort_new_should_fail_on_invalid_arguments);
+  tcase_add_test(tc_extsort, extsort_should_sort_in_memory_when_it_fits);
+  tcase_add_test(tc_extsort, extsort_should_merge_spilled_runs);
+  tcase_add_test(tc_extsort, extsort_should_sort_runs_in_parallel);
+  tcase_add_test(tc_extsort, extsort_should_write_sorted_file);
+  tcase_add_test(tc_extsort, extsort_should_skip_deleted_elements);
+
+  suite_add_tcase(s, tc_extsort);
+
+  return s;
+}
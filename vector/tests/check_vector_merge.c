@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <check.h>
+#include "../src/vector_merge.h"
+
+typedef struct {
+  int key;
+  int source;
+} tagged;
+
+static int compare_keys(const void *t1, const void *t2)
+{
+  if (*(int *)t1 > *(int *)t2) return  1;
+  if (*(int *)t1 < *(int *)t2) return -1;
+  return 0;
+}
+
+static vector *ints(const int *values, int n)
+{
+  vector *v = vector_new(sizeof(int), NULL, n > 0 ? n : 1);
+  int i;
+  for (i = 0; i < n; i++)
+    vector_append(v, &values[i]);
+  return v;
+}
+
+static void assert_ints(const vector *v, const int *expected, int n)
+{
+  int i;
+  fail_unless((int)vector_length(v) == n, "length is %d, not %d", (int)vector_length(v), n);
+  for (i = 0; i < n; i++)
+    fail_unless(*(int *)vector_get(v, i) == expected[i],
+                "position %d is %d, not %d", i, *(int *)vector_get(v, i), expected[i]);
+}
+
+START_TEST (merge_k_should_merge_in_order_keeping_input_order_of_ties)
+{
+  vector *inputs[7], *out = vector_new(sizeof(tagged), NULL, 1);
+  tagged t, *prev = NULL, *cur;
+  size_t i;
+  int k, n;
+
+  for (k = 0; k < 7; k++) {
+    inputs[k] = vector_new(sizeof(tagged), NULL, 8);
+    for (n = 0; n < 50 * k; n++) {
+      t.key = n * (k + 1) / 3;
+      t.source = k;
+      vector_append(inputs[k], &t);
+    }
+  }
+
+  fail_unless(vector_merge_k(out, inputs, 7, compare_keys) == VECT_OK);
+  fail_unless(vector_length(out) == 50 * 21);
+
+  for (i = 0; i < vector_length(out); i++) {
+    cur = vector_get(out, i);
+    if (prev != NULL) {
+      fail_unless(prev->key <= cur->key);
+      if (prev->key == cur->key)
+        fail_unless(prev->source <= cur->source, "ties should keep input order");
+    }
+    prev = cur;
+  }
+
+  for (k = 0; k < 7; k++)
+    vector_free(inputs[k]);
+  vector_free(out);
+}
+END_TEST
+
+START_TEST (merge_k_should_reject_mismatched_sizes)
+{
+  vector *inputs[2], *out = vector_new(sizeof(int), NULL, 4);
+
+  inputs[0] = vector_new(sizeof(int), NULL, 4);
+  inputs[1] = vector_new(sizeof(long long), NULL, 4);
+
+  fail_unless(vector_merge_k(out, inputs, 2, compare_keys) == VECT_MERGE_INVALID_INPUT);
+  fail_unless(vector_merge_k(out, inputs, -1, compare_keys) == VECT_MERGE_INVALID_INPUT);
+  fail_unless(vector_merge_k(out, inputs, 1, compare_keys) == VECT_OK);
+  fail_unless(vector_length(out) == 0);
+
+  vector_free(inputs[0]);
+  vector_free(inputs[1]);
+  vector_free(out);
+}
+END_TEST
+
+START_TEST (set_operations_should_follow_multiset_counts)
+{
+  int a_values[] = { 1, 2, 2, 2, 5, 7, 9 };
+  int b_values[] = { 2, 2, 3, 7, 7, 10 };
+  int union_values[] = { 1, 2, 2, 2, 3, 5, 7, 7, 9, 10 };
+  int intersect_values[] = { 2, 2, 7 };
+  int difference_values[] = { 1, 2, 5, 9 };
+  vector *a = ints(a_values, 7), *b = ints(b_values, 6);
+  vector *out = vector_new(sizeof(int), NULL, 1);
+
+  fail_unless(vector_union(out, a, b, compare_keys) == VECT_OK);
+  assert_ints(out, union_values, 10);
+
+  vector_clear(out, true);
+  fail_unless(vector_intersect(out, a, b, compare_keys) == VECT_OK);
+  assert_ints(out, intersect_values, 3);
+
+  vector_clear(out, true);
+  fail_unless(vector_difference(out, a, b, compare_keys) == VECT_OK);
+  assert_ints(out, difference_values, 4);
+
+  vector_free(a);
+  vector_free(b);
+  vector_free(out);
+}
+END_TEST
+
+START_TEST (intersect_should_gallop_over_skewed_sizes)
+{
+  int small_values[] = { -5, 0, 4000, 77777, 99998, 200000 };
+  int expected[] = { 0, 4000, 99998 };
+  vector *small = ints(small_values, 6), *large = vector_new(sizeof(int), NULL, 1024);
+  vector *out = vector_new(sizeof(int), NULL, 1);
+  int i;
+
+  for (i = 0; i < 100000; i += 2)
+    vector_append(large, &i);
+
+  fail_unless(vector_intersect(out, small, large, compare_keys) == VECT_OK);
+  assert_ints(out, expected, 3);
+
+  vector_clear(out, true);
+  fail_unless(vector_intersect(out, large, small, compare_keys) == VECT_OK);
+  assert_ints(out, expected, 3);
+
+  vector_clear(out, true);
+  fail_unless(vector_difference(out, large, small, compare_keys) == VECT_OK);
+  fail_unless(vector_length(out) == 50000 - 3);
+
+  vector_free(small);
+  vector_free(large);
+  vector_free(out);
+}
+END_TEST
+
+START_TEST (merges_should_reject_lazily_deleted_inputs)
+{
+  int a_values[] = { 0, 1, 2, 3, 4, 5 };
+  int b_values[] = { 0, 2, 4 };
+  int union_values[] = { 0, 1, 2, 3, 4, 5 };
+  vector *a = ints(a_values, 6), *b = ints(b_values, 3);
+  vector *out = vector_new(sizeof(int), NULL, 1);
+  vector *inputs[2];
+
+  vector_set_lazy_delete(a, 1);
+  vector_delete(a, 2);
+  inputs[0] = a;
+  inputs[1] = b;
+
+  fail_unless(vector_union(out, a, b, compare_keys) == VECT_MERGE_INVALID_INPUT);
+  fail_unless(vector_intersect(out, b, a, compare_keys) == VECT_MERGE_INVALID_INPUT);
+  fail_unless(vector_difference(out, a, b, compare_keys) == VECT_MERGE_INVALID_INPUT);
+  fail_unless(vector_merge_k(out, inputs, 2, compare_keys) == VECT_MERGE_INVALID_INPUT);
+  fail_unless(vector_length(out) == 0);
+
+  vector_compact(a);
+  fail_unless(vector_union(out, a, b, compare_keys) == VECT_OK);
+  assert_ints(out, union_values, 6);
+
+  vector_free(a);
+  vector_free(b);
+  vector_free(out);
+}
+END_TEST
+
+START_TEST (reserve_should_grow_without_changing_length)
+{
+  vector *v = vector_new(sizeof(int), NULL, 2);
+
+  vector_reserve(v, 100);
+  fail_unless(v->alloc_length == 100, "a large request should not overshoot");
+  fail_unless(vector_length(v) == 0);
+
+  vector_reserve(v, 101);
+  fail_unless(v->alloc_length == 200, "a small request should grow one step");
+
+  vector_free(v);
+}
+END_TEST
+
+Suite *
+vector_merge_suite(void) {
+  Suite *s = suite_create("vector_merge");
+  TCase *tc_merge = tcase_create("vector_merge");
+
+  tcase_add_test(tc_merge, merge_k_should_merge_in_order_keeping_input_order_of_ties);
+  tcase_add_test(tc_merge, merge_k_should_reject_mismatched_sizes);
+  tcase_add_test(tc_merge, set_operations_should_follow_multiset_counts);
+  tcase_add_test(tc_merge, intersect_should_gallop_over_skewed_sizes);
+  tcase_add_test(tc_merge, merges_should_reject_lazily_deleted_inputs);
+  tcase_add_test(tc_merge, reserve_should_grow_without_changing_length);
+
+  suite_add_tcase(s, tc_merge);
+
+  return s;
+}
@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <check.h>
+#include "../src/vector_packed.h"
+
+START_TEST (packed_append_and_get_should_round_trip_values)
+{
+  vector_packed *p = vector_packed_new();
+  uint64_t i;
+
+  fail_unless(vector_packed_length(p) == 0);
+
+  /* mixes small and huge differences, in both directions */
+  for (i = 0; i < 1000; i++)
+    vector_packed_append(p, i % 7 == 0 ? UINT64_MAX - i : i * 3);
+
+  fail_unless(vector_packed_length(p) == 1000);
+  for (i = 0; i < 1000; i++)
+    fail_unless(vector_packed_get(p, i) == (i % 7 == 0 ? UINT64_MAX - i : i * 3),
+                "wrong value at %d", (int)i);
+
+  vector_packed_free(p);
+}
+END_TEST
+
+START_TEST (packed_should_compress_close_sorted_values)
+{
+  vector_packed *p = vector_packed_new();
+  uint64_t i, id = 1000000;
+
+  for (i = 0; i < 128 * 100; i++) {
+    id += 1 + (i * 7919) % 1000;
+    vector_packed_append(p, id);
+  }
+
+  /* differences under 1024 take 11 bits instead of 64 */
+  fail_unless(vector_packed_bytes(p) < 128 * 100 * sizeof(uint64_t) / 4,
+              "%d bytes used", (int)vector_packed_bytes(p));
+
+  vector_packed_free(p);
+}
+END_TEST
+
+START_TEST (packed_iteration_should_follow_blocks_and_tail)
+{
+  vector_packed *p = vector_packed_new();
+  vector_packed_iter it;
+  uint64_t i, value, expected = 0;
+
+  vector_packed_iter_init(p, &it);
+  fail_unless(vector_packed_next(&it, &value) == false);
+
+  for (i = 0; i < 300; i++)
+    vector_packed_append(p, i * i);
+
+  for (vector_packed_iter_init(p, &it); vector_packed_next(&it, &value); expected++)
+    fail_unless(value == expected * expected);
+  fail_unless(expected == 300);
+
+  vector_packed_free(p);
+}
+END_TEST
+
+START_TEST (packed_search_should_skip_to_block)
+{
+  vector_packed *p = vector_packed_new();
+  uint64_t i, key;
+
+  for (i = 0; i < 1000; i++)
+    vector_packed_append(p, 10 + i * 2);
+
+  for (i = 0; i < 1000; i++) {
+    key = 10 + i * 2;
+    fail_unless(vector_packed_search(p, key) == (int)i);
+  }
+
+  fail_unless(vector_packed_search(p, 5) == VECT_SEARCH_NOT_FOUND);
+  fail_unless(vector_packed_search(p, 11) == VECT_SEARCH_NOT_FOUND);
+  fail_unless(vector_packed_search(p, 10 + 127 * 2 + 1) == VECT_SEARCH_NOT_FOUND);
+  fail_unless(vector_packed_search(p, 5000) == VECT_SEARCH_NOT_FOUND);
+
+  vector_packed_free(p);
+}
+END_TEST
+
+START_TEST (packed_should_convert_from_and_to_vector)
+{
+  vector *v = vector_new(sizeof(uint64_t), NULL, 16), *out;
+  vector *ints = vector_new(sizeof(int), NULL, 4);
+  vector_packed *p;
+  uint64_t i;
+
+  fail_unless(vector_packed_from_vector(ints) == NULL);
+
+  for (i = 0; i < 500; i++)
+    vector_append(v, &(uint64_t){ i << 20 });
+
+  p = vector_packed_from_vector(v);
+  fail_unless(vector_packed_length(p) == 500);
+
+  out = vector_packed_to_vector(p);
+  fail_unless(vector_length(out) == 500);
+  for (i = 0; i < 500; i++)
+    fail_unless(*(uint64_t *)vector_get(out, i) == i << 20);
+
+  vector_append(out, &i);
+  fail_unless(out->alloc_length == 1000, "the length should not be the growth step");
+  vector_packed_free(p);
+
+  /* lazily deleted slots are not packed */
+  vector_set_lazy_delete(v, 1);
+  vector_delete(v, 0);
+  vector_delete(v, 100);
+  p = vector_packed_from_vector(v);
+  fail_unless(vector_packed_length(p) == 498);
+  fail_unless(vector_packed_get(p, 0) == (uint64_t)1 << 20);
+  fail_unless(vector_packed_get(p, 99) == (uint64_t)101 << 20);
+
+  vector_free(out);
+  vector_free(ints);
+  vector_free(v);
+  vector_packed_free(p);
+}
+END_TEST
+
+Suite *
+vector_packed_suite(void) {
+  Suite *s = suite_create("vector_packed");
+  TCase *tc_packed = tcase_create("vector_packed");
+
+  tcase_add_test(tc_packed, packed_append_and_get_should_round_trip_values);
+  tcase_add_test(tc_packed, packed_should_compress_close_sorted_values);
+  tcase_add_test(tc_packed, packed_iteration_should_follow_blocks_and_tail);
+  tcase_add_test(tc_packed, packed_search_should_skip_to_block);
+  tcase_add_test(tc_packed, packed_should_convert_from_and_to_vector);
+
+  suite_add_tcase(s, tc_packed);
+
+  return s;
+}
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <check.h>
+#include "../src/vector_persistent.h"
+
+/* version with the values start, start + 1... built through a transient */
+static vector_persistent *range(int start, int n)
+{
+  vector_persistent *empty = vector_persistent_new(sizeof(int));
+  vector_persistent *t = vector_persistent_transient(empty);
+  int i, value;
+
+  vector_persistent_free(empty);
+  for (i = 0; i < n; i++) {
+    value = start + i;
+    vector_persistent_append(t, &value);
+  }
+  vector_persistent_freeze(t);
+  return t;
+}
+
+static void assert_range(const vector_persistent *p, int start, int n)
+{
+  int i;
+
+  fail_unless((int)vector_persistent_length(p) == n, "length is %d, not %d",
+              (int)vector_persistent_length(p), n);
+  for (i = 0; i < n; i++)
+    fail_unless(*(const int *)vector_persistent_get(p, i) == start + i,
+                "position %d is %d, not %d", i, *(const int *)vector_persistent_get(p, i),
+                start + i);
+  fail_unless(vector_persistent_get(p, n) == NULL);
+}
+
+START_TEST (push_should_leave_old_versions_untouched)
+{
+  int lengths[] = { 0, 1, 32, 33, 1056, 1057, 40000 };
+  vector_persistent *versions[7], *p = vector_persistent_new(sizeof(int)), *next;
+  int i, k = 0;
+
+  for (i = 0; ; i++) {
+    if (i == lengths[k])
+      versions[k++] = p;
+    if (i == 40000) break;
+
+    next = vector_persistent_push(p, &i);
+    if (versions[k - 1] != p)
+      vector_persistent_free(p);
+    p = next;
+  }
+
+  for (k = 0; k < 7; k++) {
+    assert_range(versions[k], 0, lengths[k]);
+    vector_persistent_free(versions[k]);
+  }
+}
+END_TEST
+
+START_TEST (set_should_copy_only_the_path_to_the_element)
+{
+  vector_persistent *p = range(0, 5000), *q, *r;
+  int value = -1;
+
+  q = vector_persistent_set(p, 1234, &value);
+  fail_unless(*(const int *)vector_persistent_get(q, 1234) == -1);
+  fail_unless(q->tail == p->tail, "the tail should be shared");
+  fail_unless(q->root != p->root);
+  assert_range(p, 0, 5000);
+
+  r = vector_persistent_set(q, 4999, &value);
+  fail_unless(r->root == q->root, "the tree should be shared");
+  fail_unless(*(const int *)vector_persistent_get(r, 4999) == -1);
+  fail_unless(*(const int *)vector_persistent_get(q, 4999) == 4999);
+
+  fail_unless(vector_persistent_set(p, 5000, &value) == NULL);
+
+  vector_persistent_free(p);
+  vector_persistent_free(q);
+  vector_persistent_free(r);
+}
+END_TEST
+
+START_TEST (transient_should_modify_in_place_until_frozen)
+{
+  vector_persistent *p = range(0, 100), *t = vector_persistent_transient(p);
+  int i, value;
+
+  for (i = 100; i < 10000; i++)
+    fail_unless(vector_persistent_append(t, &i) == VECT_OK);
+  for (i = 0; i < 10000; i += 7) {
+    value = -i;
+    fail_unless(vector_persistent_replace(t, i, &value) == VECT_OK);
+  }
+  fail_unless(vector_persistent_replace(t, 10000, &value) == VECT_REPLACE_INVALID_POSITION);
+
+  assert_range(p, 0, 100);
+  for (i = 0; i < 10000; i++)
+    fail_unless(*(const int *)vector_persistent_get(t, i) == (i % 7 == 0 ? -i : i));
+
+  vector_persistent_freeze(t);
+  fail_unless(vector_persistent_append(t, &value) == VECT_PERSISTENT_NOT_TRANSIENT);
+  fail_unless(vector_persistent_replace(t, 0, &value) == VECT_PERSISTENT_NOT_TRANSIENT);
+
+  vector_persistent_free(p);
+  vector_persistent_free(t);
+}
+END_TEST
+
+START_TEST (concat_should_join_versions_of_any_length)
+{
+  int lengths[] = { 0, 1, 31, 32, 33, 100, 1024, 1025, 5000, 40000 };
+  vector_persistent *a, *b, *ab;
+  int i, j;
+
+  for (i = 0; i < 10; i++) {
+    for (j = 0; j < 10; j++) {
+      a = range(0, lengths[i]);
+      b = range(lengths[i], lengths[j]);
+      ab = vector_persistent_concat(a, b);
+
+      assert_range(ab, 0, lengths[i] + lengths[j]);
+      assert_range(a, 0, lengths[i]);
+      assert_range(b, lengths[i], lengths[j]);
+
+      vector_persistent_free(a);
+      vector_persistent_free(b);
+      vector_persistent_free(ab);
+    }
+  }
+
+  a = vector_persistent_new(sizeof(int));
+  b = vector_persistent_new(sizeof(char));
+  fail_unless(vector_persistent_concat(a, b) == NULL);
+  vector_persistent_free(a);
+  vector_persistent_free(b);
+}
+END_TEST
+
+START_TEST (concat_should_keep_the_tree_shallow)
+{
+  vector_persistent *p = vector_persistent_new(sizeof(int)), *piece, *next;
+  int i, n, length = 0;
+
+  srand(7);
+  for (i = 0; i < 300; i++) {
+    n = 33 + rand() % 300;
+    piece = range(length, n);
+    next = vector_persistent_concat(p, piece);
+    vector_persistent_free(piece);
+    vector_persistent_free(p);
+    p = next;
+    length += n;
+
+    /* modifying the result must not break the relaxed nodes */
+    if (i % 50 == 0) {
+      next = vector_persistent_push(p, &length);
+      vector_persistent_free(p);
+      p = next;
+      length++;
+    }
+  }
+
+  assert_range(p, 0, length);
+  fail_unless(p->shift <= 4 * VECTOR_PERSISTENT_BITS, "height is %d levels",
+              p->shift / VECTOR_PERSISTENT_BITS);
+
+  vector_persistent_free(p);
+}
+END_TEST
+
+START_TEST (vector_conversion_should_round_trip)
+{
+  vector *v = vector_new(sizeof(int), NULL, 16), *out;
+  vector_persistent *p;
+  int i;
+
+  for (i = 0; i < 3000; i++)
+    vector_append(v, &i);
+
+  p = vector_persistent_from_vector(v);
+  assert_range(p, 0, 3000);
+
+  out = vector_persistent_to_vector(p);
+  fail_unless(vector_length(out) == 3000);
+  for (i = 0; i < 3000; i++)
+    fail_unless(*(int *)vector_get(out, i) == i);
+
+  vector_append(out, &i);
+  fail_unless(out->alloc_length == 6000, "the length should not be the growth step");
+
+  vector_free(v);
+  vector_free(out);
+  vector_persistent_free(p);
+}
+END_TEST
+
+START_TEST (vector_conversion_should_skip_deleted_elements)
+{
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  vector_persistent *p;
+  int i;
+
+  vector_set_lazy_delete(v, 1);
+  for (i = 0; i < 3000; i++)
+    vector_append(v, &i);
+  for (i = 0; i < 1000; i++)
+    vector_delete(v, 1000 + i);
+
+  p = vector_persistent_from_vector(v);
+  fail_unless(vector_persistent_length(p) == 2000);
+  for (i = 0; i < 2000; i++)
+    fail_unless(*(int *)vector_persistent_get(p, i) == (i < 1000 ? i : i + 1000));
+
+  vector_free(v);
+  vector_persistent_free(p);
+}
+END_TEST
+
+Suite *
+vector_persistent_suite(void) {
+  Suite *s = suite_create("vector_persistent");
+  TCase *tc_persistent = tcase_create("vector_persistent");
+
+  tcase_add_test(tc_persistent, push_should_leave_old_versions_untouched);
+  tcase_add_test(tc_persistent, set_should_copy_only_the_path_to_the_element);
+  tcase_add_test(tc_persistent, transient_should_modify_in_place_until_frozen);
+  tcase_add_test(tc_persistent, concat_should_join_versions_of_any_length);
+  tcase_add_test(tc_persistent, concat_should_keep_the_tree_shallow);
+  tcase_add_test(tc_persistent, vector_conversion_should_round_trip);
+  tcase_add_test(tc_persistent, vector_conversion_should_skip_deleted_elements);
+
+  suite_add_tcase(s, tc_persistent);
+
+  return s;
+}
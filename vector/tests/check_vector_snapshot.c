@@ -0,0 +1,181 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <check.h>
+#include "../src/vector_snapshot.h"
+
+#define READERS 4
+#define VERSIONS 2000
+#define LENGTH 64
+
+static vector *
+filled_vector(int value)
+{
+  int i;
+  vector *v = vector_new(sizeof(int), NULL, LENGTH);
+  for (i = 0; i < LENGTH; i++)
+    vector_append(v, &value);
+  return v;
+}
+
+START_TEST (snapshot_reader_should_keep_its_version_until_release)
+{
+  const vector *old, *current;
+  int num = 42;
+
+  vector_snapshot *s = vector_snapshot_new(filled_vector(1));
+  int reader = vector_snapshot_register(s);
+  fail_unless(reader >= 0);
+
+  old = vector_snapshot_acquire(s, reader);
+
+  vector *next = vector_snapshot_begin_write(s);
+  vector_replace(next, 0, &num);
+  vector_snapshot_commit_write(s, next);
+
+  fail_unless(*(int *)vector_get(old, 0) == 1, "acquired version should not change");
+  fail_unless(s->retired != NULL, "version in use should not be reclaimed");
+  vector_snapshot_release(s, reader);
+
+  current = vector_snapshot_acquire(s, reader);
+  fail_unless(*(int *)vector_get(current, 0) == 42);
+  fail_unless(*(int *)vector_get(current, 1) == 1);
+  vector_snapshot_release(s, reader);
+
+  next = vector_snapshot_begin_write(s);
+  vector_snapshot_abort_write(s, next);
+  fail_unless(vector_snapshot_acquire(s, reader) == current);
+  vector_snapshot_release(s, reader);
+
+  next = vector_snapshot_begin_write(s);
+  vector_snapshot_commit_write(s, next);
+  fail_unless(s->retired == NULL, "released versions should be reclaimed on commit");
+
+  vector_snapshot_unregister(s, reader);
+  vector_snapshot_free(s);
+}
+END_TEST
+
+START_TEST (snapshot_writers_should_keep_lazy_deletions)
+{
+  const vector *current;
+  int i;
+
+  vector *v = vector_new(sizeof(int), NULL, 16);
+  for (i = 0; i < 10; i++)
+    vector_append(v, &i);
+  vector_set_lazy_delete(v, 0.5);
+  vector_delete(v, 2);
+  vector_delete(v, 7);
+
+  vector_snapshot *s = vector_snapshot_new(v);
+  vector *next = vector_snapshot_begin_write(s);
+  fail_unless(vector_length(next) == 10);
+  fail_unless(vector_get(next, 2) == NULL && vector_get(next, 7) == NULL);
+  fail_unless(*(int *)vector_get(next, 3) == 3);
+
+  vector_delete(next, 3);
+  fail_unless(vector_length(next) == 10, "the copy should keep deleting lazily");
+  vector_snapshot_commit_write(s, next);
+
+  int reader = vector_snapshot_register(s);
+  current = vector_snapshot_acquire(s, reader);
+  fail_unless(vector_get(current, 2) == NULL && vector_get(current, 3) == NULL);
+  fail_unless(*(int *)vector_get(current, 4) == 4);
+  vector_snapshot_release(s, reader);
+
+  vector_snapshot_free(s);
+}
+END_TEST
+
+START_TEST (snapshot_should_refuse_vectors_with_free_function)
+{
+  vector *v = vector_new(sizeof(char *), free, 4);
+  fail_unless(vector_snapshot_new(v) == NULL);
+  vector_free(v);
+}
+END_TEST
+
+START_TEST (snapshot_should_run_out_of_reader_ids)
+{
+  int i;
+  vector_snapshot *s = vector_snapshot_new(filled_vector(0));
+
+  for (i = 0; i < VECTOR_SNAPSHOT_READERS; i++)
+    fail_unless(vector_snapshot_register(s) == i);
+  fail_unless(vector_snapshot_register(s) == VECT_SNAPSHOT_TOO_MANY_READERS);
+
+  vector_snapshot_unregister(s, 3);
+  fail_unless(vector_snapshot_register(s) == 3);
+
+  vector_snapshot_free(s);
+}
+END_TEST
+
+static volatile int writer_done;
+
+static void *read_versions(void *arg)
+{
+  vector_snapshot *s = arg;
+  int i, reader = vector_snapshot_register(s);
+  long torn = 0;
+
+  while (!__atomic_load_n(&writer_done, __ATOMIC_ACQUIRE)) {
+    const vector *v = vector_snapshot_acquire(s, reader);
+    int first = *(int *)vector_get(v, 0);
+    for (i = 1; i < LENGTH; i++) {
+      if (*(int *)vector_get(v, i) != first) torn++;
+    }
+    vector_snapshot_release(s, reader);
+  }
+
+  vector_snapshot_unregister(s, reader);
+  return (void *)torn;
+}
+
+START_TEST (snapshot_readers_should_see_whole_versions_while_writer_publishes)
+{
+  pthread_t readers[READERS];
+  void *torn;
+  int i, version;
+
+  vector_snapshot *s = vector_snapshot_new(filled_vector(0));
+  writer_done = 0;
+
+  for (i = 0; i < READERS; i++)
+    pthread_create(&readers[i], NULL, read_versions, s);
+
+  for (version = 1; version <= VERSIONS; version++) {
+    vector *next = vector_snapshot_begin_write(s);
+    for (i = 0; i < LENGTH; i++)
+      vector_replace(next, i, &version);
+    vector_snapshot_commit_write(s, next);
+  }
+  __atomic_store_n(&writer_done, 1, __ATOMIC_RELEASE);
+
+  for (i = 0; i < READERS; i++) {
+    pthread_join(readers[i], &torn);
+    fail_unless(torn == NULL, "reader saw a version being modified");
+  }
+
+  vector_snapshot_free(s);
+}
+END_TEST
+
+Suite *
+vector_snapshot_suite(void) {
+  Suite *s = suite_create("vector_snapshot");
+  TCase *tc_snapshot = tcase_create("vector_snapshot");
+
+  tcase_add_test(tc_snapshot, snapshot_reader_should_keep_its_version_until_release);
+  tcase_add_test(tc_snapshot, snapshot_writers_should_keep_lazy_deletions);
+  tcase_add_test(tc_snapshot, snapshot_should_refuse_vectors_with_free_function);
+  tcase_add_test(tc_snapshot, snapshot_should_run_out_of_reader_ids);
+  tcase_add_test(tc_snapshot, snapshot_readers_should_see_whole_versions_while_writer_publishes);
+
+  suite_add_tcase(s, tc_snapshot);
+
+  return s;
+}
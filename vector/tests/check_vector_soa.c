@@ -0,0 +1,153 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <check.h>
+#include "../src/vector_soa.h"
+
+typedef struct {
+  int id;
+  double score;
+  char *name;
+} record;
+
+static const vector_soa_field record_fields[] = {
+  { offsetof(record, id), sizeof(int) },
+  { offsetof(record, score), sizeof(double) },
+  { offsetof(record, name), sizeof(char *) },
+};
+
+static void free_record_name(void *elem)
+{
+  free(((record *)elem)->name);
+}
+
+static int compare_doubles(const void *d1, const void *d2)
+{
+  if (*(double *)d1 > *(double *)d2) return  1;
+  if (*(double *)d1 < *(double *)d2) return -1;
+  return 0;
+}
+
+static vector_soa *new_records(vector_free_func free_func)
+{
+  return vector_soa_new(sizeof(record), record_fields, 3, free_func, 2);
+}
+
+START_TEST (soa_new_should_fail_on_invalid_layout)
+{
+  vector_soa_field bad = { offsetof(record, name), sizeof(record) };
+
+  fail_unless(vector_soa_new(0, record_fields, 3, NULL, 2) == NULL);
+  fail_unless(vector_soa_new(sizeof(record), record_fields, 0, NULL, 2) == NULL);
+  fail_unless(vector_soa_new(sizeof(record), record_fields, 3, NULL, 0) == NULL);
+  fail_unless(vector_soa_new(sizeof(record), &bad, 1, NULL, 2) == NULL,
+              "field past the end of the record should be rejected");
+}
+END_TEST
+
+START_TEST (soa_append_should_store_fields_in_columns)
+{
+  record r1 = { 1, 0.5, NULL }, r2 = { 2, 1.5, NULL }, r3 = { 3, 2.5, NULL };
+  record found;
+  int *ids;
+
+  vector_soa *v = new_records(NULL);
+  vector_soa_append(v, &r1);
+  vector_soa_append(v, &r2);
+  vector_soa_append(v, &r3);   /* grow before append */
+
+  fail_unless(vector_soa_length(v) == 3);
+
+  ids = vector_soa_column(v, 0);
+  fail_unless(ids[0] == 1 && ids[1] == 2 && ids[2] == 3,
+              "id column should be contiguous");
+  fail_unless(*(double *)vector_soa_get_field(v, 1, 1) == 1.5);
+
+  fail_unless(vector_soa_get(v, 2, &found) == VECT_OK);
+  fail_unless(found.id == 3 && found.score == 2.5);
+
+  vector_soa_free(v);
+}
+END_TEST
+
+START_TEST (soa_get_should_fail_if_invalid_position_or_field)
+{
+  record r = { 1, 0.5, NULL }, found;
+
+  vector_soa *v = new_records(NULL);
+  vector_soa_append(v, &r);
+
+  fail_unless(vector_soa_get(v, 1, &found) == VECT_GET_INVALID_POSITION);
+  fail_unless(vector_soa_get(v, -1, &found) == VECT_GET_INVALID_POSITION);
+  fail_unless(vector_soa_get_field(v, 0, 3) == NULL);
+  fail_unless(vector_soa_get_field(v, 1, 0) == NULL);
+  fail_unless(vector_soa_column(v, 3) == NULL);
+
+  vector_soa_free(v);
+}
+END_TEST
+
+START_TEST (soa_delete_should_shift_every_column_and_call_free_function)
+{
+  record r1 = { 1, 0.5, strdup("one") };
+  record r2 = { 2, 1.5, strdup("two") };
+  record r3 = { 3, 2.5, strdup("three") };
+  record found;
+
+  vector_soa *v = new_records(free_record_name);
+  vector_soa_append(v, &r1);
+  vector_soa_append(v, &r2);
+  vector_soa_append(v, &r3);
+
+  fail_unless(vector_soa_delete(v, 1) == VECT_OK);
+  fail_unless(vector_soa_delete(v, 5) == VECT_DELETE_INVALID_POSITION);
+  fail_unless(vector_soa_length(v) == 2);
+
+  vector_soa_get(v, 1, &found);
+  fail_unless(found.id == 3 && found.score == 2.5);
+  fail_unless(strcmp(found.name, "three") == 0);
+
+  vector_soa_free(v);
+}
+END_TEST
+
+START_TEST (soa_sort_should_reorder_all_columns_by_field)
+{
+  record r1 = { 1, 9.0, NULL }, r2 = { 2, 3.0, NULL };
+  record r3 = { 3, 5.0, NULL }, r4 = { 4, 3.0, NULL };
+  int *ids;
+
+  vector_soa *v = new_records(NULL);
+  vector_soa_append(v, &r1);
+  vector_soa_append(v, &r2);
+  vector_soa_append(v, &r3);
+  vector_soa_append(v, &r4);
+
+  vector_soa_sort(v, 1, compare_doubles);
+
+  ids = vector_soa_column(v, 0);
+  fail_unless(ids[0] == 2 && ids[1] == 4, "equal keys should keep their order");
+  fail_unless(ids[2] == 3 && ids[3] == 1);
+  fail_unless(*(double *)vector_soa_get_field(v, 3, 1) == 9.0);
+
+  vector_soa_free(v);
+}
+END_TEST
+
+Suite *
+vector_soa_suite(void) {
+  Suite *s = suite_create("vector_soa");
+  TCase *tc_soa = tcase_create("vector_soa");
+
+  tcase_add_test(tc_soa, soa_new_should_fail_on_invalid_layout);
+  tcase_add_test(tc_soa, soa_append_should_store_fields_in_columns);
+  tcase_add_test(tc_soa, soa_get_should_fail_if_invalid_position_or_field);
+  tcase_add_test(tc_soa, soa_delete_should_shift_every_column_and_call_free_function);
+  tcase_add_test(tc_soa, soa_sort_should_reorder_all_columns_by_field);
+
+  suite_add_tcase(s, tc_soa);
+
+  return s;
+}
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <check.h>
+#include "../src/vector_str.h"
+
+static void append_cstr(vector_str *v, const char *str)
+{
+  vector_str_append(v, str, strlen(str));
+}
+
+START_TEST (str_new_should_fail_on_zero_sizes)
+{
+  fail_unless(vector_str_new(0, 10) == NULL);
+  fail_unless(vector_str_new(10, 0) == NULL);
+}
+END_TEST
+
+START_TEST (str_append_should_pack_strings_in_arena)
+{
+  vector_str *v = vector_str_new(4, 1);
+  const char *first, *str;
+  size_t length;
+
+  append_cstr(v, "hello");
+  append_cstr(v, "");
+  vector_str_append(v, "a\0b", 3);
+
+  fail_unless(vector_str_length(v) == 3);
+
+  first = vector_str_get(v, 0, &length);
+  fail_unless(length == 5 && strcmp(first, "hello") == 0);
+
+  str = vector_str_get(v, 1, &length);
+  fail_unless(length == 0 && str == first + 6, "strings should be adjacent");
+
+  str = vector_str_get(v, 2, &length);
+  fail_unless(length == 3 && memcmp(str, "a\0b", 3) == 0);
+
+  fail_unless(vector_str_get(v, 3, NULL) == NULL);
+
+  vector_str_clear(v);
+  fail_unless(vector_str_length(v) == 0);
+  append_cstr(v, "again");
+  fail_unless(strcmp(vector_str_get(v, 0, NULL), "again") == 0);
+
+  vector_str_free(v);
+}
+END_TEST
+
+START_TEST (str_sort_should_use_byte_order)
+{
+  const char *words[] = { "pineapple", "apple", "applesauce", "app", "", "pine",
+                          "applesauced", "zebra", "apples" };
+  const char *sorted[] = { "", "app", "apple", "apples", "applesauce",
+                           "applesauced", "pine", "pineapple", "zebra" };
+  vector_str *v = vector_str_new(16, 2);
+  size_t i;
+
+  for (i = 0; i < 9; i++)
+    append_cstr(v, words[i]);
+
+  vector_str_sort(v);
+  for (i = 0; i < 9; i++)
+    fail_unless(strcmp(vector_str_get(v, i, NULL), sorted[i]) == 0,
+                "position %d should be %s", (int)i, sorted[i]);
+
+  vector_str_free(v);
+}
+END_TEST
+
+START_TEST (str_search_should_find_exact_matches)
+{
+  vector_str *v = vector_str_new(64, 4);
+  char buf[32];
+  int i;
+
+  for (i = 999; i >= 0; i--) {
+    sprintf(buf, "token-%04d-suffix", i);
+    append_cstr(v, buf);
+  }
+
+  fail_unless(vector_str_search(v, NULL, 0, false) == VECT_SEARCH_INVALID_KEY);
+  fail_unless(vector_str_search(v, "token-0999-suffix", 17, false) == 0);
+  fail_unless(vector_str_search(v, "token-0999", 10, false) == VECT_SEARCH_NOT_FOUND);
+
+  vector_str_sort(v);
+  for (i = 0; i < 1000; i++) {
+    sprintf(buf, "token-%04d-suffix", i);
+    fail_unless(vector_str_search(v, buf, strlen(buf), true) == i);
+  }
+  fail_unless(vector_str_search(v, "token-0500-suffiy", 17, true) == VECT_SEARCH_NOT_FOUND);
+  fail_unless(vector_str_search(v, "token", 5, true) == VECT_SEARCH_NOT_FOUND);
+
+  vector_str_free(v);
+}
+END_TEST
+
+Suite *
+vector_str_suite(void) {
+  Suite *s = suite_create("vector_str");
+  TCase *tc_str = tcase_create("vector_str");
+
+  tcase_add_test(tc_str, str_new_should_fail_on_zero_sizes);
+  tcase_add_test(tc_str, str_append_should_pack_strings_in_arena);
+  tcase_add_test(tc_str, str_sort_should_use_byte_order);
+  tcase_add_test(tc_str, str_search_should_find_exact_matches);
+
+  suite_add_tcase(s, tc_str);
+
+  return s;
+}
@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include "../src/vector_tiered.h"
+
+/* checks ``t`` against ``expected``, a plain vector edited the same way */
+static void assert_same(vector_tiered *t, const vector *expected)
+{
+  size_t i;
+
+  fail_unless(vector_tiered_length(t) == vector_length(expected));
+  for (i = 0; i < vector_length(expected); i++)
+    fail_unless(*(int *)vector_tiered_get(t, i) == *(int *)vector_get(expected, i),
+                "position %d is %d, not %d", (int)i, *(int *)vector_tiered_get(t, i),
+                *(int *)vector_get(expected, i));
+  fail_unless(vector_tiered_get(t, i) == NULL);
+}
+
+static void collect(void *num, void *out)
+{
+  vector_append(out, num);
+}
+
+START_TEST (tiered_insert_should_match_vector_insert)
+{
+  vector_tiered *t = vector_tiered_new(sizeof(int), NULL);
+  vector *expected = vector_new(sizeof(int), NULL, 1024);
+  int i, position;
+
+  srand(11);
+  for (i = 0; i < 20000; i++) {
+    position = rand() % (vector_length(expected) + 1);
+    fail_unless(vector_tiered_insert(t, &i, position) == VECT_OK);
+    vector_insert(expected, &i, position);
+  }
+
+  fail_unless(t->block_bits > VECTOR_TIERED_MIN_BITS, "blocks should have grown");
+  assert_same(t, expected);
+  fail_unless(vector_tiered_insert(t, &i, 20001) == VECT_INSERT_INVALID_POSITION);
+
+  vector_tiered_free(t);
+  vector_free(expected);
+}
+END_TEST
+
+START_TEST (tiered_delete_should_match_vector_delete)
+{
+  vector *expected = vector_new(sizeof(int), NULL, 1024);
+  vector_tiered *t;
+  int i, position;
+
+  for (i = 0; i < 10000; i++)
+    vector_append(expected, &i);
+  t = vector_tiered_from_vector(expected);
+  assert_same(t, expected);
+
+  srand(13);
+  for (i = 0; i < 9000; i++) {
+    position = rand() % vector_length(expected);
+    fail_unless(vector_tiered_delete(t, position) == VECT_OK);
+    vector_delete(expected, position);
+
+    /* interleave some inserts so blocks wrap around */
+    if (i % 3 == 0) {
+      position = rand() % (vector_length(expected) + 1);
+      vector_tiered_insert(t, &i, position);
+      vector_insert(expected, &i, position);
+    }
+  }
+  assert_same(t, expected);
+
+  while (vector_length(expected) > 0) {
+    vector_tiered_delete(t, 0);
+    vector_delete(expected, 0);
+  }
+  fail_unless(t->num_blocks == 0);
+  fail_unless(vector_tiered_delete(t, 0) == VECT_DELETE_INVALID_POSITION);
+
+  vector_tiered_free(t);
+  vector_free(expected);
+}
+END_TEST
+
+START_TEST (tiered_map_should_visit_elements_in_order)
+{
+  vector_tiered *t = vector_tiered_new(sizeof(int), NULL);
+  vector *expected = vector_new(sizeof(int), NULL, 1024);
+  vector *seen = vector_new(sizeof(int), NULL, 1024);
+  int i;
+
+  for (i = 0; i < 5000; i++) {
+    vector_tiered_insert(t, &i, i / 2);
+    vector_insert(expected, &i, i / 2);
+  }
+
+  vector_tiered_map(t, collect, seen);
+  fail_unless(vector_length(seen) == 5000);
+  fail_unless(memcmp(seen->elems, expected->elems, 5000 * sizeof(int)) == 0);
+
+  vector_tiered_free(t);
+  vector_free(expected);
+  vector_free(seen);
+}
+END_TEST
+
+START_TEST (tiered_should_reuse_the_emptied_block)
+{
+  vector_tiered *t = vector_tiered_new(sizeof(int), NULL);
+  char *spare;
+  int i;
+
+  for (i = 0; i < 65; i++)
+    vector_tiered_append(t, &i);
+  fail_unless(t->num_blocks == 2);
+
+  vector_tiered_delete(t, 64);
+  fail_unless(t->num_blocks == 1);
+  fail_unless(t->spare != NULL, "the emptied block should be kept");
+  spare = t->spare;
+
+  vector_tiered_insert(t, &i, 0);
+  fail_unless(t->num_blocks == 2);
+  fail_unless(t->blocks[1].elems == spare && t->spare == NULL,
+              "the spare block should be reused");
+  fail_unless(*(int *)vector_tiered_get(t, 64) == 63);
+
+  vector_tiered_delete(t, 0);
+  vector_tiered_free(t);
+}
+END_TEST
+
+START_TEST (tiered_from_vector_should_skip_deleted_elements)
+{
+  vector *v = vector_new(sizeof(int), NULL, 1024);
+  vector *expected = vector_new(sizeof(int), NULL, 1024);
+  vector_tiered *t;
+  int i;
+
+  vector_set_lazy_delete(v, 1);
+  for (i = 0; i < 1000; i++) {
+    vector_append(v, &i);
+    if (i % 7 != 0) vector_append(expected, &i);
+  }
+  for (i = 0; i < 1000; i += 7)
+    vector_delete(v, i);
+
+  t = vector_tiered_from_vector(v);
+  assert_same(t, expected);
+
+  vector_tiered_free(t);
+  vector_free(v);
+  vector_free(expected);
+}
+END_TEST
+
+void free_tiered_string(void *str)
+{
+  free(*(char **)str);
+}
+
+START_TEST (tiered_should_call_free_function)
+{
+  vector_tiered *t = vector_tiered_new(sizeof(char *), free_tiered_string);
+  char *str;
+  int i;
+
+  for (i = 0; i < 200; i++) {
+    str = strdup("item");
+    vector_tiered_insert(t, &str, 0);
+  }
+  vector_tiered_delete(t, 100);
+  fail_unless(vector_tiered_length(t) == 199);
+
+  vector_tiered_free(t);  /* valgrind checks the rest */
+}
+END_TEST
+
+Suite *
+vector_tiered_suite(void) {
+  Suite *s = suite_create("vector_tiered");
+  TCase *tc_tiered = tcase_create("vector_tiered");
+
+  tcase_add_test(tc_tiered, tiered_insert_should_match_vector_insert);
+  tcase_add_test(tc_tiered, tiered_delete_should_match_vector_delete);
+  tcase_add_test(tc_tiered, tiered_map_should_visit_elements_in_order);
+  tcase_add_test(tc_tiered, tiered_should_call_free_function);
+  tcase_add_test(tc_tiered, tiered_should_reuse_the_emptied_block);
+  tcase_add_test(tc_tiered, tiered_from_vector_should_skip_deleted_elements);
+
+  suite_add_tcase(s, tc_tiered);
+
+  return s;
+}
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../src/vector_tiered.h"
+
+/*
+ * Inserts at random positions of a large vector: vector_tiered against
+ * vector_insert, plus a full scan of each afterwards
+ */
+
+#define SIZES 3
+#define INSERTS 1000
+
+static double elapsed(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void sum_ints(void *num, void *total)
+{
+  *(long *)total += *(int *)num;
+}
+
+int main(void)
+{
+  int sizes[SIZES] = { 100000, 1000000, 10000000 };
+  int s, i, *positions;
+
+  printf("%10s %8s %16s %16s %14s %14s\n", "length", "inserts", "vector (s)", "tiered (s)",
+         "vector scan", "tiered scan");
+
+  for (s = 0; s < SIZES; s++) {
+    int n = sizes[s];
+    clock_t start;
+    double t_vector, t_tiered, scan_vector, scan_tiered;
+    long sum_vector = 0, sum_tiered = 0;
+
+    vector *v = vector_new_flags(sizeof(int), NULL, n + INSERTS, VECT_NO_ZERO);
+    for (i = 0; i < n; i++)
+      vector_append(v, &i);
+    vector_tiered *t = vector_tiered_from_vector(v);
+
+    positions = malloc(INSERTS * sizeof(int));
+    srand(42);
+    for (i = 0; i < INSERTS; i++)
+      positions[i] = rand() % n;
+
+    start = clock();
+    for (i = 0; i < INSERTS; i++)
+      vector_insert(v, &i, positions[i]);
+    t_vector = elapsed(start);
+
+    start = clock();
+    for (i = 0; i < INSERTS; i++)
+      vector_tiered_insert(t, &i, positions[i]);
+    t_tiered = elapsed(start);
+
+    start = clock();
+    vector_map(v, sum_ints, &sum_vector);
+    scan_vector = elapsed(start);
+
+    start = clock();
+    vector_tiered_map(t, sum_ints, &sum_tiered);
+    scan_tiered = elapsed(start);
+
+    if (sum_vector != sum_tiered)
+      printf("sums differ: %ld %ld\n", sum_vector, sum_tiered);
+
+    printf("%10d %8d %16.4f %16.4f %14.4f %14.4f\n", n, INSERTS, t_vector, t_tiered,
+           scan_vector, scan_tiered);
+
+    vector_free(v);
+    vector_tiered_free(t);
+    free(positions);
+  }
+
+  return 0;
+}